@@ -32,6 +32,121 @@ uniform vec3 Ks = vec3( 1.0 );
 
 uniform float Shininess = 1.0;
 
+// klaszterezett pontfényforrások (LightClusters): a nézeti gúla képernyő csempékre és exponenciális mélységi szeletekre
+// van bontva, minden fragment csak a saját klaszterébe sorolt fényeken megy végig
+struct PointLight
+{
+	vec3 position;
+	float radius;
+	vec3 color;
+	float padding;
+};
+
+layout( std430, binding = 3 ) readonly buffer Lights
+{
+	PointLight lights[];
+};
+
+// klaszterenként az első index és a fények száma a lightIndices tömbben
+layout( std430, binding = 4 ) readonly buffer LightClusterRanges
+{
+	uvec2 clusterRanges[];
+};
+
+layout( std430, binding = 5 ) readonly buffer LightIndices
+{
+	uint lightIndices[];
+};
+
+uniform bool clusteredLights = false;
+uniform mat4 view;
+uniform uvec3 clusterGrid = uvec3( 16, 9, 24 );
+uniform vec2 clusterDepthRange = vec2( 0.5, 100.0 ); // az első szelet vége után exponenciálisan a távolsági vágásig
+uniform vec2 viewportSize = vec2( 1.0 );
+
+uint ClusterIndex()
+{
+	float depth = -( view * vec4( vs_out_pos, 1.0 ) ).z;
+	if ( depth >= clusterDepthRange.y ) return 0xFFFFFFFFu;
+
+	uint slice = 0u;
+	if ( depth > clusterDepthRange.x )
+		slice = min( uint( log( depth / clusterDepthRange.x ) / log( clusterDepthRange.y / clusterDepthRange.x ) * float( clusterGrid.z ) ), clusterGrid.z - 1u );
+
+	uvec2 tile = min( uvec2( gl_FragCoord.xy / viewportSize * vec2( clusterGrid.xy ) ), clusterGrid.xy - 1u );
+	return ( slice * clusterGrid.y + tile.y ) * clusterGrid.x + tile.x;
+}
+
+// a klaszter fényeinek diffúz és spekuláris járuléka; a fény a sugaráig simán elhal
+vec3 ClusteredLighting( vec3 normal, vec3 viewDir )
+{
+	uint cluster = ClusterIndex();
+	if ( cluster == 0xFFFFFFFFu ) return vec3( 0.0 );
+
+	uvec2 range = clusterRanges[ cluster ];
+	vec3 result = vec3( 0.0 );
+	for ( uint i = 0u; i < range.y; ++i )
+	{
+		PointLight light = lights[ lightIndices[ range.x + i ] ];
+
+		vec3 toLight = light.position - vs_out_pos;
+		float distance = length( toLight );
+		float window = clamp( 1.0 - pow( distance / light.radius, 4.0 ), 0.0, 1.0 );
+		float attenuation = window * window / ( distance * distance + 1.0 );
+		if ( attenuation <= 0.0 ) continue;
+
+		toLight /= max( distance, 1e-4 );
+		float diffuse = max( dot( toLight, normal ), 0.0 );
+		float specular = pow( max( dot( viewDir, reflect( -toLight, normal ) ), 0.0 ), Shininess );
+		result += attenuation * light.color * ( diffuse * Kd + specular * Ks );
+	}
+	return result;
+}
+
+// kaszkádolt árnyéktérképek az irány fényforráshoz (CascadedShadowMap): a kaszkádot a nézeti mélység választja ki
+uniform bool shadows = false;
+uniform sampler2DArrayShadow shadowMap;
+uniform int shadowCascadeCount = 1;
+uniform mat4 shadowMatrices[ 4 ];
+uniform vec4 shadowSplits;     // a kaszkádok távoli határa nézeti mélységben
+uniform vec4 shadowTexelSizes; // egy árnyéktérkép texel mérete a világban
+uniform int shadowPCFRadius = 1; // (2r+1)^2 minta, mindegyik hardveres 2x2 összehasonlítás
+uniform bool shadowShowCascades = false;
+
+const vec3 CASCADE_COLORS[ 4 ] = vec3[]( vec3( 1.0, 0.4, 0.4 ), vec3( 0.4, 1.0, 0.4 ), vec3( 0.4, 0.4, 1.0 ), vec3( 1.0, 1.0, 0.4 ) );
+
+int ShadowCascade()
+{
+	float depth = -( view * vec4( vs_out_pos, 1.0 ) ).z;
+	for ( int cascade = 0; cascade < shadowCascadeCount; ++cascade )
+		if ( depth <= shadowSplits[ cascade ] ) return cascade;
+	return -1;
+}
+
+// 1: megvilágított, 0: árnyékban
+float ShadowFactor( int cascade, vec3 normal, vec3 toLight )
+{
+	if ( cascade < 0 ) return 1.0;
+
+	// a felület mentén eltolt pont (normal offset), a ferde felületeken egy texelnyivel többet
+	float texelSize = shadowTexelSizes[ cascade ];
+	float slope = 1.0 - clamp( dot( normal, toLight ), 0.0, 1.0 );
+	vec3 position = vs_out_pos + normal * texelSize * ( 0.5 + 1.5 * slope );
+
+	vec4 shadowPos = shadowMatrices[ cascade ] * vec4( position, 1.0 );
+	vec3 uvz = shadowPos.xyz / shadowPos.w * 0.5 + 0.5;
+	if ( uvz.z >= 1.0 ) return 1.0;
+
+	vec2 texel = 1.0 / vec2( textureSize( shadowMap, 0 ).xy );
+	float lit = 0.0;
+	for ( int y = -shadowPCFRadius; y <= shadowPCFRadius; ++y )
+		for ( int x = -shadowPCFRadius; x <= shadowPCFRadius; ++x )
+			lit += texture( shadowMap, vec4( uvz.xy + vec2( x, y ) * texel, float( cascade ), uvz.z ) );
+
+	float width = float( 2 * shadowPCFRadius + 1 );
+	return lit / ( width * width );
+}
+
 /* segítség:
 	    - normalizálás: http://www.opengl.org/sdk/docs/manglsl/xhtml/normalize.xml
 	    - skaláris szorzat: http://www.opengl.org/sdk/docs/manglsl/xhtml/dot.xml
@@ -42,8 +157,17 @@ uniform float Shininess = 1.0;
 				pow(alap, kitevő);
 */
 
+// túlrajzolás megjelenítése: minden árnyalt fragment ugyanannyit ad hozzá (additív keveréssel), 8 réteg fehér
+uniform bool overdrawView = false;
+
 void main()
 {
+	if ( overdrawView )
+	{
+		fs_out_col = vec4( vec3( 0.125 ), 1.0 );
+		return;
+	}
+
 	// A fragment normálvektora
 	// MINDIG normalizáljuk!
 	vec3 normal = normalize( vs_out_norm );
@@ -90,6 +214,22 @@ void main()
 	float SpecularFactor = pow(max( dot( viewDir, reflectDir) ,0.0), Shininess) * Attenuation;
 	vec3 Specular = SpecularFactor*Ls*Ks;
 
+	// az irány fényforrás árnyéka
+	if ( shadows && lightPos.w == 0.0 )
+	{
+		int cascade = ShadowCascade();
+		float shadow = ShadowFactor( cascade, normal, ToLight );
+		Diffuse *= shadow;
+		Specular *= shadow;
+
+		if ( shadowShowCascades && cascade >= 0 )
+			Ambient += 0.25 * CASCADE_COLORS[ cascade ];
+	}
+
+	// a további pontfényforrások
+	if ( clusteredLights )
+		Diffuse += ClusteredLighting( normal, viewDir );
+
 	// normal vector debug:
 	// fs_out_col = vec4( normal * 0.5 + 0.5, 1.0 );
 	fs_out_col = vec4( Ambient+Diffuse+Specular, 1.0 ) * texture(texImage, vs_out_tex);
@@ -0,0 +1,6 @@
+#version 430
+
+// mélységi menetek: csak a mélység íródik, a fragment shader nem számol semmit
+void main()
+{
+}
@@ -10,6 +10,9 @@ out vec3 vs_out_pos;
 out vec3 vs_out_norm;
 out vec2 vs_out_tex;
 
+// a mélységi előmenettel (Vert_depth) bitre azonos mélység kell a GL_EQUAL teszthez
+invariant gl_Position;
+
 // shader külső paraméterei - most a három transzformációs mátrixot külön-külön vesszük át
 uniform mat4 world;
 uniform mat4 worldIT;
@@ -0,0 +1,41 @@
+#version 430
+
+// VBO-ból érkező változók
+layout( location = 0 ) in vec3 vs_in_pos;
+layout( location = 1 ) in vec3 vs_in_norm;
+layout( location = 2 ) in vec2 vs_in_tex;
+
+// a pipeline-ban tovább adandó értékek
+out vec3 vs_out_pos;
+out vec3 vs_out_norm;
+out vec2 vs_out_tex;
+
+// a mélységi előmenettel (Vert_depth) bitre azonos mélység kell a GL_EQUAL teszthez
+invariant gl_Position;
+
+// példányonkénti transzformációk (InstanceBatcher), a world és worldIT uniform helyett
+struct InstanceTransform
+{
+	mat4 world;
+	mat4 worldIT;
+};
+
+layout( std430, binding = 0 ) readonly buffer InstanceTransforms
+{
+	InstanceTransform instances[];
+};
+
+// shader külső paraméterei
+uniform mat4 viewProj;
+uniform int firstInstance; // a rajzolás első példánya a pufferben
+
+void main()
+{
+	InstanceTransform instance = instances[ firstInstance + gl_InstanceID ];
+
+	gl_Position = viewProj * instance.world * vec4( vs_in_pos, 1 );
+	vs_out_pos  = (instance.world   * vec4(vs_in_pos,  1)).xyz;
+	vs_out_norm = (instance.worldIT * vec4(vs_in_norm, 0)).xyz;
+
+	vs_out_tex = vs_in_tex;
+}
\ No newline at end of file
@@ -0,0 +1,16 @@
+#version 430
+
+// mélységi menetek (árnyéktérkép): csak a pozíció jön a VBO-ból
+layout( location = 0 ) in vec3 vs_in_pos;
+
+// a mélységi előmenet után GL_EQUAL teszttel rajzolunk, a színező shaderekkel azonos pozíció kell
+invariant gl_Position;
+
+// shader külső paraméterei
+uniform mat4 world;
+uniform mat4 viewProj;
+
+void main()
+{
+	gl_Position = viewProj * world * vec4( vs_in_pos, 1 );
+}
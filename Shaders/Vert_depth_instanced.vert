@@ -0,0 +1,27 @@
+#version 430
+
+// mélységi menetek példányosított rajzoláshoz: csak a pozíció jön a VBO-ból
+layout( location = 0 ) in vec3 vs_in_pos;
+
+invariant gl_Position;
+
+// példányonkénti transzformációk (InstanceBatcher)
+struct InstanceTransform
+{
+	mat4 world;
+	mat4 worldIT;
+};
+
+layout( std430, binding = 0 ) readonly buffer InstanceTransforms
+{
+	InstanceTransform instances[];
+};
+
+// shader külső paraméterei
+uniform mat4 viewProj;
+uniform int firstInstance; // a rajzolás első példánya a pufferben
+
+void main()
+{
+	gl_Position = viewProj * instances[ firstInstance + gl_InstanceID ].world * vec4( vs_in_pos, 1 );
+}
@@ -1,19 +1,56 @@
-#version 430
-
-// shader külső paraméterei - most a három transzformációs mátrixot külön-külön vesszük át
-uniform mat4 world;
-uniform mat4 viewProj;
-
-const uint MAX_POINT_COUNT = 20;
-
-uniform vec3 positions[MAX_POINT_COUNT];
-uniform vec3 color=vec3(1.0,0.0,1.0);
-
-out vec3 vs_out_color;
-
-void main()
-{
-	gl_Position = viewProj * world * vec4(positions[gl_VertexID],1.0);
-	vs_out_color = color;
-}
-
+#version 430
+
+// shader külső paraméterei
+uniform mat4 world;
+uniform mat4 viewProj;
+
+// a pályák pontjai (TrajectoryBuffer): xyz a pozíció, w a pálya indexe
+layout( std430, binding = 1 ) readonly buffer TrajectoryPoints
+{
+	vec4 points[];
+};
+
+// pályánkénti szín
+layout( std430, binding = 2 ) readonly buffer TrajectoryColors
+{
+	vec4 colors[];
+};
+
+// szalag: pontonként két csúcs, a képernyőn ribbonWidth pixel szélesen, különben vonal
+uniform bool ribbon = false;
+uniform float ribbonWidth = 4.0;
+uniform vec2 viewportSize = vec2( 1.0 );
+
+out vec3 vs_out_color;
+
+vec4 ToClip( vec4 point )
+{
+	return viewProj * world * vec4( point.xyz, 1.0 );
+}
+
+void main()
+{
+	int index = ribbon ? gl_VertexID / 2 : gl_VertexID;
+	vec4 point = points[ index ];
+
+	vs_out_color = colors[ int( point.w ) ].rgb;
+	gl_Position = ToClip( point );
+
+	if ( !ribbon ) return;
+
+	// a szomszédok ugyanabból a pályából, a végeken önmaga
+	vec4 previous = index > 0 ? points[ index - 1 ] : point;
+	vec4 next = index + 1 < points.length() ? points[ index + 1 ] : point;
+	if ( previous.w != point.w ) previous = point;
+	if ( next.w != point.w ) next = point;
+
+	// a képernyőn vett irányra merőlegesen toljuk el a csúcsot, pixelben mérve
+	vec4 previousClip = ToClip( previous );
+	vec4 nextClip = ToClip( next );
+	vec2 direction = ( nextClip.xy / nextClip.w - previousClip.xy / previousClip.w ) * viewportSize;
+	direction = dot( direction, direction ) > 1e-12 ? normalize( direction ) : vec2( 1.0, 0.0 );
+
+	vec2 offset = vec2( -direction.y, direction.x ) * ribbonWidth / viewportSize;
+	float side = ( gl_VertexID & 1 ) == 0 ? -1.0 : 1.0;
+	gl_Position.xy += side * offset * gl_Position.w;
+}
\ No newline at end of file
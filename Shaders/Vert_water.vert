@@ -12,20 +12,30 @@ uniform mat4 world;
 uniform mat4 worldIT;
 uniform mat4 viewProj;
 
-uniform float ElapsedTimeInSec = 0.0;
+// az óceán elmozdulás térképe (CPU FFT, Water): x - vízszintes elmozdulás x, y - magasság, z - vízszintes elmozdulás z
+// patchSize méterenként ismétlődik, a rács gridSize méteres
+uniform sampler2D displacementMap;
+uniform float patchSize = 64.0;
+uniform float gridSize = 256.0;
+uniform float choppiness = 1.0;
+
+// a mélység előmenet (Frag_depth) és a színező menet pontosan ugyanazt a mélységet kell adja
+invariant gl_Position;
 
 vec3 GetPos(float u, float v)
 {
-	vec3 pos = vec3(-10.0, 0.0, 10.0) + vec3( 20.0, 0.0, -20.0) * vec3(u, 0.0, v);
-	pos.y = sin( pos.z + ElapsedTimeInSec );
+	vec3 pos = vec3(-0.5, 0.0, 0.5) * gridSize + vec3( gridSize, 0.0, -gridSize) * vec3(u, 0.0, v);
+	vec3 displacement = textureLod( displacementMap, pos.xz / patchSize, 0.0 ).xyz;
 
-	return pos;
+	return pos + displacement * vec3( choppiness, 1.0, choppiness );
 }
 
 vec3 GetNorm(float u, float v)
 {
-	vec3 du = GetPos(u + 0.01, v) - GetPos(u - 0.01, v);
-	vec3 dv = GetPos(u, v + 0.01) - GetPos(u, v - 0.01);
+	// egy FFT texelnyi lépés a rácson
+	float e = patchSize / ( float( textureSize( displacementMap, 0 ).x ) * gridSize );
+	vec3 du = GetPos(u + e, v) - GetPos(u - e, v);
+	vec3 dv = GetPos(u, v + e) - GetPos(u, v - e);
 
 	return normalize(cross(du, dv));
 }
@@ -38,4 +48,4 @@ void main()
 	vs_out_pos = (world * vec4(vs_in_pos, 1)).xyz;
 	vs_out_norm = (worldIT * vec4(GetNorm(vs_in_uv.x, vs_in_uv.y), 0)).xyz;
 	vs_out_tex = vs_in_uv;
-}
\ No newline at end of file
+}
@@ -0,0 +1,353 @@
+#include "BVH.h"
+
+#include <cmath>
+
+void BVH::Clear()
+{
+	m_nodes.clear();
+	m_primitiveIndices.clear();
+	m_primitiveBounds.clear();
+	m_primitiveLeaf.clear();
+}
+
+void BVH::Build( const std::vector<AABB>& primitiveBounds )
+{
+	Clear();
+	if ( primitiveBounds.empty() ) return;
+
+	const std::uint32_t primitiveCount = static_cast<std::uint32_t>( primitiveBounds.size() );
+
+	m_primitiveBounds = primitiveBounds;
+	m_primitiveLeaf.assign( primitiveCount, 0 );
+	m_primitiveIndices.resize( primitiveCount );
+	for ( std::uint32_t i = 0; i < primitiveCount; ++i ) m_primitiveIndices[ i ] = i;
+
+	std::vector<glm::vec3> centroids( primitiveCount );
+	for ( std::uint32_t i = 0; i < primitiveCount; ++i ) centroids[ i ] = primitiveBounds[ i ].Center();
+
+	// a binary tree with at most one primitive per leaf has 2N - 1 nodes
+	m_nodes.reserve( 2 * primitiveCount - 1 );
+
+	Node root;
+	root.leftFirst = 0;
+	root.count = primitiveCount;
+	m_nodes.push_back( root );
+	UpdateLeafBounds( 0 );
+
+	// explicit stack instead of recursion, the depth is limited by MAX_DEPTH
+	struct BuildEntry
+	{
+		std::uint32_t node;
+		int depth;
+	};
+	std::vector<BuildEntry> stack = { { 0, 0 } };
+	while ( !stack.empty() )
+	{
+		const BuildEntry entry = stack.back();
+		stack.pop_back();
+
+		if ( entry.depth < MAX_DEPTH && SplitNode( entry.node, centroids ) )
+		{
+			const std::uint32_t left = m_nodes[ entry.node ].leftFirst;
+			stack.push_back( { left,     entry.depth + 1 } );
+			stack.push_back( { left + 1, entry.depth + 1 } );
+		}
+		else
+		{
+			const Node& leaf = m_nodes[ entry.node ];
+			for ( std::uint32_t slot = leaf.leftFirst; slot < leaf.leftFirst + leaf.count; ++slot )
+				m_primitiveLeaf[ m_primitiveIndices[ slot ] ] = entry.node;
+		}
+	}
+}
+
+bool BVH::SplitNode( std::uint32_t nodeIndex, const std::vector<glm::vec3>& centroids )
+{
+	const std::uint32_t first = m_nodes[ nodeIndex ].leftFirst;
+	const std::uint32_t count = m_nodes[ nodeIndex ].count;
+	if ( count <= MAX_LEAF_SIZE ) return false;
+
+	AABB centroidBounds;
+	for ( std::uint32_t slot = first; slot < first + count; ++slot )
+		centroidBounds.Extend( centroids[ m_primitiveIndices[ slot ] ] );
+
+	struct Bin
+	{
+		AABB bounds;
+		std::uint32_t count = 0;
+	};
+
+	// SAH with unit traversal and intersection cost: split if
+	// area * 1 + leftArea * leftCount + rightArea * rightCount < area * count
+	const float nodeArea = m_nodes[ nodeIndex ].bounds.SurfaceArea();
+	float bestCost = nodeArea * ( count - 1 );
+	int bestAxis = -1;
+	int bestSplit = 0;
+
+	for ( int axis = 0; axis < 3; ++axis )
+	{
+		const float axisMin = centroidBounds.min[ axis ];
+		const float axisExtent = centroidBounds.max[ axis ] - axisMin;
+		if ( axisExtent <= 0.0f ) continue;
+
+		const float binScale = SAH_BIN_COUNT / axisExtent;
+
+		std::array<Bin, SAH_BIN_COUNT> bins;
+		for ( std::uint32_t slot = first; slot < first + count; ++slot )
+		{
+			const std::uint32_t primitive = m_primitiveIndices[ slot ];
+			const int bin = std::min( static_cast<int>( ( centroids[ primitive ][ axis ] - axisMin ) * binScale ), SAH_BIN_COUNT - 1 );
+			bins[ bin ].bounds.Extend( m_primitiveBounds[ primitive ] );
+			++bins[ bin ].count;
+		}
+
+		// sweep from the right to get the cost of the right side of every split plane
+		std::array<float, SAH_BIN_COUNT> rightCost;
+		AABB rightBounds;
+		std::uint32_t rightCount = 0;
+		for ( int bin = SAH_BIN_COUNT - 1; bin > 0; --bin )
+		{
+			rightBounds.Extend( bins[ bin ].bounds );
+			rightCount += bins[ bin ].count;
+			rightCost[ bin ] = rightBounds.SurfaceArea() * rightCount;
+		}
+
+		AABB leftBounds;
+		std::uint32_t leftCount = 0;
+		for ( int split = 1; split < SAH_BIN_COUNT; ++split )
+		{
+			leftBounds.Extend( bins[ split - 1 ].bounds );
+			leftCount += bins[ split - 1 ].count;
+
+			const float cost = leftBounds.SurfaceArea() * leftCount + rightCost[ split ];
+			if ( leftCount > 0 && leftCount < count && cost < bestCost )
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = split;
+			}
+		}
+	}
+
+	if ( bestAxis == -1 ) return false;
+
+	// partition the slots by the chosen plane
+	const float axisMin = centroidBounds.min[ bestAxis ];
+	const float binScale = SAH_BIN_COUNT / ( centroidBounds.max[ bestAxis ] - axisMin );
+	const auto middle = std::partition( m_primitiveIndices.begin() + first, m_primitiveIndices.begin() + first + count,
+		[ & ]( std::uint32_t primitive )
+		{
+			const int bin = std::min( static_cast<int>( ( centroids[ primitive ][ bestAxis ] - axisMin ) * binScale ), SAH_BIN_COUNT - 1 );
+			return bin < bestSplit;
+		} );
+	const std::uint32_t leftCount = static_cast<std::uint32_t>( middle - ( m_primitiveIndices.begin() + first ) );
+	if ( leftCount == 0 || leftCount == count ) return false;
+
+	const std::uint32_t leftIndex = static_cast<std::uint32_t>( m_nodes.size() );
+
+	Node left;
+	left.leftFirst = first;
+	left.count = leftCount;
+	left.parent = nodeIndex;
+
+	Node right;
+	right.leftFirst = first + leftCount;
+	right.count = count - leftCount;
+	right.parent = nodeIndex;
+
+	m_nodes.push_back( left );
+	m_nodes.push_back( right );
+	UpdateLeafBounds( leftIndex );
+	UpdateLeafBounds( leftIndex + 1 );
+
+	m_nodes[ nodeIndex ].leftFirst = leftIndex;
+	m_nodes[ nodeIndex ].count = 0;
+
+	return true;
+}
+
+void BVH::UpdateLeafBounds( std::uint32_t nodeIndex )
+{
+	Node& node = m_nodes[ nodeIndex ];
+
+	node.bounds = AABB();
+	for ( std::uint32_t slot = node.leftFirst; slot < node.leftFirst + node.count; ++slot )
+		node.bounds.Extend( m_primitiveBounds[ m_primitiveIndices[ slot ] ] );
+}
+
+void BVH::Refit( const std::vector<AABB>& primitiveBounds )
+{
+	m_primitiveBounds = primitiveBounds;
+
+	// the children are always created after their parent, so a reverse pass visits them first
+	for ( std::size_t i = m_nodes.size(); i-- > 0; )
+	{
+		Node& node = m_nodes[ i ];
+		if ( node.IsLeaf() )
+		{
+			UpdateLeafBounds( static_cast<std::uint32_t>( i ) );
+		}
+		else
+		{
+			node.bounds = m_nodes[ node.leftFirst ].bounds;
+			node.bounds.Extend( m_nodes[ node.leftFirst + 1 ].bounds );
+		}
+	}
+}
+
+void BVH::RefitPrimitive( std::uint32_t primitive, const AABB& bounds )
+{
+	m_primitiveBounds[ primitive ] = bounds;
+
+	std::uint32_t nodeIndex = m_primitiveLeaf[ primitive ];
+	UpdateLeafBounds( nodeIndex );
+
+	for ( nodeIndex = m_nodes[ nodeIndex ].parent; nodeIndex != INVALID_INDEX; nodeIndex = m_nodes[ nodeIndex ].parent )
+	{
+		Node& node = m_nodes[ nodeIndex ];
+
+		AABB newBounds = m_nodes[ node.leftFirst ].bounds;
+		newBounds.Extend( m_nodes[ node.leftFirst + 1 ].bounds );
+		if ( newBounds.min == node.bounds.min && newBounds.max == node.bounds.max ) break;
+
+		node.bounds = newBounds;
+	}
+}
+
+void BVH::CullFrustum( const Frustum& frustum, std::vector<std::uint32_t>& visiblePrimitives ) const
+{
+	visiblePrimitives.clear();
+	if ( m_nodes.empty() ) return;
+
+	m_cullBatch.Clear();
+	m_cullCandidates.clear();
+
+	constexpr std::uint32_t ALL_PLANES = ( 1u << Frustum::PLANE_COUNT ) - 1;
+
+	struct CullEntry
+	{
+		std::uint32_t node;
+		std::uint32_t planeMask; // the planes the node is not known to be inside of
+	};
+	std::array<CullEntry, MAX_DEPTH + 2> stack;
+	int stackSize = 0;
+	stack[ stackSize++ ] = { 0, ALL_PLANES };
+
+	while ( stackSize > 0 )
+	{
+		const CullEntry entry = stack[ --stackSize ];
+		const Node& node = m_nodes[ entry.node ];
+
+		const glm::vec3 center = node.bounds.Center();
+		const glm::vec3 extents = node.bounds.Extents();
+
+		std::uint32_t planeMask = entry.planeMask;
+		bool outside = false;
+		for ( int p = 0; p < Frustum::PLANE_COUNT && !outside; ++p )
+		{
+			if ( !( planeMask & ( 1u << p ) ) ) continue;
+
+			const glm::vec4& plane = frustum.planes[ p ];
+			const float distance = glm::dot( glm::vec3( plane ), center ) + plane.w;
+			const float radius = glm::dot( glm::abs( glm::vec3( plane ) ), extents );
+
+			if ( distance + radius < 0.0f ) outside = true;
+			else if ( distance - radius >= 0.0f ) planeMask &= ~( 1u << p ); // completely inside of this plane
+		}
+		if ( outside ) continue;
+
+		if ( node.IsLeaf() )
+		{
+			for ( std::uint32_t slot = node.leftFirst; slot < node.leftFirst + node.count; ++slot )
+			{
+				const std::uint32_t primitive = m_primitiveIndices[ slot ];
+				if ( planeMask == 0 )
+				{
+					visiblePrimitives.push_back( primitive );
+				}
+				else
+				{
+					m_cullCandidates.push_back( primitive );
+					m_cullBatch.Add( m_primitiveBounds[ primitive ] );
+				}
+			}
+			continue;
+		}
+
+		stack[ stackSize++ ] = { node.leftFirst + 1, planeMask };
+		stack[ stackSize++ ] = { node.leftFirst,     planeMask };
+	}
+
+	if ( m_cullCandidates.empty() ) return;
+
+	CullAABBBatch( frustum, m_cullBatch, m_cullVisibility );
+	for ( std::size_t i = 0; i < m_cullCandidates.size(); ++i )
+	{
+		if ( m_cullVisibility[ i ] ) visiblePrimitives.push_back( m_cullCandidates[ i ] );
+	}
+}
+
+void MeshBVH::BuildFromCorners( const std::vector<glm::vec3>& corners )
+{
+	const std::size_t triangleCount = corners.size() / 3;
+
+	std::vector<AABB> triangleBounds( triangleCount );
+	for ( std::size_t i = 0; i < triangleCount; ++i )
+	{
+		triangleBounds[ i ].Extend( corners[ 3 * i + 0 ] );
+		triangleBounds[ i ].Extend( corners[ 3 * i + 1 ] );
+		triangleBounds[ i ].Extend( corners[ 3 * i + 2 ] );
+	}
+
+	m_bvh.Build( triangleBounds );
+
+	m_triangles.resize( triangleCount );
+	for ( std::uint32_t slot = 0; slot < triangleCount; ++slot )
+	{
+		const std::uint32_t triangle = m_bvh.PrimitiveAt( slot );
+		const glm::vec3& v0 = corners[ 3 * triangle + 0 ];
+		m_triangles[ slot ] = { v0, corners[ 3 * triangle + 1 ] - v0, corners[ 3 * triangle + 2 ] - v0 };
+	}
+}
+
+bool MeshBVH::Intersect( const Ray& ray, RayHit& hit ) const
+{
+	std::uint32_t hitSlot = BVH::INVALID_INDEX;
+	float hitU = 0.0f, hitV = 0.0f;
+
+	float tMax = hit.t;
+	m_bvh.Traverse( ray, tMax, [ & ]( std::uint32_t slot, float& tClosest )
+	{
+		// Moller-Trumbore, both sides
+		const Triangle& triangle = m_triangles[ slot ];
+
+		const glm::vec3 p = glm::cross( ray.direction, triangle.edge2 );
+		const float determinant = glm::dot( triangle.edge1, p );
+		if ( std::abs( determinant ) < 1e-12f ) return;
+
+		const float invDeterminant = 1.0f / determinant;
+		const glm::vec3 s = ray.origin - triangle.v0;
+		const float u = glm::dot( s, p ) * invDeterminant;
+		if ( u < 0.0f || u > 1.0f ) return;
+
+		const glm::vec3 q = glm::cross( s, triangle.edge1 );
+		const float v = glm::dot( ray.direction, q ) * invDeterminant;
+		if ( v < 0.0f || u + v > 1.0f ) return;
+
+		const float t = glm::dot( triangle.edge2, q ) * invDeterminant;
+		if ( t < 0.0f || t >= tClosest ) return;
+
+		tClosest = t;
+		hitSlot = slot;
+		hitU = u;
+		hitV = v;
+	} );
+
+	if ( hitSlot == BVH::INVALID_INDEX ) return false;
+
+	hit.t = tMax;
+	hit.triangle = m_bvh.PrimitiveAt( hitSlot );
+	hit.u = hitU;
+	hit.v = hitV;
+	return true;
+}
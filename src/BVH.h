@@ -0,0 +1,189 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Bounds.h"
+#include "Frustum.h"
+#include "GLUtils.hpp"
+
+struct Ray
+{
+	glm::vec3 origin = glm::vec3( 0.0f );
+	glm::vec3 direction = glm::vec3( 0.0f, 0.0f, -1.0f ); // not necessarily unit length, t is measured in its units
+};
+
+// Entry distance of the ray into the box, or infinity if it misses it (or enters it only after tMax).
+inline float IntersectRayAABB( const AABB& box, const glm::vec3& origin, const glm::vec3& invDirection, float tMax )
+{
+	const glm::vec3 t1 = ( box.min - origin ) * invDirection;
+	const glm::vec3 t2 = ( box.max - origin ) * invDirection;
+
+	const float tEnter = std::max( { std::min( t1.x, t2.x ), std::min( t1.y, t2.y ), std::min( t1.z, t2.z ), 0.0f } );
+	const float tExit  = std::min( { std::max( t1.x, t2.x ), std::max( t1.y, t2.y ), std::max( t1.z, t2.z ), tMax } );
+
+	return tEnter <= tExit ? tEnter : std::numeric_limits<float>::infinity();
+}
+
+// Bounding volume hierarchy over arbitrary primitives given by their bounds.
+// Built top-down with the binned surface area heuristic. The topology is kept when the primitives move,
+// Refit() / RefitPrimitive() only update the bounds.
+class BVH
+{
+public:
+	static constexpr std::uint32_t INVALID_INDEX = ~0u;
+
+	struct Node
+	{
+		AABB bounds;
+		std::uint32_t leftFirst = 0; // interior: index of the left child (the right one follows it), leaf: first slot
+		std::uint32_t count = 0;     // number of primitives, 0 for interior nodes
+		std::uint32_t parent = INVALID_INDEX;
+
+		bool IsLeaf() const { return count > 0; }
+	};
+
+	void Build( const std::vector<AABB>& primitiveBounds );
+	void Clear();
+
+	// Every primitive moved: bottom-up pass over all nodes.
+	void Refit( const std::vector<AABB>& primitiveBounds );
+	// One primitive moved: only its leaf and the ancestors, until a node's bounds stop changing.
+	void RefitPrimitive( std::uint32_t primitive, const AABB& bounds );
+
+	// Hierarchical culling: subtrees completely inside the frustum are accepted without further plane tests,
+	// the primitives of the partially visible leaves are tested in one SIMD batch.
+	void CullFrustum( const Frustum& frustum, std::vector<std::uint32_t>& visiblePrimitives ) const;
+
+	// Closest-hit traversal, nearer child first. intersectSlot( slot, tMax ) has to test the primitive
+	// PrimitiveAt( slot ) and decrease tMax on a closer hit.
+	template <typename IntersectSlot>
+	void Traverse( const Ray& ray, float& tMax, IntersectSlot intersectSlot ) const;
+
+	bool IsEmpty() const { return m_nodes.empty(); }
+	const AABB& Bounds() const { return m_nodes.front().bounds; }
+	std::size_t PrimitiveCount() const { return m_primitiveIndices.size(); }
+	// The primitives are reordered so that every leaf references a contiguous range of slots.
+	std::uint32_t PrimitiveAt( std::uint32_t slot ) const { return m_primitiveIndices[ slot ]; }
+
+	static constexpr std::uint32_t MAX_LEAF_SIZE = 4;
+	static constexpr int SAH_BIN_COUNT = 16;
+	static constexpr int MAX_DEPTH = 64;
+
+private:
+	std::vector<Node> m_nodes;
+	std::vector<std::uint32_t> m_primitiveIndices;
+	std::vector<AABB> m_primitiveBounds;
+	std::vector<std::uint32_t> m_primitiveLeaf;
+
+	// scratch buffers of CullFrustum, kept to avoid allocations every frame
+	mutable AABBBatch m_cullBatch;
+	mutable std::vector<std::uint32_t> m_cullCandidates;
+	mutable std::vector<std::uint8_t> m_cullVisibility;
+
+	bool SplitNode( std::uint32_t nodeIndex, const std::vector<glm::vec3>& centroids );
+	void UpdateLeafBounds( std::uint32_t nodeIndex );
+};
+
+template <typename IntersectSlot>
+void BVH::Traverse( const Ray& ray, float& tMax, IntersectSlot intersectSlot ) const
+{
+	if ( m_nodes.empty() ) return;
+
+	const glm::vec3 invDirection = 1.0f / ray.direction;
+
+	struct StackEntry
+	{
+		std::uint32_t node;
+		float tEnter;
+	};
+	std::array<StackEntry, MAX_DEPTH + 1> stack;
+	int stackSize = 0;
+
+	const float tRoot = IntersectRayAABB( m_nodes[ 0 ].bounds, ray.origin, invDirection, tMax );
+	if ( tRoot == std::numeric_limits<float>::infinity() ) return;
+	stack[ stackSize++ ] = { 0, tRoot };
+
+	while ( stackSize > 0 )
+	{
+		const StackEntry entry = stack[ --stackSize ];
+		// a closer hit was found since the node was pushed
+		if ( entry.tEnter > tMax ) continue;
+
+		const Node& node = m_nodes[ entry.node ];
+		if ( node.IsLeaf() )
+		{
+			for ( std::uint32_t slot = node.leftFirst; slot < node.leftFirst + node.count; ++slot )
+				intersectSlot( slot, tMax );
+			continue;
+		}
+
+		std::uint32_t nearChild = node.leftFirst;
+		std::uint32_t farChild  = node.leftFirst + 1;
+		float tNear = IntersectRayAABB( m_nodes[ nearChild ].bounds, ray.origin, invDirection, tMax );
+		float tFar  = IntersectRayAABB( m_nodes[ farChild  ].bounds, ray.origin, invDirection, tMax );
+		if ( tFar < tNear )
+		{
+			std::swap( nearChild, farChild );
+			std::swap( tNear, tFar );
+		}
+
+		// the near child is pushed last, so it is processed first
+		if ( tFar  != std::numeric_limits<float>::infinity() ) stack[ stackSize++ ] = { farChild, tFar };
+		if ( tNear != std::numeric_limits<float>::infinity() ) stack[ stackSize++ ] = { nearChild, tNear };
+	}
+}
+
+struct RayHit
+{
+	float t = std::numeric_limits<float>::infinity(); // also the maximal distance searched
+	std::uint32_t triangle = BVH::INVALID_INDEX;       // index of the triangle in the index array (index / 3)
+	float u = 0.0f;                                    // barycentric coordinates of the hit
+	float v = 0.0f;
+
+	bool IsHit() const { return triangle != BVH::INVALID_INDEX; }
+};
+
+// Triangle level BVH of a mesh, for picking and other CPU ray queries in model space.
+class MeshBVH
+{
+public:
+	template <typename VertexT>
+	void Build( const MeshObject<VertexT>& mesh );
+
+	// Closest hit closer than hit.t, hit is only modified on success.
+	bool Intersect( const Ray& ray, RayHit& hit ) const;
+
+	bool IsEmpty() const { return m_bvh.IsEmpty(); }
+	const AABB& Bounds() const { return m_bvh.Bounds(); }
+
+private:
+	// in slot order, so a leaf reads a contiguous range; precomputed edges for Moller-Trumbore
+	struct Triangle
+	{
+		glm::vec3 v0;
+		glm::vec3 edge1;
+		glm::vec3 edge2;
+	};
+
+	BVH m_bvh;
+	std::vector<Triangle> m_triangles;
+
+	void BuildFromCorners( const std::vector<glm::vec3>& corners );
+};
+
+template <typename VertexT>
+void MeshBVH::Build( const MeshObject<VertexT>& mesh )
+{
+	std::vector<glm::vec3> corners;
+	corners.reserve( mesh.indexArray.size() );
+	for ( GLuint index : mesh.indexArray )
+		corners.push_back( VertexPosition( mesh.vertexArray[ index ] ) );
+
+	BuildFromCorners( corners );
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <glm/glm.hpp>
+
+// Axis aligned bounding box. The default box is empty (min > max), Extend() grows it.
+struct AABB
+{
+	glm::vec3 min = glm::vec3(  std::numeric_limits<float>::max() );
+	glm::vec3 max = glm::vec3( -std::numeric_limits<float>::max() );
+
+	bool IsEmpty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+
+	glm::vec3 Center()  const { return 0.5f * ( min + max ); }
+	glm::vec3 Extents() const { return 0.5f * ( max - min ); }
+
+	void Extend( const glm::vec3& point )
+	{
+		min = glm::min( min, point );
+		max = glm::max( max, point );
+	}
+
+	void Extend( const AABB& box )
+	{
+		min = glm::min( min, box.min );
+		max = glm::max( max, box.max );
+	}
+
+	float SurfaceArea() const
+	{
+		if ( IsEmpty() ) return 0.0f;
+
+		const glm::vec3 size = max - min;
+		return 2.0f * ( size.x * size.y + size.y * size.z + size.z * size.x );
+	}
+};
+
+struct BoundingSphere
+{
+	glm::vec3 center = glm::vec3( 0.0f );
+	float radius = 0.0f;
+};
+
+// Bounds of the transformed box (Arvo): the extents are transformed by the absolute value of the linear part.
+inline AABB TransformAABB( const AABB& box, const glm::mat4& transform )
+{
+	if ( box.IsEmpty() ) return box;
+
+	const glm::vec3 center = glm::vec3( transform * glm::vec4( box.Center(), 1.0f ) );
+	const glm::vec3 extents = box.Extents();
+
+	glm::vec3 newExtents( 0.0f );
+	for ( int row = 0; row < 3; ++row )
+	{
+		newExtents[ row ] = std::abs( transform[ 0 ][ row ] ) * extents.x
+						  + std::abs( transform[ 1 ][ row ] ) * extents.y
+						  + std::abs( transform[ 2 ][ row ] ) * extents.z;
+	}
+
+	AABB result;
+	result.min = center - newExtents;
+	result.max = center + newExtents;
+	return result;
+}
+
+// Sphere around the centre of the box, its radius is the distance of the farthest point.
+template <typename PositionIt, typename GetPosition>
+BoundingSphere BoundingSphereFromPoints( const AABB& box, PositionIt first, PositionIt last, GetPosition getPosition )
+{
+	BoundingSphere sphere;
+	sphere.center = box.Center();
+
+	float radius2 = 0.0f;
+	for ( ; first != last; ++first )
+	{
+		const glm::vec3 d = getPosition( *first ) - sphere.center;
+		radius2 = std::max( radius2, glm::dot( d, d ) );
+	}
+	sphere.radius = std::sqrt( radius2 );
+
+	return sphere;
+}
@@ -5,52 +5,95 @@
 
 Camera::Camera()
 {
-	SetView( glm::vec3(0.0f,0.0f,0.0f), glm::vec3(0.0f,0.0f,-1.0f), glm::vec3(0.0f,1.0f,0.0f));
+	m_eye	  = glm::dvec3( 0.0, 0.0, 0.0 );
+	m_at	  = glm::dvec3( 0.0, 0.0, -1.0 );
+	m_worldUp = glm::vec3( 0.0f, 1.0f, 0.0f );
+
+	m_projMatrix = glm::perspective( m_angle, m_aspect, m_zNear, m_zFar );
+	UpdateView();
 }
 
 Camera::~Camera()
 {
 }
 
-void Camera::SetView(glm::vec3 _eye, glm::vec3 _at, glm::vec3 _worldUp)
+void Camera::SetView(glm::dvec3 _eye, glm::dvec3 _at, glm::vec3 _worldUp)
 {
+	if ( _eye == m_eye && _at == m_at && _worldUp == m_worldUp ) return;
+
 	m_eye	   = _eye;
 	m_at	   = _at;
 	m_worldUp  = _worldUp;
 
-	m_viewMatrix = glm::lookAt( m_eye, m_at, m_worldUp );
+	UpdateView();
+}
+
+void Camera::UpdateView() noexcept
+{
+	m_view = glm::lookAt( m_eye, m_at, glm::dvec3( m_worldUp ) );
+	m_viewMatrix = glm::mat4( m_view );
+
+	// without the translation: the eye is the origin
+	glm::dmat4 relativeView = m_view;
+	relativeView[ 3 ] = glm::dvec4( 0.0, 0.0, 0.0, 1.0 );
+	m_relativeViewMatrix = glm::mat4( relativeView );
+
+	UpdateViewProj();
 }
 
 void Camera::SetProj(float _angle, float _aspect, float _zn, float _zf)
 {
+	if ( _angle == m_angle && _aspect == m_aspect && _zn == m_zNear && _zf == m_zFar ) return;
+
 	m_angle  = _angle;
 	m_aspect = _aspect;
 	m_zNear  = _zn;
 	m_zFar   = _zf;
 
-	m_projMatrix = glm::perspective( m_angle, m_aspect, m_zNear, m_zFar );
+	UpdateProj();
 }
 
 void Camera::SetAngle( const float _angle ) noexcept
 {
+	if ( _angle == m_angle ) return;
+
 	m_angle = _angle;
-	m_projMatrix = glm::perspective( m_angle, m_aspect, m_zNear, m_zFar );
+	UpdateProj();
 }
 
 void Camera::SetAspect( const float _aspect ) noexcept
 {
+	if ( _aspect == m_aspect ) return;
+
 	m_aspect = _aspect;
-	m_projMatrix = glm::perspective( m_angle, m_aspect, m_zNear, m_zFar );
+	UpdateProj();
 }
 
 void Camera::SetZNear( const float _zn ) noexcept
 {
+	if ( _zn == m_zNear ) return;
+
 	m_zNear = _zn;
-	m_projMatrix = glm::perspective( m_angle, m_aspect, m_zNear, m_zFar );
+	UpdateProj();
 }
 
 void Camera::SetZFar( const float _zf ) noexcept
 {
+	if ( _zf == m_zFar ) return;
+
 	m_zFar = _zf;
+	UpdateProj();
+}
+
+void Camera::UpdateProj() noexcept
+{
 	m_projMatrix = glm::perspective( m_angle, m_aspect, m_zNear, m_zFar );
+	UpdateViewProj();
+}
+
+void Camera::UpdateViewProj() noexcept
+{
+	// the product in double, the translation of the view matrix can be large
+	m_viewProjMatrix = glm::mat4( glm::dmat4( m_projMatrix ) * m_view );
+	m_relativeViewProjMatrix = m_projMatrix * m_relativeViewMatrix;
 }
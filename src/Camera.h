@@ -2,6 +2,10 @@
 
 #include <glm/glm.hpp>
 
+// The eye and the look at point are in double precision, so the camera can be placed far from the origin.
+// Besides the usual matrices there are camera-relative ones: their origin is the eye, the view matrix is only
+// a rotation, and the positions given to them (world position - eye, see RelativeTo) stay small in float.
+// The matrices are computed when the inputs change, the getters only return them.
 class Camera
 {
 public:
@@ -9,16 +13,22 @@ public:
 
 	~Camera();
 
-	inline glm::vec3 GetEye() const { return m_eye; }
-	inline glm::vec3 GetAt() const { return m_at; }
+	inline glm::dvec3 GetEye() const { return m_eye; }
+	inline glm::dvec3 GetAt() const { return m_at; }
 	inline glm::vec3 GetWorldUp() const { return m_worldUp; }
 
-	inline glm::mat4 GetViewMatrix() const { return m_viewMatrix; }
-	inline glm::mat4 GetProj() const { return m_projMatrix; }
-	inline glm::mat4 GetViewProj() const { return m_projMatrix * m_viewMatrix; }
+	inline const glm::mat4& GetViewMatrix() const { return m_viewMatrix; }
+	inline const glm::mat4& GetProj() const { return m_projMatrix; }
+	inline const glm::mat4& GetViewProj() const { return m_viewProjMatrix; }
 
+	// Camera-relative matrices, for positions given relative to the eye.
+	inline const glm::mat4& GetRelativeViewMatrix() const { return m_relativeViewMatrix; }
+	inline const glm::mat4& GetRelativeViewProj() const { return m_relativeViewProjMatrix; }
+	// The world position relative to the eye, the difference is taken in double precision.
+	inline glm::vec3 RelativeTo( const glm::dvec3& position ) const { return glm::vec3( position - m_eye ); }
 
-	void SetView(glm::vec3 _eye, glm::vec3 _at, glm::vec3 _up);
+	// Recomputes the matrices only if the parameters differ from the current ones.
+	void SetView(glm::dvec3 _eye, glm::dvec3 _at, glm::vec3 _up);
 
 	inline float GetAngle() const { return m_angle; }
 	void SetAngle( const float _angle ) noexcept;
@@ -32,18 +42,23 @@ public:
 	void SetProj(float _angle, float _aspect, float _zn, float _zf); 
 
 private:
+	void UpdateView() noexcept;
+	void UpdateProj() noexcept;
+	void UpdateViewProj() noexcept;
 
 	// The camera position.
-	glm::vec3	m_eye;
+	glm::dvec3	m_eye;
 
 	// The vector pointing upwards
 	glm::vec3	m_worldUp;
 
 	// The camera look at point.
-	glm::vec3	m_at;
+	glm::dvec3	m_at;
 
-	// The view matrix of the camera
+	// The view matrix of the camera, in double precision, and its float copies
+	glm::dmat4	m_view;
 	glm::mat4	m_viewMatrix;
+	glm::mat4	m_relativeViewMatrix;
 
 	// projection parameters
 	float m_zNear =    0.01f;
@@ -54,5 +69,9 @@ private:
 
 	// projection matrix
 	glm::mat4	m_projMatrix;
+
+	// the cached products of the projection and the view matrices
+	glm::mat4	m_viewProjMatrix;
+	glm::mat4	m_relativeViewProjMatrix;
 };
 
@@ -20,7 +20,7 @@ void CameraManipulator::SetCamera( Camera* _pCamera )
 
     // Set the initial spherical coordinates.
     m_center = m_pCamera->GetAt();
-    glm::vec3 ToAim = m_center - m_pCamera->GetEye();
+    glm::vec3 ToAim = glm::vec3( m_center - m_pCamera->GetEye() );
 
     m_distance = glm::length( ToAim );
 
@@ -40,7 +40,7 @@ void CameraManipulator::Update( float _deltaTime )
                              cosf(m_v), 
                              sinf(m_u) * sinf(m_v) );
 	// Az új kamera pozíciót a nézési irány és a távolság alapján számoljuk ki.
-    glm::vec3 eye = m_center - m_distance * lookDirection;
+    glm::dvec3 eye = m_center - glm::dvec3( m_distance * lookDirection );
 
 	// Az új felfelé irány a világ felfelével legyen azonos.
     glm::vec3 up = m_pCamera->GetWorldUp();
@@ -55,8 +55,8 @@ void CameraManipulator::Update( float _deltaTime )
     glm::vec3 deltaPosition = ( m_goForward * forward + m_goRight * right + m_goUp * up ) * m_speed * _deltaTime;
 
 	// Az új kamera pozíciót és nézési cél pozíciót beállítjuk.
-    eye += deltaPosition;
-    m_center += deltaPosition;   
+    eye += glm::dvec3( deltaPosition );
+    m_center += glm::dvec3( deltaPosition );   
 
 	// Frissítjük a kamerát az új pozícióval és nézési iránnyal.
     m_pCamera->SetView( eye, m_center, m_pCamera->GetWorldUp() );
@@ -40,8 +40,8 @@ private:
 	// The distance of the look at point from the camera. 
 	float	m_distance = 0.0f;
 
-	// The center of model sphere.
-	glm::vec3 m_center = glm::vec3( 0.0f );
+	// The center of model sphere, in double precision like the camera position.
+	glm::dvec3 m_center = glm::dvec3( 0.0 );
 
 	// The traversal speed of the camera
 	float m_speed = 16.0f;
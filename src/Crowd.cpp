@@ -0,0 +1,195 @@
+#include "Crowd.h"
+
+#include <cmath>
+
+#include <glm/gtx/transform.hpp>
+
+#include "Frustum.h"
+
+static float Hash01( std::uint32_t x )
+{
+	x ^= x >> 16; x *= 0x7feb352dU;
+	x ^= x >> 15; x *= 0x846ca68bU;
+	x ^= x >> 16;
+	return static_cast<float>( x & 0xFFFFFF ) / static_cast<float>( 0x1000000 );
+}
+
+void Crowd::AgentTransform( std::uint32_t index, double time, glm::vec3& position, glm::quat& rotation )
+{
+	// concentric rings around the scene, every agent with its own speed and phase
+	const float radius = 5.0f + 0.35f * static_cast<float>( index % 48 );
+	const float speed = 0.2f + 0.3f * Hash01( 2 * index );
+	const float phase = glm::two_pi<float>() * Hash01( 2 * index + 1 );
+
+	// the time is reduced in double, the float angle stays precise however long the program runs
+	const float angle = static_cast<float>( std::fmod( speed * time, glm::two_pi<double>() ) ) + phase;
+	const float height = 2.0f + 0.5f * std::sin( 3.0f * angle ) + 0.1f * static_cast<float>( index / 48 % 16 );
+
+	position = glm::vec3( radius * std::cos( angle ), height, radius * std::sin( angle ) );
+
+	// facing the direction of motion (the tangent of the circle)
+	rotation = glm::angleAxis( -angle, glm::vec3( 0.0f, 1.0f, 0.0f ) );
+}
+
+template <typename Function>
+void Crowd::For( std::size_t count, Function fn )
+{
+	if ( m_input.parallel )
+		m_jobs->ParallelFor( count, GRAIN_SIZE, fn );
+	else
+		fn( std::size_t( 0 ), count );
+}
+
+void Crowd::Init( JobSystem& jobs )
+{
+	m_jobs = &jobs;
+
+	m_graph.Clear();
+
+	const FrameGraph::PassHandle simulate = m_graph.AddPass( "CrowdSimulate", [ this ]()
+	{
+		Frame& frame = m_frames[ m_buildFrame ];
+		frame.transforms.Resize( m_input.count );
+
+		For( frame.transforms.Size(), [ this, &frame ]( std::size_t begin, std::size_t end )
+		{
+			for ( std::size_t i = begin; i < end; ++i )
+			{
+				glm::vec3 position;
+				glm::quat rotation;
+				AgentTransform( static_cast<std::uint32_t>( i ), m_input.time, position, rotation );
+				frame.transforms.SetTRS( static_cast<TransformHandle>( i ), glm::dvec3( position ), rotation, glm::vec3( AGENT_SCALE ) );
+			}
+
+			// the ranges are disjoint, the matrices of each are built in SIMD batches
+			frame.transforms.Update( begin, end );
+		} );
+	} );
+
+	const FrameGraph::PassHandle cull = m_graph.AddPass( "CrowdCull", [ this ]()
+	{
+		Frame& frame = m_frames[ m_buildFrame ];
+		frame.visible.resize( frame.transforms.Size() );
+
+		const Frustum frustum = Frustum::FromViewProj( m_input.viewProj );
+		For( frame.transforms.Size(), [ this, &frame, &frustum ]( std::size_t begin, std::size_t end )
+		{
+			for ( std::size_t i = begin; i < end; ++i )
+			{
+				BoundingSphere sphere;
+				sphere.center = glm::vec3( frame.transforms.RelativeWorld( static_cast<TransformHandle>( i ), m_input.origin ) * glm::vec4( m_input.meshBounds.center, 1.0f ) );
+				sphere.radius = m_input.meshBounds.radius * AGENT_SCALE;
+				frame.visible[ i ] = frustum.Intersects( sphere ) ? 1 : 0;
+			}
+		} );
+	}, { simulate } );
+
+	m_graph.AddPass( "CrowdRecord", [ this ]()
+	{
+		Frame& frame = m_frames[ m_buildFrame ];
+		frame.commands.Clear();
+		frame.instances.clear();
+		frame.origin = m_input.origin;
+
+		DrawCommand command;
+		command.vaoID = m_input.vaoID;
+		command.depthVaoID = m_input.depthVaoID;
+		command.count = m_input.indexCount;
+		command.textureID = m_input.textureID;
+		command.samplerID = m_input.samplerID;
+		frame.mesh = command;
+
+		if ( m_input.instanced )
+		{
+			frame.instances.reserve( frame.transforms.Size() );
+			for ( TransformHandle agent = 0; agent < frame.transforms.Size(); ++agent )
+			{
+				if ( frame.visible[ agent ] ) frame.instances.push_back( { frame.transforms.RelativeWorld( agent, frame.origin ), frame.transforms.NormalMatrix( agent ) } );
+			}
+		}
+		else
+		{
+			frame.commands.Reserve( frame.transforms.Size() );
+			for ( TransformHandle agent = 0; agent < frame.transforms.Size(); ++agent )
+			{
+				if ( !frame.visible[ agent ] ) continue;
+
+				command.world = frame.transforms.RelativeWorld( agent, frame.origin );
+				command.worldIT = frame.transforms.NormalMatrix( agent );
+				frame.commands.Add( command );
+			}
+		}
+
+		frame.buildTimeMs = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - m_kickTime ).count();
+	}, { cull } );
+
+	// the shadow casters do not depend on the camera culling, they are recorded next to it
+	m_graph.AddPass( "CrowdRecordCasters", [ this ]()
+	{
+		Frame& frame = m_frames[ m_buildFrame ];
+		frame.casterCommands.Clear();
+		frame.casterInstances.clear();
+		if ( !m_input.shadowCasters ) return;
+
+		if ( m_input.instanced )
+		{
+			frame.casterInstances.resize( frame.transforms.Size() );
+			For( frame.transforms.Size(), [ this, &frame ]( std::size_t begin, std::size_t end )
+			{
+				for ( std::size_t i = begin; i < end; ++i )
+				{
+					const TransformHandle agent = static_cast<TransformHandle>( i );
+					frame.casterInstances[ i ] = { frame.transforms.RelativeWorld( agent, m_input.origin ), frame.transforms.NormalMatrix( agent ) };
+				}
+			} );
+		}
+		else
+		{
+			// depth only: no texture, no normal matrix
+			DrawCommand command;
+			command.vaoID = m_input.vaoID;
+			command.depthVaoID = m_input.depthVaoID;
+			command.count = m_input.indexCount;
+
+			frame.casterCommands.Reserve( frame.transforms.Size() );
+			for ( TransformHandle agent = 0; agent < frame.transforms.Size(); ++agent )
+			{
+				command.world = frame.transforms.RelativeWorld( agent, m_input.origin );
+				frame.casterCommands.Add( command );
+			}
+		}
+	}, { simulate } );
+}
+
+void Crowd::Clean()
+{
+	Finish();
+
+	for ( Frame& frame : m_frames ) frame = Frame{};
+	m_graph.Clear();
+	m_jobs = nullptr;
+}
+
+void Crowd::Finish()
+{
+	if ( !m_building ) return;
+
+	m_jobs->Wait( m_counter );
+	m_building = false;
+
+	std::swap( m_submitFrame, m_buildFrame );
+}
+
+void Crowd::Kick( const CrowdFrameInput& input )
+{
+	Finish();
+
+	m_input = input;
+	m_kickTime = std::chrono::steady_clock::now();
+	m_building = true;
+
+	if ( m_input.parallel )
+		m_graph.Execute( *m_jobs, m_counter );
+	else
+		m_graph.ExecuteSerial();
+}
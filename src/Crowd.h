@@ -0,0 +1,99 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Bounds.h"
+#include "FrameGraph.h"
+#include "InstanceBatcher.h"
+#include "JobSystem.h"
+#include "TransformSystem.h"
+#include "RenderCommandList.h"
+
+// Everything the workers need for one frame, copied at Kick() so the main thread may change the scene meanwhile.
+struct CrowdFrameInput
+{
+	// camera-relative: the world matrices of the frame are relative to origin
+	glm::dvec3 origin = glm::dvec3( 0.0 );
+	glm::mat4 viewProj = glm::mat4( 1.0f );
+	double time = 0.0;
+	int count = 0;
+	bool parallel = true;
+	bool instanced = true; // record instance transforms instead of draw commands
+	bool shadowCasters = false; // also record every agent without culling, for the shadow maps
+
+	GLuint vaoID = 0;
+	GLuint depthVaoID = 0;
+	GLsizei indexCount = 0;
+	GLuint textureID = 0;
+	GLuint samplerID = 0;
+	BoundingSphere meshBounds;
+};
+
+// Many animated copies of a mesh. The frame is built by a frame graph (simulate -> cull -> record commands,
+// and simulate -> record the shadow casters)
+// on the job system, one frame ahead: while the workers build frame N+1, the main thread submits frame N.
+class Crowd
+{
+public:
+	void Init( JobSystem& jobs );
+	void Clean();
+
+	// Waits for the frame started by the previous Kick(), it becomes the submitted one.
+	void Finish();
+	// Starts building the next frame.
+	void Kick( const CrowdFrameInput& input );
+
+	// The last finished frame: one command per visible agent, or their transforms in instanced mode.
+	const RenderCommandList& Commands() const { return m_frames[ m_submitFrame ].commands; }
+	const std::vector<InstanceTransform>& Instances() const { return m_frames[ m_submitFrame ].instances; }
+	// Every agent regardless of the camera, the same way (only if CrowdFrameInput::shadowCasters was set):
+	// the agents outside of the view may still cast shadows into it.
+	const RenderCommandList& CasterCommands() const { return m_frames[ m_submitFrame ].casterCommands; }
+	const std::vector<InstanceTransform>& CasterInstances() const { return m_frames[ m_submitFrame ].casterInstances; }
+	// The mesh of the agents for the instance batches.
+	const DrawCommand& Mesh() const { return m_frames[ m_submitFrame ].mesh; }
+	std::size_t VisibleCount() const { return Commands().Size() + Instances().size(); }
+	std::size_t AgentCount() const { return m_frames[ m_submitFrame ].transforms.Size(); }
+	double BuildTimeMs() const { return m_frames[ m_submitFrame ].buildTimeMs; }
+	// The origin the commands and instances are relative to (the camera position at the Kick()).
+	const glm::dvec3& Origin() const { return m_frames[ m_submitFrame ].origin; }
+
+	// Deterministic, only depends on the index and the time. The scale is AGENT_SCALE.
+	static void AgentTransform( std::uint32_t index, double time, glm::vec3& position, glm::quat& rotation );
+
+	static constexpr float AGENT_SCALE = 0.25f;
+	static constexpr std::size_t GRAIN_SIZE = 512;
+
+private:
+	struct Frame
+	{
+		TransformSystem transforms;
+		std::vector<std::uint8_t> visible;
+		RenderCommandList commands;
+		std::vector<InstanceTransform> instances;
+		RenderCommandList casterCommands;
+		std::vector<InstanceTransform> casterInstances;
+		DrawCommand mesh;
+		glm::dvec3 origin = glm::dvec3( 0.0 );
+		double buildTimeMs = 0.0;
+	};
+
+	Frame m_frames[ 2 ];
+	int m_submitFrame = 0;
+	int m_buildFrame = 1;
+	bool m_building = false;
+
+	JobSystem* m_jobs = nullptr;
+	FrameGraph m_graph;
+	JobCounter m_counter;
+	CrowdFrameInput m_input;
+	std::chrono::steady_clock::time_point m_kickTime;
+
+	template <typename Function>
+	void For( std::size_t count, Function fn );
+};
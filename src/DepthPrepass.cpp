@@ -0,0 +1,117 @@
+#include "DepthPrepass.h"
+
+void DepthPrepassSelector::Init()
+{
+	for ( PendingFrame& pending : m_pendingFrames )
+	{
+		glCreateQueries( GL_TIMESTAMP, 3, pending.timestamps );
+		glCreateQueries( GL_SAMPLES_PASSED, 1, &pending.samplesQuery );
+		pending.inFlight = false;
+	}
+	m_currentFrame = 0;
+	m_frameIndex = 0;
+	m_costMs = { -1.0, -1.0 };
+	m_probeFramesLeft = 0;
+}
+
+void DepthPrepassSelector::Clean()
+{
+	for ( PendingFrame& pending : m_pendingFrames )
+	{
+		glDeleteQueries( 3, pending.timestamps );
+		glDeleteQueries( 1, &pending.samplesQuery );
+		pending = PendingFrame();
+	}
+}
+
+bool DepthPrepassSelector::Resolve( PendingFrame& pending )
+{
+	// the end of the shading is the last timestamp of the frame, the samples query ended right before it
+	GLuint timestampAvailable = GL_FALSE, samplesAvailable = GL_FALSE;
+	glGetQueryObjectuiv( pending.timestamps[ 2 ], GL_QUERY_RESULT_AVAILABLE, &timestampAvailable );
+	glGetQueryObjectuiv( pending.samplesQuery, GL_QUERY_RESULT_AVAILABLE, &samplesAvailable );
+	if ( timestampAvailable == GL_FALSE || samplesAvailable == GL_FALSE ) return false;
+
+	GLuint64 begin = 0, end = 0, samples = 0;
+	glGetQueryObjectui64v( pending.timestamps[ 0 ], GL_QUERY_RESULT, &begin );
+	glGetQueryObjectui64v( pending.timestamps[ 2 ], GL_QUERY_RESULT, &end );
+	glGetQueryObjectui64v( pending.samplesQuery, GL_QUERY_RESULT, &samples );
+	pending.inFlight = false;
+
+	// running average; the first measurement replaces the unknown value
+	const double ms = static_cast<double>( end - begin ) / 1.0e6;
+	double& cost = m_costMs[ pending.prepass ? 1 : 0 ];
+	cost = cost < 0.0 ? ms : 0.9 * cost + 0.1 * ms;
+	m_lastMeasured[ pending.prepass ? 1 : 0 ] = m_frameIndex;
+
+	if ( pending.pixelCount > 0 )
+		m_overdraw = static_cast<double>( samples ) / static_cast<double>( pending.pixelCount );
+
+	if ( pending.prepass )
+	{
+		GLuint64 prepassEnd = 0;
+		glGetQueryObjectui64v( pending.timestamps[ 1 ], GL_QUERY_RESULT, &prepassEnd );
+		m_prepassMs = static_cast<double>( prepassEnd - begin ) / 1.0e6;
+	}
+	return true;
+}
+
+bool DepthPrepassSelector::BeginFrame( DepthPrepassMode mode, std::uint64_t pixelCount )
+{
+	++m_frameIndex;
+
+	PendingFrame& pending = m_pendingFrames[ m_currentFrame ];
+	// the GPU is more than FRAME_LATENCY frames behind: the slot is needed, its sample is skipped
+	if ( pending.inFlight && !Resolve( pending ) ) pending.inFlight = false;
+
+	bool prepass = mode == DepthPrepassMode::ON;
+	if ( mode == DepthPrepassMode::AUTO )
+	{
+		if ( m_probeFramesLeft > 0 )
+		{
+			--m_probeFramesLeft;
+			prepass = !m_autoPrepass;
+		}
+		else
+		{
+			// the cheaper variant, with some hysteresis against flickering between the two
+			const double current = m_costMs[ m_autoPrepass ? 1 : 0 ];
+			const double other = m_costMs[ m_autoPrepass ? 0 : 1 ];
+			if ( other >= 0.0 && current >= 0.0 && other < current * ( 1.0 - HYSTERESIS ) )
+				m_autoPrepass = !m_autoPrepass;
+
+			// the other variant has not been measured recently: measure it for a few frames
+			const int otherIndex = m_autoPrepass ? 0 : 1;
+			if ( other < 0.0 || m_frameIndex - m_lastMeasured[ otherIndex ] > PROBE_INTERVAL )
+			{
+				m_lastMeasured[ otherIndex ] = m_frameIndex; // do not start the probe again before it is read back
+				m_probeFramesLeft = PROBE_FRAMES;
+			}
+			prepass = m_autoPrepass;
+		}
+	}
+
+	pending.prepass = prepass;
+	pending.pixelCount = pixelCount;
+	glQueryCounter( pending.timestamps[ 0 ], GL_TIMESTAMP );
+	return prepass;
+}
+
+void DepthPrepassSelector::EndPrepass()
+{
+	glQueryCounter( m_pendingFrames[ m_currentFrame ].timestamps[ 1 ], GL_TIMESTAMP );
+}
+
+void DepthPrepassSelector::BeginShading()
+{
+	glBeginQuery( GL_SAMPLES_PASSED, m_pendingFrames[ m_currentFrame ].samplesQuery );
+}
+
+void DepthPrepassSelector::EndShading()
+{
+	glEndQuery( GL_SAMPLES_PASSED );
+	glQueryCounter( m_pendingFrames[ m_currentFrame ].timestamps[ 2 ], GL_TIMESTAMP );
+
+	m_pendingFrames[ m_currentFrame ].inFlight = true;
+	m_currentFrame = ( m_currentFrame + 1 ) % FRAME_LATENCY;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <GL/glew.h>
+
+enum class DepthPrepassMode : int
+{
+	OFF,
+	ON,
+	AUTO, // the cheaper of the two by the measured GPU time
+};
+
+// Measures the opaque geometry of the frame with and without a depth-only pre-pass, and picks one in AUTO mode.
+// The pre-pass writes the depth with position only draws, the shading pass then runs with GL_EQUAL and without
+// depth writes, so the lighting shader runs once per pixel. Whether this pays off depends on the overdraw and
+// on the cost of a fragment, so both variants are timed with GL_TIMESTAMP queries (read back FRAME_LATENCY frames
+// later, never waiting for the GPU: a frame whose queries are still not available is skipped), and the shaded
+// fragments are counted with GL_SAMPLES_PASSED.
+class DepthPrepassSelector
+{
+public:
+	void Init();
+	void Clean();
+
+	// Called right before the opaque geometry, returns whether it should use the pre-pass.
+	// pixelCount: size of the framebuffer, for the overdraw.
+	bool BeginFrame( DepthPrepassMode mode, std::uint64_t pixelCount );
+	void EndPrepass();
+	void BeginShading();
+	// the end of the opaque geometry of the frame
+	void EndShading();
+
+	// Shaded fragments per pixel of the opaque pass (1 or less with the pre-pass), of the last resolved frame.
+	double Overdraw() const { return m_overdraw; }
+	// Average GPU time of the opaque geometry (pre-pass included), negative if not measured yet.
+	double CostMs( bool prepass ) const { return m_costMs[ prepass ? 1 : 0 ]; }
+	// GPU time of the pre-pass alone, of the last resolved frame with pre-pass.
+	double PrepassMs() const { return m_prepassMs; }
+
+private:
+	static constexpr int FRAME_LATENCY = 3;
+	// in AUTO mode the other variant is measured again this often, the scene may have changed since
+	static constexpr std::uint64_t PROBE_INTERVAL = 240;
+	static constexpr int PROBE_FRAMES = 4;
+	// switch only if the other variant is cheaper by this ratio
+	static constexpr double HYSTERESIS = 0.05;
+
+	struct PendingFrame
+	{
+		// begin, end of the pre-pass (if any), end of the shading
+		GLuint timestamps[ 3 ] = {};
+		GLuint samplesQuery = 0;
+		std::uint64_t pixelCount = 0;
+		bool prepass = false;
+		bool inFlight = false;
+	};
+
+	std::array<PendingFrame, FRAME_LATENCY> m_pendingFrames;
+	int m_currentFrame = 0;
+
+	std::uint64_t m_frameIndex = 0;
+	std::array<double, 2> m_costMs = { -1.0, -1.0 };
+	std::array<std::uint64_t, 2> m_lastMeasured = {};
+	bool m_autoPrepass = false; // the current choice of AUTO
+	int m_probeFramesLeft = 0;
+	double m_overdraw = 0.0;
+	double m_prepassMs = 0.0;
+
+	// False (and nothing is read) if the queries of the frame are not available yet.
+	bool Resolve( PendingFrame& pending );
+};
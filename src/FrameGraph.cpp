@@ -0,0 +1,56 @@
+#include "FrameGraph.h"
+
+FrameGraph::PassHandle FrameGraph::AddPass( const char* name, std::function<void()> execute, std::initializer_list<PassHandle> dependencies )
+{
+	const PassHandle handle = static_cast<PassHandle>( m_passes.size() );
+
+	auto pass = std::make_unique<Pass>();
+	pass->name = name;
+	pass->execute = std::move( execute );
+	pass->dependencyCount = static_cast<int>( dependencies.size() );
+	m_passes.push_back( std::move( pass ) );
+
+	for ( PassHandle dependency : dependencies )
+		m_passes[ dependency ]->successors.push_back( handle );
+
+	return handle;
+}
+
+void FrameGraph::Clear()
+{
+	m_passes.clear();
+}
+
+void FrameGraph::Execute( JobSystem& jobs, JobCounter& counter )
+{
+	for ( auto& pass : m_passes )
+		pass->pendingDependencies.store( pass->dependencyCount, std::memory_order_relaxed );
+
+	for ( PassHandle handle = 0; handle < m_passes.size(); ++handle )
+	{
+		if ( m_passes[ handle ]->dependencyCount == 0 )
+			SchedulePass( jobs, handle, counter );
+	}
+}
+
+void FrameGraph::SchedulePass( JobSystem& jobs, PassHandle handle, JobCounter& counter )
+{
+	jobs.Schedule( [ this, &jobs, &counter, handle ]()
+	{
+		Pass& pass = *m_passes[ handle ];
+		pass.execute();
+
+		// the successors are scheduled before this job is finished, so the counter cannot reach zero in between
+		for ( PassHandle successor : pass.successors )
+		{
+			if ( m_passes[ successor ]->pendingDependencies.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+				SchedulePass( jobs, successor, counter );
+		}
+	}, &counter );
+}
+
+void FrameGraph::ExecuteSerial()
+{
+	for ( auto& pass : m_passes )
+		pass->execute();
+}
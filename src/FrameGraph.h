@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+#include "JobSystem.h"
+
+// Per-frame CPU work as a dependency graph of passes. The graph is recorded once, Execute() schedules every pass
+// on the job system as soon as all of its dependencies finished. Passes may use JobSystem::ParallelFor internally.
+class FrameGraph
+{
+public:
+	using PassHandle = std::uint32_t;
+
+	// The dependencies have to be added earlier, so the insertion order is a valid serial order.
+	PassHandle AddPass( const char* name, std::function<void()> execute, std::initializer_list<PassHandle> dependencies = {} );
+	void Clear();
+
+	// Returns immediately, counter reaches zero when the last pass finished.
+	void Execute( JobSystem& jobs, JobCounter& counter );
+	// Every pass on the calling thread, in insertion order.
+	void ExecuteSerial();
+
+	std::size_t PassCount() const { return m_passes.size(); }
+
+private:
+	struct Pass
+	{
+		const char* name = nullptr;
+		std::function<void()> execute;
+		std::vector<PassHandle> successors;
+		int dependencyCount = 0;
+		std::atomic<int> pendingDependencies{ 0 };
+	};
+
+	std::vector<std::unique_ptr<Pass>> m_passes;
+
+	void SchedulePass( JobSystem& jobs, PassHandle pass, JobCounter& counter );
+};
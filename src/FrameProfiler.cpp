@@ -0,0 +1,304 @@
+#include "FrameProfiler.h"
+
+#include <SDL2/SDL_log.h>
+#include <imgui.h>
+
+#include <algorithm>
+#include <fstream>
+
+void FrameProfiler::Init()
+{
+	m_startTime = std::chrono::steady_clock::now();
+	m_history.reserve( HISTORY_SIZE );
+}
+
+void FrameProfiler::Clean()
+{
+	for ( PendingFrame& pending : m_pendingFrames )
+	{
+		if ( !pending.queries.empty() )
+			glDeleteQueries( static_cast<GLsizei>( pending.queries.size() ), pending.queries.data() );
+		pending = PendingFrame{};
+	}
+	m_currentFrame = nullptr;
+	m_openZones.clear();
+	m_history.clear();
+	m_historyNext = 0;
+	m_droppedFrames = 0;
+}
+
+double FrameProfiler::NowMs() const
+{
+	return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - m_startTime ).count();
+}
+
+void FrameProfiler::BeginFrame()
+{
+	PendingFrame& pending = m_pendingFrames[ m_frameIndex % FRAME_LATENCY ];
+
+	// the slot was used FRAME_LATENCY frames ago, its timestamps are usually available by now; if not, the slot is
+	// needed anyway, so the frame is dropped rather than waited for
+	if ( pending.inFlight && !Resolve( pending ) )
+	{
+		pending.inFlight = false;
+		++m_droppedFrames;
+	}
+
+	pending.frame.index = m_frameIndex++;
+	pending.frame.zones.clear();
+	pending.frame.counters.clear();
+	pending.inFlight = true;
+
+	m_currentFrame = &pending;
+	m_openZones.clear();
+
+	BeginZone( "Frame" );
+}
+
+void FrameProfiler::EndFrame()
+{
+	if ( m_currentFrame == nullptr ) return;
+
+	while ( !m_openZones.empty() ) EndZone();
+
+	m_currentFrame = nullptr;
+}
+
+void FrameProfiler::BeginZone( const char* name )
+{
+	if ( m_currentFrame == nullptr ) return;
+
+	std::vector<Zone>& zones = m_currentFrame->frame.zones;
+	std::vector<GLuint>& queries = m_currentFrame->queries;
+
+	const std::size_t zoneIndex = zones.size();
+	if ( queries.size() < 2 * ( zoneIndex + 1 ) )
+	{
+		// the query pool of the slot only grows, after the first few frames no queries are created
+		const std::size_t oldSize = queries.size();
+		queries.resize( std::max<std::size_t>( 2 * ( zoneIndex + 1 ), 2 * oldSize ) );
+		glCreateQueries( GL_TIMESTAMP, static_cast<GLsizei>( queries.size() - oldSize ), queries.data() + oldSize );
+	}
+
+	Zone zone;
+	zone.name  = name;
+	zone.depth = static_cast<int>( m_openZones.size() );
+	zone.cpuBeginMs = NowMs();
+	zones.push_back( zone );
+
+	// GL_TIME_ELAPSED queries cannot be nested, timestamps can
+	glQueryCounter( queries[ 2 * zoneIndex ], GL_TIMESTAMP );
+
+	m_openZones.push_back( static_cast<int>( zoneIndex ) );
+}
+
+void FrameProfiler::EndZone()
+{
+	if ( m_currentFrame == nullptr || m_openZones.empty() ) return;
+
+	const int zoneIndex = m_openZones.back();
+	m_openZones.pop_back();
+
+	glQueryCounter( m_currentFrame->queries[ 2 * zoneIndex + 1 ], GL_TIMESTAMP );
+	m_currentFrame->frame.zones[ zoneIndex ].cpuEndMs = NowMs();
+}
+
+void FrameProfiler::SetCounter( const char* name, double value )
+{
+	if ( m_currentFrame == nullptr ) return;
+
+	for ( Counter& counter : m_currentFrame->frame.counters )
+	{
+		if ( counter.name == name )
+		{
+			counter.value = value;
+			return;
+		}
+	}
+	m_currentFrame->frame.counters.push_back( { name, value } );
+}
+
+bool FrameProfiler::Resolve( PendingFrame& pending )
+{
+	std::vector<Zone>& zones = pending.frame.zones;
+	if ( zones.empty() )
+	{
+		pending.inFlight = false;
+		return true;
+	}
+
+	// the end of the frame zone is the last timestamp of the frame, the queries complete in order
+	GLuint available = GL_FALSE;
+	glGetQueryObjectuiv( pending.queries[ 1 ], GL_QUERY_RESULT_AVAILABLE, &available );
+	if ( available == GL_FALSE ) return false;
+
+	pending.inFlight = false;
+
+	GLuint64 frameBegin = 0;
+	glGetQueryObjectui64v( pending.queries[ 0 ], GL_QUERY_RESULT, &frameBegin );
+
+	for ( std::size_t i = 0; i < zones.size(); ++i )
+	{
+		GLuint64 begin = 0, end = 0;
+		glGetQueryObjectui64v( pending.queries[ 2 * i ],     GL_QUERY_RESULT, &begin );
+		glGetQueryObjectui64v( pending.queries[ 2 * i + 1 ], GL_QUERY_RESULT, &end );
+
+		zones[ i ].gpuBeginMs = static_cast<double>( begin - frameBegin ) / 1.0e6;
+		zones[ i ].gpuEndMs   = static_cast<double>( end   - frameBegin ) / 1.0e6;
+	}
+
+	if ( m_paused ) return true;
+
+	if ( m_history.size() < HISTORY_SIZE )
+	{
+		m_history.push_back( pending.frame );
+	}
+	else
+	{
+		// copy into the old frame so its zone vector is reused
+		m_history[ m_historyNext ].index = pending.frame.index;
+		m_history[ m_historyNext ].zones.assign( zones.begin(), zones.end() );
+		m_history[ m_historyNext ].counters.assign( pending.frame.counters.begin(), pending.frame.counters.end() );
+	}
+	m_historyNext = ( m_historyNext + 1 ) % HISTORY_SIZE;
+	return true;
+}
+
+const FrameProfiler::Frame* FrameProfiler::LastFrame() const
+{
+	if ( m_history.empty() ) return nullptr;
+
+	return &m_history[ ( m_historyNext + HISTORY_SIZE - 1 ) % HISTORY_SIZE ];
+}
+
+void FrameProfiler::RenderGUI()
+{
+	if ( ImGui::Begin( "Profiler" ) )
+	{
+		const Frame* lastFrame = LastFrame();
+		if ( lastFrame == nullptr )
+		{
+			ImGui::TextUnformatted( "Waiting for the first frames..." );
+			ImGui::End();
+			return;
+		}
+
+		// oldest to newest
+		std::vector<float> cpuMs, gpuMs;
+		cpuMs.reserve( m_history.size() );
+		gpuMs.reserve( m_history.size() );
+		const std::size_t oldest = m_history.size() < HISTORY_SIZE ? 0 : m_historyNext;
+		for ( std::size_t i = 0; i < m_history.size(); ++i )
+		{
+			const Zone& frameZone = m_history[ ( oldest + i ) % m_history.size() ].zones[ 0 ];
+			cpuMs.push_back( static_cast<float>( frameZone.cpuEndMs - frameZone.cpuBeginMs ) );
+			gpuMs.push_back( static_cast<float>( frameZone.gpuEndMs - frameZone.gpuBeginMs ) );
+		}
+
+		const float cpuMax = *std::max_element( cpuMs.begin(), cpuMs.end() );
+		const float gpuMax = *std::max_element( gpuMs.begin(), gpuMs.end() );
+		const float scaleMax = std::max( { cpuMax, gpuMax, 1000.0f / 60.0f } );
+
+		ImGui::Text( "CPU %.2f ms (max %.2f)", cpuMs.back(), cpuMax );
+		ImGui::PlotHistogram( "##cpu", cpuMs.data(), static_cast<int>( cpuMs.size() ), 0, nullptr, 0.0f, scaleMax, ImVec2( 0.0f, 60.0f ) );
+		ImGui::Text( "GPU %.2f ms (max %.2f)", gpuMs.back(), gpuMax );
+		ImGui::PlotHistogram( "##gpu", gpuMs.data(), static_cast<int>( gpuMs.size() ), 0, nullptr, 0.0f, scaleMax, ImVec2( 0.0f, 60.0f ) );
+
+		if ( m_droppedFrames > 0 )
+			ImGui::Text( "Dropped %llu frames (GPU more than %d frames behind)", static_cast<unsigned long long>( m_droppedFrames ), FRAME_LATENCY );
+
+		ImGui::Checkbox( "Pause", &m_paused );
+		ImGui::SameLine();
+		if ( ImGui::Button( "Export trace" ) )
+		{
+			if ( ExportChromeTrace( "profile_trace.json" ) )
+				SDL_LogInfo( SDL_LOG_CATEGORY_APPLICATION, "[Profiler] Trace written to profile_trace.json" );
+			else
+				SDL_LogMessage( SDL_LOG_CATEGORY_ERROR, SDL_LOG_PRIORITY_ERROR, "[Profiler] Could not write profile_trace.json" );
+		}
+
+		if ( ImGui::BeginTable( "zones", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV ) )
+		{
+			ImGui::TableSetupColumn( "Zone" );
+			ImGui::TableSetupColumn( "CPU ms" );
+			ImGui::TableSetupColumn( "GPU ms" );
+			ImGui::TableHeadersRow();
+
+			for ( const Zone& zone : lastFrame->zones )
+			{
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::Indent( zone.depth * 10.0f + 1.0f );
+				ImGui::TextUnformatted( zone.name );
+				ImGui::Unindent( zone.depth * 10.0f + 1.0f );
+				ImGui::TableNextColumn();
+				ImGui::Text( "%.3f", zone.cpuEndMs - zone.cpuBeginMs );
+				ImGui::TableNextColumn();
+				ImGui::Text( "%.3f", zone.gpuEndMs - zone.gpuBeginMs );
+			}
+			ImGui::EndTable();
+		}
+
+		if ( !lastFrame->counters.empty() && ImGui::BeginTable( "counters", 2, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV ) )
+		{
+			ImGui::TableSetupColumn( "Counter" );
+			ImGui::TableSetupColumn( "Value" );
+			ImGui::TableHeadersRow();
+
+			for ( const Counter& counter : lastFrame->counters )
+			{
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted( counter.name );
+				ImGui::TableNextColumn();
+				ImGui::Text( "%g", counter.value );
+			}
+			ImGui::EndTable();
+		}
+	}
+	ImGui::End();
+}
+
+bool FrameProfiler::ExportChromeTrace( const std::filesystem::path& fileName ) const
+{
+	std::ofstream trace( fileName );
+	if ( !trace ) return false;
+
+	// tid 1: CPU, tid 2: GPU. The GPU clock is not synchronized with the CPU one,
+	// so the GPU zones of a frame are placed relative to the CPU begin of the frame.
+	trace << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+		  << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n"
+		  << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+
+	trace.setf( std::ios::fixed );
+	trace.precision( 3 );
+
+	const std::size_t oldest = m_history.size() < HISTORY_SIZE ? 0 : m_historyNext;
+	for ( std::size_t i = 0; i < m_history.size(); ++i )
+	{
+		const Frame& frame = m_history[ ( oldest + i ) % m_history.size() ];
+		const double frameBeginUs = frame.zones[ 0 ].cpuBeginMs * 1000.0;
+
+		for ( const Zone& zone : frame.zones )
+		{
+			trace << ",\n{\"name\":\"" << zone.name << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":1"
+				  << ",\"ts\":" << zone.cpuBeginMs * 1000.0
+				  << ",\"dur\":" << ( zone.cpuEndMs - zone.cpuBeginMs ) * 1000.0
+				  << ",\"args\":{\"frame\":" << frame.index << "}}";
+			trace << ",\n{\"name\":\"" << zone.name << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":2"
+				  << ",\"ts\":" << frameBeginUs + zone.gpuBeginMs * 1000.0
+				  << ",\"dur\":" << ( zone.gpuEndMs - zone.gpuBeginMs ) * 1000.0
+				  << ",\"args\":{\"frame\":" << frame.index << "}}";
+		}
+
+		for ( const Counter& counter : frame.counters )
+		{
+			trace << ",\n{\"name\":\"" << counter.name << "\",\"ph\":\"C\",\"pid\":1"
+				  << ",\"ts\":" << frameBeginUs
+				  << ",\"args\":{\"value\":" << counter.value << "}}";
+		}
+	}
+	trace << "\n]}\n";
+
+	return static_cast<bool>( trace );
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include <GL/glew.h>
+
+// CPU/GPU frame profiler with nestable named zones.
+// CPU times come from std::chrono::steady_clock, GPU times from GL_TIMESTAMP queries. The queries of a frame
+// are read back FRAME_LATENCY frames later, so the profiler never makes the CPU wait for the GPU: if the GPU is
+// even further behind, the frame is dropped instead of waiting for its queries.
+class FrameProfiler
+{
+public:
+	struct Zone
+	{
+		const char* name = nullptr; // has to be a string literal, it is not copied
+		int depth = 0;
+
+		double cpuBeginMs = 0.0; // since the start of the profiler
+		double cpuEndMs   = 0.0;
+		double gpuBeginMs = 0.0; // since the GPU begin of the frame
+		double gpuEndMs   = 0.0;
+	};
+
+	struct Counter
+	{
+		const char* name = nullptr; // has to be a string literal, it is not copied
+		double value = 0.0;
+	};
+
+	struct Frame
+	{
+		std::uint64_t index = 0;
+		std::vector<Zone> zones; // zones[ 0 ] is the whole frame, the rest in the order they were opened
+		std::vector<Counter> counters;
+	};
+
+	void Init();
+	void Clean();
+
+	void BeginFrame();
+	void EndFrame();
+
+	// Zones opened outside of BeginFrame/EndFrame are ignored.
+	void BeginZone( const char* name );
+	void EndZone();
+
+	// Per-frame statistics (e.g. draw calls), shown next to the zones. Ignored outside of BeginFrame/EndFrame.
+	void SetCounter( const char* name, double value );
+
+	// Frame time histograms and the zones of the last resolved frame.
+	void RenderGUI();
+
+	// Writes the recorded history in the Chrome trace event format (chrome://tracing, Perfetto).
+	bool ExportChromeTrace( const std::filesystem::path& fileName ) const;
+
+private:
+	static constexpr int FRAME_LATENCY = 3;
+	static constexpr std::size_t HISTORY_SIZE = 240;
+
+	struct PendingFrame
+	{
+		Frame frame;
+		std::vector<GLuint> queries; // begin and end timestamp of each zone
+		bool inFlight = false;
+	};
+
+	std::array<PendingFrame, FRAME_LATENCY> m_pendingFrames;
+	PendingFrame* m_currentFrame = nullptr;
+	std::vector<int> m_openZones;
+
+	// ring buffer of the resolved frames
+	std::vector<Frame> m_history;
+	std::size_t m_historyNext = 0;
+
+	std::chrono::steady_clock::time_point m_startTime;
+	std::uint64_t m_frameIndex = 0;
+	std::uint64_t m_droppedFrames = 0; // the GPU was more than FRAME_LATENCY frames behind
+	bool m_paused = false;
+
+	double NowMs() const;
+	// False (and nothing is read) if the timestamps of the frame are not available yet.
+	bool Resolve( PendingFrame& pending );
+	const Frame* LastFrame() const;
+};
+
+// Opens a zone for the lifetime of the object.
+class ProfileZone
+{
+public:
+	ProfileZone( FrameProfiler& profiler, const char* name ) : m_profiler( profiler ) { m_profiler.BeginZone( name ); }
+	~ProfileZone() { m_profiler.EndZone(); }
+
+	ProfileZone( const ProfileZone& ) = delete;
+	ProfileZone& operator=( const ProfileZone& ) = delete;
+
+private:
+	FrameProfiler& m_profiler;
+};
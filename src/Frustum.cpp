@@ -0,0 +1,131 @@
+#include "Frustum.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined( __SSE__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 1 )
+#define FRUSTUM_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+Frustum Frustum::FromViewProj( const glm::mat4& viewProj )
+{
+	// glm is column major: the i-th row is ( m[0][i], m[1][i], m[2][i], m[3][i] )
+	auto row = [ &viewProj ]( int i ) { return glm::vec4( viewProj[ 0 ][ i ], viewProj[ 1 ][ i ], viewProj[ 2 ][ i ], viewProj[ 3 ][ i ] ); };
+
+	const glm::vec4 r0 = row( 0 ), r1 = row( 1 ), r2 = row( 2 ), r3 = row( 3 );
+
+	Frustum frustum;
+	frustum.planes[ PLANE_LEFT ] = r3 + r0;
+	frustum.planes[ PLANE_RIGHT ] = r3 - r0;
+	frustum.planes[ PLANE_BOTTOM ] = r3 + r1;
+	frustum.planes[ PLANE_TOP ] = r3 - r1;
+	frustum.planes[ PLANE_NEAR ] = r3 + r2;
+	frustum.planes[ PLANE_FAR ] = r3 - r2;
+
+	for ( glm::vec4& plane : frustum.planes )
+	{
+		plane /= glm::length( glm::vec3( plane ) );
+	}
+
+	return frustum;
+}
+
+static bool BoxIntersectsFrustum( const Frustum& frustum, const glm::vec3& center, const glm::vec3& extents )
+{
+	for ( const glm::vec4& plane : frustum.planes )
+	{
+		const float distance = glm::dot( glm::vec3( plane ), center ) + plane.w;
+		const float radius = glm::dot( glm::abs( glm::vec3( plane ) ), extents );
+		if ( distance + radius < 0.0f ) return false;
+	}
+	return true;
+}
+
+bool Frustum::Intersects( const AABB& box ) const
+{
+	return BoxIntersectsFrustum( *this, box.Center(), box.Extents() );
+}
+
+bool Frustum::Intersects( const BoundingSphere& sphere ) const
+{
+	for ( const glm::vec4& plane : planes )
+	{
+		if ( glm::dot( glm::vec3( plane ), sphere.center ) + plane.w < -sphere.radius ) return false;
+	}
+	return true;
+}
+
+void AABBBatch::Clear()
+{
+	m_count = 0;
+	m_centerX.clear(); m_centerY.clear(); m_centerZ.clear();
+	m_extentX.clear(); m_extentY.clear(); m_extentZ.clear();
+}
+
+void AABBBatch::Reserve( std::size_t count )
+{
+	for ( std::vector<float>* array : { &m_centerX, &m_centerY, &m_centerZ, &m_extentX, &m_extentY, &m_extentZ } )
+		array->reserve( count );
+}
+
+void AABBBatch::Add( const AABB& box )
+{
+	const glm::vec3 center = box.Center();
+	const glm::vec3 extents = box.Extents();
+	m_centerX.push_back( center.x ); m_centerY.push_back( center.y ); m_centerZ.push_back( center.z );
+	m_extentX.push_back( extents.x ); m_extentY.push_back( extents.y ); m_extentZ.push_back( extents.z );
+	++m_count;
+}
+
+void CullAABBBatch( const Frustum& frustum, const AABBBatch& batch, std::vector<std::uint8_t>& visible )
+{
+	visible.resize( batch.m_count );
+
+	std::size_t i = 0;
+
+#ifdef FRUSTUM_USE_SSE
+	// planes broadcast once, absolute normals precomputed for the projected radius
+	__m128 nx[ Frustum::PLANE_COUNT ], ny[ Frustum::PLANE_COUNT ], nz[ Frustum::PLANE_COUNT ], nw[ Frustum::PLANE_COUNT ];
+	__m128 ax[ Frustum::PLANE_COUNT ], ay[ Frustum::PLANE_COUNT ], az[ Frustum::PLANE_COUNT ];
+	for ( int p = 0; p < Frustum::PLANE_COUNT; ++p )
+	{
+		const glm::vec4& plane = frustum.planes[ p ];
+		nx[ p ] = _mm_set1_ps( plane.x ); ny[ p ] = _mm_set1_ps( plane.y ); nz[ p ] = _mm_set1_ps( plane.z ); nw[ p ] = _mm_set1_ps( plane.w );
+		ax[ p ] = _mm_set1_ps( std::abs( plane.x ) ); ay[ p ] = _mm_set1_ps( std::abs( plane.y ) ); az[ p ] = _mm_set1_ps( std::abs( plane.z ) );
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+	for ( ; i + 4 <= batch.m_count; i += 4 )
+	{
+		const __m128 cx = _mm_loadu_ps( batch.m_centerX.data() + i );
+		const __m128 cy = _mm_loadu_ps( batch.m_centerY.data() + i );
+		const __m128 cz = _mm_loadu_ps( batch.m_centerZ.data() + i );
+		const __m128 ex = _mm_loadu_ps( batch.m_extentX.data() + i );
+		const __m128 ey = _mm_loadu_ps( batch.m_extentY.data() + i );
+		const __m128 ez = _mm_loadu_ps( batch.m_extentZ.data() + i );
+
+		// a box is outside if distance + radius < 0 for any plane
+		__m128 outside = zero;
+		for ( int p = 0; p < Frustum::PLANE_COUNT; ++p )
+		{
+			const __m128 distance = _mm_add_ps( _mm_add_ps( _mm_mul_ps( nx[ p ], cx ), _mm_mul_ps( ny[ p ], cy ) ),
+												_mm_add_ps( _mm_mul_ps( nz[ p ], cz ), nw[ p ] ) );
+			const __m128 radius = _mm_add_ps( _mm_add_ps( _mm_mul_ps( ax[ p ], ex ), _mm_mul_ps( ay[ p ], ey ) ), _mm_mul_ps( az[ p ], ez ) );
+			outside = _mm_or_ps( outside, _mm_cmplt_ps( _mm_add_ps( distance, radius ), zero ) );
+		}
+
+		const int outsideMask = _mm_movemask_ps( outside );
+		for ( int lane = 0; lane < 4; ++lane )
+			visible[ i + lane ] = ( outsideMask >> lane & 1 ) ? 0 : 1;
+	}
+#endif
+
+	// the remainder (or everything without SSE)
+	for ( ; i < batch.m_count; ++i )
+	{
+		const glm::vec3 center( batch.m_centerX[ i ], batch.m_centerY[ i ], batch.m_centerZ[ i ] );
+		const glm::vec3 extents( batch.m_extentX[ i ], batch.m_extentY[ i ], batch.m_extentZ[ i ] );
+		visible[ i ] = BoxIntersectsFrustum( frustum, center, extents ) ? 1 : 0;
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Bounds.h"
+
+// View frustum as six planes ( dot( plane.xyz, p ) + plane.w >= 0 inside ), the normals point inwards.
+struct Frustum
+{
+	enum Plane { PLANE_LEFT, PLANE_RIGHT, PLANE_BOTTOM, PLANE_TOP, PLANE_NEAR, PLANE_FAR, PLANE_COUNT };
+
+	glm::vec4 planes[ PLANE_COUNT ];
+
+	// Gribb-Hartmann extraction from an OpenGL style (-1..1 depth) projection * view matrix.
+	static Frustum FromViewProj( const glm::mat4& viewProj );
+
+	// Conservative tests: false only if the volume is completely outside of one of the planes.
+	bool Intersects( const AABB& box ) const;
+	bool Intersects( const BoundingSphere& sphere ) const;
+};
+
+// Boxes in structure of arrays layout (centre and half extents), so four of them can be tested at once.
+class AABBBatch
+{
+public:
+	void Clear();
+	void Reserve( std::size_t count );
+	void Add( const AABB& box );
+
+	std::size_t Size() const { return m_count; }
+
+private:
+	friend void CullAABBBatch( const Frustum&, const AABBBatch&, std::vector<std::uint8_t>& );
+
+	std::size_t m_count = 0;
+	std::vector<float> m_centerX, m_centerY, m_centerZ;
+	std::vector<float> m_extentX, m_extentY, m_extentZ;
+};
+
+// visible[ i ] is set to 1 if the i-th box of the batch intersects the frustum, 0 otherwise.
+// Uses SSE (four boxes per iteration) where available.
+void CullAABBBatch( const Frustum& frustum, const AABBBatch& batch, std::vector<std::uint8_t>& visible );
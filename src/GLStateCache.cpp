@@ -0,0 +1,121 @@
+#include "GLStateCache.h"
+
+void GLStateCache::Invalidate()
+{
+	m_programID = UNKNOWN_NAME;
+	m_vaoID = UNKNOWN_NAME;
+	m_textureIDs.fill( UNKNOWN_NAME );
+	m_samplerIDs.fill( UNKNOWN_NAME );
+
+	m_depthTest = Flag::UNKNOWN;
+	m_depthFunc = UNKNOWN_ENUM;
+	m_depthMask = Flag::UNKNOWN;
+	m_cullFace = Flag::UNKNOWN;
+	m_blend = Flag::UNKNOWN;
+	m_blendSource = UNKNOWN_ENUM;
+	m_blendDestination = UNKNOWN_ENUM;
+	m_polygonMode = UNKNOWN_ENUM;
+}
+
+template <typename T>
+bool GLStateCache::Change( T& current, T value )
+{
+	if ( current == value )
+	{
+		++m_filteredCalls;
+		return false;
+	}
+
+	current = value;
+	++m_issuedCalls;
+	return true;
+}
+
+void GLStateCache::SetCapability( Flag& current, GLenum capability, bool enable )
+{
+	if ( !Change( current, enable ? Flag::ON : Flag::OFF ) ) return;
+
+	if ( enable )
+		glEnable( capability );
+	else
+		glDisable( capability );
+}
+
+void GLStateCache::UseProgram( GLuint programID )
+{
+	if ( Change( m_programID, programID ) ) glUseProgram( programID );
+}
+
+void GLStateCache::BindVertexArray( GLuint vaoID )
+{
+	if ( Change( m_vaoID, vaoID ) ) glBindVertexArray( vaoID );
+}
+
+void GLStateCache::BindTextureUnit( GLuint unit, GLuint textureID )
+{
+	if ( unit >= TEXTURE_UNIT_COUNT )
+	{
+		++m_issuedCalls;
+		glBindTextureUnit( unit, textureID );
+		return;
+	}
+
+	if ( Change( m_textureIDs[ unit ], textureID ) ) glBindTextureUnit( unit, textureID );
+}
+
+void GLStateCache::BindSampler( GLuint unit, GLuint samplerID )
+{
+	if ( unit >= TEXTURE_UNIT_COUNT )
+	{
+		++m_issuedCalls;
+		glBindSampler( unit, samplerID );
+		return;
+	}
+
+	if ( Change( m_samplerIDs[ unit ], samplerID ) ) glBindSampler( unit, samplerID );
+}
+
+void GLStateCache::SetDepthTest( bool enable )
+{
+	SetCapability( m_depthTest, GL_DEPTH_TEST, enable );
+}
+
+void GLStateCache::SetDepthFunc( GLenum func )
+{
+	if ( Change( m_depthFunc, func ) ) glDepthFunc( func );
+}
+
+void GLStateCache::SetDepthMask( bool write )
+{
+	if ( Change( m_depthMask, write ? Flag::ON : Flag::OFF ) ) glDepthMask( write ? GL_TRUE : GL_FALSE );
+}
+
+void GLStateCache::SetCullFace( bool enable )
+{
+	SetCapability( m_cullFace, GL_CULL_FACE, enable );
+}
+
+void GLStateCache::SetBlend( bool enable )
+{
+	SetCapability( m_blend, GL_BLEND, enable );
+}
+
+void GLStateCache::SetBlendFunc( GLenum sourceFactor, GLenum destinationFactor )
+{
+	// one call, counted once
+	if ( m_blendSource == sourceFactor && m_blendDestination == destinationFactor )
+	{
+		++m_filteredCalls;
+		return;
+	}
+
+	m_blendSource = sourceFactor;
+	m_blendDestination = destinationFactor;
+	++m_issuedCalls;
+	glBlendFunc( sourceFactor, destinationFactor );
+}
+
+void GLStateCache::SetPolygonMode( GLenum mode )
+{
+	if ( Change( m_polygonMode, mode ) ) glPolygonMode( GL_FRONT_AND_BACK, mode );
+}
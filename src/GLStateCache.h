@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <GL/glew.h>
+
+// Thin shadow of the OpenGL state the renderer changes: a call is only forwarded if it changes the state.
+// It never queries the driver: after Invalidate() every value is unknown and the next call of each setter goes through.
+// Has to be invalidated whenever someone else may have changed the state (or deleted a bound object).
+class GLStateCache
+{
+public:
+	GLStateCache() { Invalidate(); }
+
+	void Invalidate();
+
+	void UseProgram( GLuint programID );
+	void BindVertexArray( GLuint vaoID );
+	void BindTextureUnit( GLuint unit, GLuint textureID );
+	void BindSampler( GLuint unit, GLuint samplerID );
+
+	void SetDepthTest( bool enable );
+	void SetDepthFunc( GLenum func );
+	void SetDepthMask( bool write );
+	void SetCullFace( bool enable );
+	void SetBlend( bool enable );
+	void SetBlendFunc( GLenum sourceFactor, GLenum destinationFactor );
+	void SetPolygonMode( GLenum mode );
+
+	// Calls forwarded to / filtered out since the last ResetCounters()
+	std::uint32_t IssuedCalls() const { return m_issuedCalls; }
+	std::uint32_t FilteredCalls() const { return m_filteredCalls; }
+	void ResetCounters() { m_issuedCalls = 0; m_filteredCalls = 0; }
+
+	static constexpr GLuint TEXTURE_UNIT_COUNT = 16;
+
+private:
+	static constexpr GLuint UNKNOWN_NAME = ~0u;
+	static constexpr GLenum UNKNOWN_ENUM = ~0u;
+	enum class Flag : std::int8_t { UNKNOWN = -1, OFF = 0, ON = 1 };
+
+	GLuint m_programID;
+	GLuint m_vaoID;
+	std::array<GLuint, TEXTURE_UNIT_COUNT> m_textureIDs;
+	std::array<GLuint, TEXTURE_UNIT_COUNT> m_samplerIDs;
+
+	Flag m_depthTest;
+	GLenum m_depthFunc;
+	Flag m_depthMask;
+	Flag m_cullFace;
+	Flag m_blend;
+	GLenum m_blendSource;
+	GLenum m_blendDestination;
+	GLenum m_polygonMode;
+
+	std::uint32_t m_issuedCalls = 0;
+	std::uint32_t m_filteredCalls = 0;
+
+	// true if the call has to be issued, current is updated
+	template <typename T>
+	bool Change( T& current, T value );
+	void SetCapability( Flag& current, GLenum capability, bool enable );
+};
@@ -4,6 +4,11 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <cstring>
+#include <memory>
+#include <algorithm>
+#include <chrono>
+#include <thread>
 
 // #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_image.h>
@@ -13,14 +18,16 @@ Az http://www.opengl-tutorial.org/ oldal alapján.
 
 */
 
-static void loadShaderCode( std::string& shaderCode, const std::filesystem::path& _fileName )
+void LoadShaderCode( std::string& shaderCode, const std::filesystem::path& _fileName )
 {
 	// shaderkod betoltese _fileName fajlbol
-	shaderCode = "";
+	shaderCode.clear();
 
 	// _fileName megnyitasa
-	std::ifstream shaderStream( _fileName );
-	if ( !shaderStream.is_open() )
+	std::ifstream shaderStream( _fileName, std::ios::binary );
+	std::error_code ec;
+	const std::uintmax_t fileSize = std::filesystem::file_size( _fileName, ec );
+	if ( !shaderStream.is_open() || ec )
 	{
 		SDL_LogMessage( SDL_LOG_CATEGORY_ERROR,
 						SDL_LOG_PRIORITY_ERROR,
@@ -28,26 +35,22 @@ static void loadShaderCode( std::string& shaderCode, const std::filesystem::path
 		return;
 	}
 
-	// file tartalmanak betoltese a shaderCode string-be
-	std::string line = "";
-	while ( std::getline( shaderStream, line ) )
-	{
-		shaderCode += line + "\n";
-	}
-
-	shaderStream.close();
+	// file tartalmanak betoltese a shaderCode string-be egyetlen olvasassal
+	shaderCode.resize( fileSize );
+	shaderStream.read( shaderCode.data(), fileSize );
+	shaderCode.resize( shaderStream.gcount() );
 }
 
 GLuint AttachShader( const GLuint programID, GLenum shaderType, const std::filesystem::path& _fileName )
 {
     // shaderkod betoltese _fileName fajlbol
     std::string shaderCode;
-    loadShaderCode( shaderCode, _fileName );
+    LoadShaderCode( shaderCode, _fileName );
 
     return AttachShaderCode( programID, shaderType, shaderCode );
 }
 
-GLuint AttachShaderCode( const GLuint programID, GLenum shaderType, std::string_view shaderCode )
+GLuint AttachShaderCode( const GLuint programID, GLenum shaderType, std::string_view shaderCode, bool checkCompileStatus )
 {
 	if (programID == 0)
 	{
@@ -70,6 +73,18 @@ GLuint AttachShaderCode( const GLuint programID, GLenum shaderType, std::string_
 	glCompileShader( shaderID );
 
 	// ellenorizzuk, h minden rendben van-e
+	// (párhuzamos fordításnál ezt csak a fordítás végeztével szabad, különben megvárnánk a drivert)
+	if ( checkCompileStatus ) CheckShaderCompileStatus( shaderID );
+
+	// shader hozzarendelese a programhoz
+	glAttachShader( programID, shaderID );
+
+	return shaderID;
+
+}
+
+bool CheckShaderCompileStatus( const GLuint shaderID )
+{
 	GLint result = GL_FALSE;
 	int infoLogLength;
 
@@ -88,18 +103,19 @@ GLuint AttachShaderCode( const GLuint programID, GLenum shaderType, std::string_
 						"[glCompileShader]: %s", ErrorMessage.data() );
 	}
 
-	// shader hozzarendelese a programhoz
-	glAttachShader( programID, shaderID );
-
-	return shaderID;
-
+	return GL_FALSE != result;
 }
 
-void LinkProgram( const GLuint programID, bool OwnShaders )
+bool LinkProgram( const GLuint programID, bool OwnShaders )
 {
 	// illesszük össze a shadereket (kimenő-bemenő változók összerendelése stb.)
 	glLinkProgram( programID );
 
+	return CheckProgramLinkStatus( programID, OwnShaders );
+}
+
+bool CheckProgramLinkStatus( const GLuint programID, bool OwnShaders )
+{
 	// linkeles ellenorzese
 	GLint infoLogLength = 0, result = 0;
 
@@ -135,6 +151,8 @@ void LinkProgram( const GLuint programID, bool OwnShaders )
         }
 
 	}
+
+	return GL_FALSE != result;
 }
 
 static inline ImageRGBA::TexelRGBA* get_image_row( ImageRGBA& image, int rowIndex )
@@ -142,23 +160,73 @@ static inline ImageRGBA::TexelRGBA* get_image_row( ImageRGBA& image, int rowInde
 	return &image.texelData[  rowIndex * image.width ];
 }
 
-static void invert_image_RGBA(ImageRGBA& image)
+// A [firstRow, lastRow) tartományba eső sorokat cseréli ki a tükörképükkel, egész sorokat mozgatva
+static void swap_image_rows( ImageRGBA& image, unsigned int firstRow, unsigned int lastRow )
 {
-	int height_div_2 = image.height / 2;
+	for ( unsigned int index = firstRow; index < lastRow; index++ )
+	{
+		std::uint32_t* lower_data  = reinterpret_cast<std::uint32_t*>( get_image_row( image, index ) );
+		std::uint32_t* higher_data = reinterpret_cast<std::uint32_t*>( get_image_row( image, image.height - 1 - index ) );
+
+		// a fordító ezt vektorizált, memcpy sebességű cserére fordítja
+		std::swap_ranges( lower_data, lower_data + image.width, higher_data );
+	}
+}
+
+void FlipImageRGBA( ImageRGBA& image, bool multithreaded )
+{
+	const unsigned int height_div_2 = image.height / 2;
+
+	// Kis képeknél nem éri meg szálakat indítani
+	static constexpr std::size_t PARALLEL_FLIP_MIN_BYTES = 4 * 1024 * 1024;
+	const std::size_t imageSizeInBytes = image.texelData.size() * sizeof( ImageRGBA::TexelRGBA );
+	const unsigned int threadCount = std::min( std::max( std::thread::hardware_concurrency(), 1u ), std::max( height_div_2, 1u ) );
+
+	if ( !multithreaded || imageSizeInBytes < PARALLEL_FLIP_MIN_BYTES || threadCount < 2 )
+	{
+		swap_image_rows( image, 0, height_div_2 );
+		return;
+	}
+
+	// A sorpárok egymástól függetlenek, ezért sávokra osztva párhuzamosan cserélhetők
+	std::vector<std::thread> workers;
+	workers.reserve( threadCount - 1 );
+
+	const unsigned int rowsPerThread = ( height_div_2 + threadCount - 1 ) / threadCount;
+	for ( unsigned int t = 1; t < threadCount; ++t )
+	{
+		const unsigned int firstRow = std::min( t * rowsPerThread, height_div_2 );
+		const unsigned int lastRow  = std::min( firstRow + rowsPerThread, height_div_2 );
+		workers.emplace_back( swap_image_rows, std::ref( image ), firstRow, lastRow );
+	}
+	swap_image_rows( image, 0, std::min( rowsPerThread, height_div_2 ) );
 
+	for ( std::thread& worker : workers ) worker.join();
+}
 
-	for ( int index = 0; index < height_div_2; index++ )
+bool ReserveDynamicBuffer( GLuint bufferID, std::size_t& capacity, std::size_t size )
+{
+	if ( size <= capacity && capacity > 0 )
 	{
-		std::uint32_t* lower_data  =reinterpret_cast<std::uint32_t*>(get_image_row( image, index) );
-		std::uint32_t* higher_data =reinterpret_cast<std::uint32_t*>(get_image_row( image, image.height - 1 - index ) );
+		glInvalidateBufferData( bufferID );
+		return true;
+	}
 
-		for ( unsigned int rowIndex = 0; rowIndex < image.width; rowIndex++ )
+	// a lassan növő tartalom így nem foglal újra minden képkockán; ha a dupla már nem fér el, pontosan akkorát kérünk
+	const std::size_t requests[ 2 ] = { std::max<std::size_t>( { size, 2 * capacity, 1 } ), std::max<std::size_t>( size, 1 ) };
+	for ( std::size_t request : requests )
+	{
+		glNamedBufferData( bufferID, static_cast<GLsizeiptr>( request ), nullptr, GL_DYNAMIC_DRAW );
+		if ( glGetError() != GL_OUT_OF_MEMORY )
 		{
-			lower_data[ rowIndex ] ^= higher_data[ rowIndex ];
-			higher_data[ rowIndex ] ^= lower_data[ rowIndex ];
-			lower_data[ rowIndex ] ^= higher_data[ rowIndex ];
+			capacity = request;
+			return true;
 		}
 	}
+
+	SDL_LogMessage( SDL_LOG_CATEGORY_ERROR, SDL_LOG_PRIORITY_ERROR, "[GLUtils] Could not allocate %zu bytes for buffer %u", size, bufferID );
+	capacity = 0;
+	return false;
 }
 
 GLsizei NumberOfMIPLevels( const ImageRGBA& image )
@@ -171,10 +239,29 @@ GLsizei NumberOfMIPLevels( const ImageRGBA& image )
 	return targetlevel;
 }
 
-[[nodiscard]] ImageRGBA ImageFromFile( const std::filesystem::path& fileName, bool needsFlip )
+// Az SDL Surface sorainak átmásolása az ImageRGBA-ba, szükség esetén fordított sorrendben (tükrözés másolás közben)
+static void copy_surface_rows( ImageRGBA& image, const SDL_Surface* surface, bool needsFlip )
+{
+	const Uint8* srcPixels = static_cast<const Uint8*>( surface->pixels );
+	const std::size_t rowSizeInBytes = image.width * sizeof( ImageRGBA::TexelRGBA );
+
+	for ( unsigned int rowIndex = 0; rowIndex < image.height; ++rowIndex )
+	{
+		const unsigned int dstRowIndex = needsFlip ? image.height - 1 - rowIndex : rowIndex;
+		std::memcpy( get_image_row( image, dstRowIndex ), srcPixels + rowIndex * surface->pitch, rowSizeInBytes );
+	}
+}
+
+[[nodiscard]] ImageRGBA ImageFromFile( const std::filesystem::path& fileName, bool needsFlip, ImageLoadStats* stats )
 {
 	ImageRGBA img;
 
+	auto elapsedMs = []( std::chrono::steady_clock::time_point since )
+	{
+		return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - since ).count();
+	};
+	const auto decodeStart = std::chrono::steady_clock::now();
+
 	// Kép betöltése
 	std::unique_ptr<SDL_Surface, decltype( &SDL_FreeSurface )> loaded_img( IMG_Load( fileName.string().c_str() ), SDL_FreeSurface );
 	if ( !loaded_img )
@@ -185,6 +272,13 @@ GLsizei NumberOfMIPLevels( const ImageRGBA& image )
 		return img;
 	}
 
+	const auto convertStart = std::chrono::steady_clock::now();
+	if ( stats != nullptr ) stats->decodeMs = elapsedMs( decodeStart );
+
+	// a dekódolt kép és a végleges puffer mindig egyszerre él
+	const std::size_t loadedBytes = static_cast<std::size_t>( loaded_img->h ) * loaded_img->pitch;
+	std::size_t peakBytes = loadedBytes + static_cast<std::size_t>( loaded_img->w ) * loaded_img->h * sizeof( ImageRGBA::TexelRGBA );
+
 	// Uint32-ben tárolja az SDL a színeket, ezért számít a bájtsorrend
 #if SDL_BYTEORDER == SDL_LIL_ENDIAN
 	Uint32 format = SDL_PIXELFORMAT_ABGR8888;
@@ -192,23 +286,73 @@ GLsizei NumberOfMIPLevels( const ImageRGBA& image )
 	Uint32 format = SDL_PIXELFORMAT_RGBA8888;
 #endif
 
-	// Átalakítás 32bit RGBA formátumra, ha nem abban volt
-	std::unique_ptr<SDL_Surface, decltype( &SDL_FreeSurface )> formattedSurf( SDL_ConvertSurfaceFormat( loaded_img.get(), format, 0 ), SDL_FreeSurface );
-
-	if (!formattedSurf)
+	// A végleges puffert foglaljuk le, ebbe kerülnek közvetlenül a pixelek, nincs köztes SDL_Surface
+	if ( !img.Allocate( loaded_img->w, loaded_img->h ) )
 	{
 		SDL_LogMessage( SDL_LOG_CATEGORY_ERROR, 
 						SDL_LOG_PRIORITY_ERROR,
-						"[ImageFromFile] Error while processing texture");
+						"[ImageFromFile] Empty image file: %s", fileName.string().c_str());
 		return img;
 	}
 
-	// Rakjuk át az SDL Surface-t az ImageRGBA-ba
-	img.Assign( reinterpret_cast<const std::uint32_t*>(formattedSurf->pixels), formattedSurf->w, formattedSurf->h );
+	const Uint32 srcFormat = loaded_img->format->format;
 
-	// Áttérés SDL koordinátarendszerről ( (0,0) balfent ) OpenGL textúra-koordinátarendszerre ( (0,0) ballent )
+	if ( srcFormat == format )
+	{
+		// Már 32bit RGBA formátumú, egyetlen másolással kerül át, közben tükrözzük
+		// az SDL koordinátarendszerről ( (0,0) balfent ) OpenGL textúra-koordinátarendszerre ( (0,0) ballent )
+		if ( SDL_MUSTLOCK( loaded_img.get() ) ) SDL_LockSurface( loaded_img.get() );
+		copy_surface_rows( img, loaded_img.get(), needsFlip );
+		if ( SDL_MUSTLOCK( loaded_img.get() ) ) SDL_UnlockSurface( loaded_img.get() );
+	}
+	else if ( !SDL_ISPIXELFORMAT_INDEXED( srcFormat ) )
+	{
+		// Átalakítás 32bit RGBA formátumra közvetlenül a végleges pufferbe.
+		// Az SDL_ConvertPixels nem fogad el negatív pitch-et, ezért a tükrözés helyben, utólag történik.
+		if ( SDL_MUSTLOCK( loaded_img.get() ) ) SDL_LockSurface( loaded_img.get() );
+		const int result = SDL_ConvertPixels( loaded_img->w, loaded_img->h,
+											  srcFormat, loaded_img->pixels, loaded_img->pitch,
+											  format, img.texelData.data(), static_cast<int>( img.width * sizeof( ImageRGBA::TexelRGBA ) ) );
+		if ( SDL_MUSTLOCK( loaded_img.get() ) ) SDL_UnlockSurface( loaded_img.get() );
+
+		if ( result != 0 )
+		{
+			SDL_LogMessage( SDL_LOG_CATEGORY_ERROR, 
+							SDL_LOG_PRIORITY_ERROR,
+							"[ImageFromFile] Error while processing texture: %s", SDL_GetError() );
+			return ImageRGBA{};
+		}
+
+		if ( needsFlip ) FlipImageRGBA( img );
+	}
+	else
+	{
+		// Palettás képnél az SDL_ConvertPixels nem használható (nem kapja meg a palettát),
+		// ilyenkor marad az átalakítás egy köztes SDL Surface-en keresztül
+		std::unique_ptr<SDL_Surface, decltype( &SDL_FreeSurface )> formattedSurf( SDL_ConvertSurfaceFormat( loaded_img.get(), format, 0 ), SDL_FreeSurface );
 
-	if ( needsFlip ) invert_image_RGBA( img );
+		if (!formattedSurf)
+		{
+			SDL_LogMessage( SDL_LOG_CATEGORY_ERROR, 
+							SDL_LOG_PRIORITY_ERROR,
+							"[ImageFromFile] Error while processing texture");
+			return ImageRGBA{};
+		}
+
+		// A forrás képre már nincs szükség, engedjük el a másolás előtt
+		peakBytes += static_cast<std::size_t>( formattedSurf->h ) * formattedSurf->pitch;
+		loaded_img.reset();
+
+		if ( SDL_MUSTLOCK( formattedSurf.get() ) ) SDL_LockSurface( formattedSurf.get() );
+		copy_surface_rows( img, formattedSurf.get(), needsFlip );
+		if ( SDL_MUSTLOCK( formattedSurf.get() ) ) SDL_UnlockSurface( formattedSurf.get() );
+	}
+
+	if ( stats != nullptr )
+	{
+		stats->convertMs = elapsedMs( convertStart );
+		stats->peakBytes = peakBytes;
+	}
 
 	return img;
 }
@@ -221,4 +365,6 @@ void CleanOGLObject( OGLObject& ObjectGPU )
 	ObjectGPU.iboID = 0;
 	glDeleteVertexArrays(1, &ObjectGPU.vaoID);
 	ObjectGPU.vaoID = 0;
+	glDeleteVertexArrays(1, &ObjectGPU.depthVaoID);
+	ObjectGPU.depthVaoID = 0;
 }
\ No newline at end of file
@@ -1,11 +1,14 @@
 #pragma once
 
 #include <filesystem>
+#include <string>
 #include <vector>
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
+#include "Bounds.h"
+
 /* 
 
 Az http://www.opengl-tutorial.org/ oldal alapján.
@@ -87,16 +90,40 @@ struct MeshObject
 {
     std::vector<VertexT> vertexArray;
     std::vector<GLuint>  indexArray;
+
+    // befoglaló térfogatok modell térben, a ComputeMeshBounds tölti ki
+    AABB           bounds;
+    BoundingSphere boundingSphere;
 };
 
 struct OGLObject
 {
     GLuint  vaoID = 0; // vertex array object erőforrás azonosító
+    GLuint  depthVaoID = 0; // csak a pozíciót (0. attribútum) olvasó VAO ugyanazokkal a pufferekkel, a mélységi menetekhez
     GLuint  vboID = 0; // vertex buffer object erőforrás azonosító
     GLuint  iboID = 0; // index buffer object erőforrás azonosító
     GLsizei count = 0; // mennyi indexet/vertexet kell rajzolnunk
+
+    // a mesh befoglaló térfogatai modell térben (láthatósági vizsgálathoz)
+    AABB           bounds;
+    BoundingSphere boundingSphere;
 };
 
+inline const glm::vec3& VertexPosition( const glm::vec3& vertex ) { return vertex; }
+template <typename VertexT>
+inline const glm::vec3& VertexPosition( const VertexT& vertex ) { return vertex.position; }
+
+template <typename VertexT>
+void ComputeMeshBounds( MeshObject<VertexT>& mesh )
+{
+    mesh.bounds = AABB();
+    for ( const VertexT& vertex : mesh.vertexArray )
+        mesh.bounds.Extend( VertexPosition( vertex ) );
+
+    mesh.boundingSphere = BoundingSphereFromPoints( mesh.bounds, mesh.vertexArray.begin(), mesh.vertexArray.end(),
+                                                    []( const VertexT& vertex ) { return VertexPosition( vertex ); } );
+}
+
 
 struct VertexAttributeDescriptor
 {
@@ -108,9 +135,13 @@ struct VertexAttributeDescriptor
 
 // Segéd függvények
 
+void LoadShaderCode( std::string& shaderCode, const std::filesystem::path& _fileName );
 GLuint AttachShader( const GLuint programID, GLenum shaderType, const std::filesystem::path& _fileName );
-GLuint AttachShaderCode( const GLuint programID, GLenum shaderType, std::string_view shaderCode );
-void LinkProgram( const GLuint programID, bool OwnShaders = true );
+GLuint AttachShaderCode( const GLuint programID, GLenum shaderType, std::string_view shaderCode, bool checkCompileStatus = true );
+bool CheckShaderCompileStatus( const GLuint shaderID );
+bool LinkProgram( const GLuint programID, bool OwnShaders = true );
+// glLinkProgram nélkül csak a linkelés eredményét ellenőrzi (pl. párhuzamos fordítás után)
+bool CheckProgramLinkStatus( const GLuint programID, bool OwnShaders = true );
 
 
 template <typename VertexT>
@@ -135,6 +166,9 @@ template <typename VertexT>
 
 	meshGPU.count = static_cast<GLsizei>(mesh.indexArray.size());
 
+	meshGPU.bounds = mesh.bounds;
+	meshGPU.boundingSphere = mesh.boundingSphere;
+
 	// 1 db VAO foglalasa
 	glCreateVertexArrays(1, &meshGPU.vaoID);
 	// a frissen generált VAO beallitasa aktívnak
@@ -158,12 +192,52 @@ template <typename VertexT>
 	}
 	glVertexArrayElementBuffer( meshGPU.vaoID, meshGPU.iboID );
 
+	// a mélységi menetekhez (árnyéktérkép, mélységi előmenet) csak a pozíció kell: külön VAO, ugyanazokkal a pufferekkel
+	glCreateVertexArrays(1, &meshGPU.depthVaoID);
+	glVertexArrayVertexBuffer( meshGPU.depthVaoID, 0, meshGPU.vboID, 0, sizeof( VertexT ) );
+	for ( const auto& vertexAttrDesc: vertexAttrDescList )
+	{
+		if ( vertexAttrDesc.index != 0 ) continue;
+
+		glEnableVertexArrayAttrib( meshGPU.depthVaoID, 0 );
+		glVertexArrayAttribBinding( meshGPU.depthVaoID, 0, 0 );
+		glVertexArrayAttribFormat( meshGPU.depthVaoID, 0, vertexAttrDesc.numberOfComponents, vertexAttrDesc.glType, GL_FALSE, vertexAttrDesc.strideInBytes );
+	}
+	glVertexArrayElementBuffer( meshGPU.depthVaoID, meshGPU.iboID );
+
 	return meshGPU;
 }
 
 void CleanOGLObject( OGLObject& ObjectGPU );
 
-[[nodiscard]] ImageRGBA ImageFromFile( const std::filesystem::path& fileName, bool needsFlip = true );
+// Dinamikus (képkockánként újratöltött) puffer előkészítése size bájtnyi új tartalomhoz. Ha kicsi, geometrikusan nő
+// (capacity bájtban), különben a régi tartalmát eldobjuk: a GPU még olvashatja, a driver várakozás helyett új tárat adhat.
+// Sosem üres, így mindig köthető. Hamissal tér vissza, ha a foglalás nem sikerült (ekkor a capacity 0).
+bool ReserveDynamicBuffer( GLuint bufferID, std::size_t& capacity, std::size_t size );
+
+// ReserveDynamicBuffer, utána az adatok a puffer elejére.
+template <typename T>
+bool UploadDynamicBuffer( GLuint bufferID, std::size_t& capacity, const std::vector<T>& data )
+{
+	if ( !ReserveDynamicBuffer( bufferID, capacity, data.size() * sizeof( T ) ) ) return false;
+
+	if ( !data.empty() )
+		glNamedBufferSubData( bufferID, 0, data.size() * sizeof( T ), data.data() );
+	return true;
+}
+
+// Egy kép betöltésének mérései: a dekódolás és az RGBA-ra alakítás (tükrözéssel) ideje, és a betöltés közben
+// egyszerre élő képpufferek legnagyobb összmérete (a dekódoló saját átmeneti foglalásai nélkül)
+struct ImageLoadStats
+{
+	double decodeMs = 0.0;
+	double convertMs = 0.0;
+	std::size_t peakBytes = 0;
+};
+
+[[nodiscard]] ImageRGBA ImageFromFile( const std::filesystem::path& fileName, bool needsFlip = true, ImageLoadStats* stats = nullptr );
+// Függőleges tükrözés helyben, egész sorok cseréjével; nagy képnél a sorpárokat több szál cseréli (multithreaded = false: egy szálon)
+void FlipImageRGBA( ImageRGBA& image, bool multithreaded = true );
 GLsizei NumberOfMIPLevels( const ImageRGBA& );
 
 // uniform location lekérdezése
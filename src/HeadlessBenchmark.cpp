@@ -0,0 +1,656 @@
+#include "HeadlessBenchmark.h"
+
+#include "MyApp.h"
+#include "BVH.h"
+#include "Frustum.h"
+#include "GLUtils.hpp"
+#include "ParametricSurfaceMesh.hpp"
+#include "ParametricSurface.h"
+
+#include <SDL2/SDL_log.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef HEADLESS_EGL_SUPPORT
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+bool ParseHeadlessBenchmarkOptions( int argc, char* args[], HeadlessBenchmarkOptions& options )
+{
+	bool headless = false;
+
+	for ( int i = 1; i < argc; ++i )
+	{
+		const std::string_view arg = args[ i ];
+		const bool hasValue = i + 1 < argc;
+
+		if ( arg == "--headless" )
+		{
+			headless = true;
+		}
+		else if ( arg == "--frames" && hasValue )
+		{
+			options.frameCount = std::max( std::atoi( args[ ++i ] ), 1 );
+		}
+		else if ( arg == "--size" && hasValue )
+		{
+			int width = 0, height = 0;
+			if ( std::sscanf( args[ ++i ], "%dx%d", &width, &height ) == 2 && width > 0 && height > 0 )
+			{
+				options.width  = width;
+				options.height = height;
+			}
+			else
+			{
+				SDL_LogMessage( SDL_LOG_CATEGORY_ERROR, SDL_LOG_PRIORITY_WARN, "[Headless] Invalid --size %s, expected WxH", args[ i ] );
+			}
+		}
+		else if ( arg == "--crowd" && hasValue )
+		{
+			options.crowdSize = std::max( std::atoi( args[ ++i ] ), 0 );
+		}
+		else if ( arg == "--no-instancing" )
+		{
+			options.instancing = false;
+		}
+		else if ( arg == "--lights" && hasValue )
+		{
+			options.lightCount = std::clamp( std::atoi( args[ ++i ] ), 0, 4096 );
+		}
+		else if ( arg == "--prepass" && hasValue )
+		{
+			const std::string_view mode = args[ ++i ];
+			if ( mode == "off" )       options.prepass = DepthPrepassMode::OFF;
+			else if ( mode == "on" )   options.prepass = DepthPrepassMode::ON;
+			else if ( mode == "auto" ) options.prepass = DepthPrepassMode::AUTO;
+			else SDL_LogMessage( SDL_LOG_CATEGORY_ERROR, SDL_LOG_PRIORITY_WARN, "[Headless] Invalid --prepass %s, expected off, on or auto", args[ i ] );
+		}
+		else if ( arg == "--water" )
+		{
+			options.water = true;
+		}
+		else if ( arg == "--cull-boxes" && hasValue )
+		{
+			options.cullBoxes = std::max( std::atoi( args[ ++i ] ), 0 );
+		}
+		else if ( arg == "--flip-bench" && hasValue )
+		{
+			int width = 0, height = 0;
+			if ( std::sscanf( args[ ++i ], "%dx%d", &width, &height ) == 2 && width > 0 && height > 0 )
+			{
+				options.flipWidth  = width;
+				options.flipHeight = height;
+			}
+			else
+			{
+				SDL_LogMessage( SDL_LOG_CATEGORY_ERROR, SDL_LOG_PRIORITY_WARN, "[Headless] Invalid --flip-bench %s, expected WxH", args[ i ] );
+			}
+		}
+		else if ( arg == "--pick-triangles" && hasValue )
+		{
+			options.pickTriangles = std::max( std::atoi( args[ ++i ] ), 0 );
+		}
+		else if ( arg == "--image-bench" )
+		{
+			options.imageBench = true;
+		}
+		else if ( arg == "--report" && hasValue )
+		{
+			options.reportFile = args[ ++i ];
+		}
+	}
+
+	return headless;
+}
+
+#ifdef HEADLESS_EGL_SUPPORT
+
+struct FrameTiming
+{
+	double cpuMs = 0.0;
+	double gpuMs = 0.0;
+	double cullMs = 0.0;  // CullAABBBatch over the --cull-boxes boxes
+	std::size_t culledVisible = 0;
+};
+
+// Timings of the benchmarks that run once, next to the frame loop
+struct KernelTimings
+{
+	std::vector<double> flipSerialMs;   // FlipImageRGBA, one thread
+	std::vector<double> flipThreadedMs; // FlipImageRGBA, row pairs split between threads
+
+	std::size_t pickTriangles = 0;
+	double pickBuildMs = 0.0; // MeshBVH::Build
+	std::vector<double> pickMs; // MeshBVH::Intersect, per ray
+	std::size_t pickHits = 0;
+
+	struct ImageLoad
+	{
+		std::string file;
+		unsigned int width = 0;
+		unsigned int height = 0;
+		ImageLoadStats stats;
+	};
+	std::vector<ImageLoad> imageLoads; // ImageFromFile, one per image of Assets/
+};
+
+static bool HasExtension( const char* extensions, const char* name )
+{
+	if ( !extensions ) return false;
+
+	const std::size_t nameLength = std::strlen( name );
+	for ( const char* ptr = std::strstr( extensions, name ); ptr; ptr = std::strstr( ptr + 1, name ) )
+	{
+		const bool startsToken = ( ptr == extensions || ptr[ -1 ] == ' ' );
+		const bool endsToken = ( ptr[ nameLength ] == ' ' || ptr[ nameLength ] == '\0' );
+		if ( startsToken && endsToken ) return true;
+	}
+	return false;
+}
+
+static std::string JsonEscape( std::string_view str )
+{
+	std::string escaped;
+	for ( char c : str )
+	{
+		if ( c == '"' || c == '\\' ) escaped += '\\';
+		if ( static_cast<unsigned char>( c ) >= 0x20 ) escaped += c;
+	}
+	return escaped;
+}
+
+static void WriteStatistics( std::ofstream& report, const char* name, std::vector<double> values )
+{
+	std::sort( values.begin(), values.end() );
+
+	double sum = 0.0;
+	for ( double value : values ) sum += value;
+
+	auto percentile = [ &values ]( double p )
+	{
+		return values[ std::min( values.size() - 1, static_cast<std::size_t>( p * values.size() ) ) ];
+	};
+
+	report << "  \"" << name << "\": { "
+		   << "\"mean\": " << sum / values.size() << ", "
+		   << "\"min\": " << values.front() << ", "
+		   << "\"p50\": " << percentile( 0.50 ) << ", "
+		   << "\"p95\": " << percentile( 0.95 ) << ", "
+		   << "\"p99\": " << percentile( 0.99 ) << ", "
+		   << "\"max\": " << values.back() << " },\n";
+}
+
+static bool WriteReport( const HeadlessBenchmarkOptions& options, const std::vector<FrameTiming>& timings, const KernelTimings& kernels )
+{
+	std::ofstream report( options.reportFile );
+	if ( !report ) return false;
+
+	std::vector<double> cpuMs, gpuMs, cullMs;
+	for ( const FrameTiming& timing : timings )
+	{
+		cpuMs.push_back( timing.cpuMs );
+		gpuMs.push_back( timing.gpuMs );
+		cullMs.push_back( timing.cullMs );
+	}
+
+	report << "{\n"
+		   << "  \"renderer\": \"" << JsonEscape( reinterpret_cast<const char*>( glGetString( GL_RENDERER ) ) ) << "\",\n"
+		   << "  \"version\": \"" << JsonEscape( reinterpret_cast<const char*>( glGetString( GL_VERSION ) ) ) << "\",\n"
+		   << "  \"width\": " << options.width << ",\n"
+		   << "  \"height\": " << options.height << ",\n"
+		   << "  \"crowd\": " << options.crowdSize << ",\n"
+		   << "  \"instancing\": " << ( options.instancing ? "true" : "false" ) << ",\n"
+		   << "  \"lights\": " << options.lightCount << ",\n"
+		   << "  \"prepass\": \"" << ( options.prepass == DepthPrepassMode::OFF ? "off" : options.prepass == DepthPrepassMode::ON ? "on" : "auto" ) << "\",\n"
+		   << "  \"water\": " << ( options.water ? "true" : "false" ) << ",\n"
+		   << "  \"cull_boxes\": " << options.cullBoxes << ",\n"
+		   << "  \"frames\": " << timings.size() << ",\n";
+
+	WriteStatistics( report, "cpu_ms", cpuMs );
+	WriteStatistics( report, "gpu_ms", gpuMs );
+	if ( options.cullBoxes > 0 ) WriteStatistics( report, "cull_ms", cullMs );
+
+	if ( !kernels.flipSerialMs.empty() )
+	{
+		report << "  \"flip_size\": \"" << options.flipWidth << "x" << options.flipHeight << "\",\n";
+		WriteStatistics( report, "flip_serial_ms", kernels.flipSerialMs );
+		WriteStatistics( report, "flip_threaded_ms", kernels.flipThreadedMs );
+	}
+
+	if ( !kernels.pickMs.empty() )
+	{
+		report << "  \"pick_triangles\": " << kernels.pickTriangles << ",\n"
+			   << "  \"pick_build_ms\": " << kernels.pickBuildMs << ",\n"
+			   << "  \"pick_rays\": " << kernels.pickMs.size() << ",\n"
+			   << "  \"pick_hits\": " << kernels.pickHits << ",\n";
+		WriteStatistics( report, "pick_ms", kernels.pickMs );
+	}
+
+	if ( options.imageBench )
+	{
+		report << "  \"image_loads\": [\n";
+		for ( std::size_t i = 0; i < kernels.imageLoads.size(); ++i )
+		{
+			const KernelTimings::ImageLoad& load = kernels.imageLoads[ i ];
+			report << "    { \"file\": \"" << JsonEscape( load.file ) << "\", \"width\": " << load.width << ", \"height\": " << load.height
+				   << ", \"decode_ms\": " << load.stats.decodeMs << ", \"convert_ms\": " << load.stats.convertMs
+				   << ", \"peak_bytes\": " << load.stats.peakBytes
+				   << ", \"image_bytes\": " << static_cast<std::size_t>( load.width ) * load.height * sizeof( ImageRGBA::TexelRGBA ) << " }"
+				   << ( i + 1 < kernels.imageLoads.size() ? ",\n" : "\n" );
+		}
+		report << "  ],\n";
+	}
+
+	report << "  \"per_frame\": [\n";
+	for ( std::size_t i = 0; i < timings.size(); ++i )
+	{
+		report << "    { \"cpu_ms\": " << timings[ i ].cpuMs << ", \"gpu_ms\": " << timings[ i ].gpuMs;
+		if ( options.cullBoxes > 0 )
+			report << ", \"cull_ms\": " << timings[ i ].cullMs << ", \"cull_visible\": " << timings[ i ].culledVisible;
+		report << " }" << ( i + 1 < timings.size() ? ",\n" : "\n" );
+	}
+	report << "  ]\n}\n";
+
+	return static_cast<bool>( report );
+}
+
+// FlipImageRGBA on a width x height image, alternately on one thread and on all of them, after a warm-up flip
+// (the first touch of the freshly allocated pages is not measured).
+static void RunFlipBenchmark( int width, int height, KernelTimings& kernels )
+{
+	static constexpr int RUN_COUNT = 10;
+
+	ImageRGBA image;
+	if ( !image.Allocate( static_cast<unsigned int>( width ), static_cast<unsigned int>( height ) ) ) return;
+	for ( std::size_t i = 0; i < image.texelData.size(); ++i )
+		image.texelData[ i ] = ImageRGBA::TexelRGBA( i & 0xFF, ( i >> 8 ) & 0xFF, ( i >> 16 ) & 0xFF, 0xFF );
+
+	FlipImageRGBA( image );
+
+	for ( int run = 0; run < RUN_COUNT; ++run )
+	{
+		for ( bool multithreaded : { false, true } )
+		{
+			const auto start = std::chrono::steady_clock::now();
+			FlipImageRGBA( image, multithreaded );
+			const double ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+			( multithreaded ? kernels.flipThreadedMs : kernels.flipSerialMs ).push_back( ms );
+		}
+	}
+
+	SDL_LogInfo( SDL_LOG_CATEGORY_APPLICATION, "[Headless] Image flip %dx%d: %.2f ms serial, %.2f ms threaded (min of %d runs)",
+				 width, height, *std::min_element( kernels.flipSerialMs.begin(), kernels.flipSerialMs.end() ),
+				 *std::min_element( kernels.flipThreadedMs.begin(), kernels.flipThreadedMs.end() ), RUN_COUNT );
+}
+
+// MeshBVH over a unit sphere tessellated into about triangleCount triangles, then a fixed set of rays from a
+// radius 3 shell aimed at random points within radius 1.2 of the center (most hit, some miss), timed one by one.
+static void RunPickBenchmark( int triangleCount, KernelTimings& kernels )
+{
+	static constexpr int RAY_COUNT = 10000;
+
+	// 2 * N * M triangles with N = 2M
+	const std::size_t rings = std::max<std::size_t>( static_cast<std::size_t>( std::sqrt( triangleCount / 4.0 ) ), 2 );
+	const MeshObject<Vertex> mesh = GetParamSurfMesh( Sphere(), 2 * rings, rings );
+	kernels.pickTriangles = mesh.indexArray.size() / 3;
+
+	MeshBVH bvh;
+	const auto buildStart = std::chrono::steady_clock::now();
+	bvh.Build( mesh );
+	kernels.pickBuildMs = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - buildStart ).count();
+
+	std::uint32_t state = 0x2545F491u;
+	auto random = [ &state ]()
+	{
+		// xorshift32, [-1,1)
+		state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+		return static_cast<float>( state >> 8 ) / 8388608.0f - 1.0f;
+	};
+	auto randomDirection = [ &random ]()
+	{
+		glm::vec3 direction;
+		do direction = glm::vec3( random(), random(), random() ); while ( glm::dot( direction, direction ) < 1e-4f || glm::dot( direction, direction ) > 1.0f );
+		return glm::normalize( direction );
+	};
+
+	kernels.pickMs.reserve( RAY_COUNT );
+	for ( int i = 0; i < RAY_COUNT; ++i )
+	{
+		Ray ray;
+		ray.origin = 3.0f * randomDirection();
+		ray.direction = 1.2f * std::abs( random() ) * randomDirection() - ray.origin;
+
+		const auto start = std::chrono::steady_clock::now();
+		RayHit hit;
+		const bool isHit = bvh.Intersect( ray, hit );
+		kernels.pickMs.push_back( std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count() );
+
+		if ( isHit ) ++kernels.pickHits;
+	}
+
+	SDL_LogInfo( SDL_LOG_CATEGORY_APPLICATION, "[Headless] Picking on %zu triangles: build %.1f ms, %zu / %d rays hit",
+				 kernels.pickTriangles, kernels.pickBuildMs, kernels.pickHits, RAY_COUNT );
+}
+
+// Every image of Assets/ (the textures and the skybox faces) through ImageFromFile, in file name order.
+static void RunImageLoadBenchmark( KernelTimings& kernels )
+{
+	std::vector<std::filesystem::path> files;
+	std::error_code error;
+	for ( const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator( "Assets", error ) )
+	{
+		std::string extension = entry.path().extension().string();
+		std::transform( extension.begin(), extension.end(), extension.begin(), []( unsigned char c ) { return static_cast<char>( std::tolower( c ) ); } );
+		if ( entry.is_regular_file() && ( extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".bmp" || extension == ".tga" ) )
+			files.push_back( entry.path() );
+	}
+	if ( error )
+		SDL_LogMessage( SDL_LOG_CATEGORY_ERROR, SDL_LOG_PRIORITY_WARN, "[Headless] Could not list Assets/: %s", error.message().c_str() );
+	std::sort( files.begin(), files.end() );
+
+	for ( const std::filesystem::path& file : files )
+	{
+		KernelTimings::ImageLoad load;
+		load.file = file.generic_string();
+
+		const ImageRGBA image = ImageFromFile( file, true, &load.stats );
+		if ( image.texelData.empty() ) continue; // ImageFromFile already reported the error
+		load.width = image.width;
+		load.height = image.height;
+
+		SDL_LogInfo( SDL_LOG_CATEGORY_APPLICATION, "[Headless] %s %ux%u: decode %.2f ms, convert %.2f ms, peak %.1f MiB",
+					 load.file.c_str(), load.width, load.height, load.stats.decodeMs, load.stats.convertMs, load.stats.peakBytes / ( 1024.0 * 1024.0 ) );
+		kernels.imageLoads.push_back( std::move( load ) );
+	}
+}
+
+// Deterministic boxes of 0.25 - 2.25 m scattered in a 200 m cube around the scene, for the --cull-boxes benchmark.
+static AABBBatch MakeCullBenchmarkBoxes( std::size_t count )
+{
+	AABBBatch batch;
+	batch.Reserve( count );
+
+	std::uint32_t state = 0x9E3779B9u;
+	auto random = [ &state ]()
+	{
+		// xorshift32, [0,1)
+		state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+		return static_cast<float>( state >> 8 ) / 16777216.0f;
+	};
+
+	for ( std::size_t i = 0; i < count; ++i )
+	{
+		const glm::vec3 center = glm::vec3( random(), random(), random() ) * 200.0f - glm::vec3( 100.0f );
+		const glm::vec3 extent = glm::vec3( 0.125f ) + glm::vec3( random(), random(), random() );
+
+		AABB box;
+		box.min = center - extent;
+		box.max = center + extent;
+		batch.Add( box );
+	}
+
+	return batch;
+}
+
+// Offscreen EGL context: the Mesa surfaceless platform if available (works with llvmpipe without any display),
+// otherwise the default display. A pbuffer is only created if the context cannot be made current without a surface.
+struct HeadlessContext
+{
+	EGLDisplay display = EGL_NO_DISPLAY;
+	EGLContext context = EGL_NO_CONTEXT;
+	EGLSurface surface = EGL_NO_SURFACE;
+
+	bool Create()
+	{
+		const char* clientExtensions = eglQueryString( EGL_NO_DISPLAY, EGL_EXTENSIONS );
+
+		auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>( eglGetProcAddress( "eglGetPlatformDisplayEXT" ) );
+		if ( getPlatformDisplay && HasExtension( clientExtensions, "EGL_MESA_platform_surfaceless" ) )
+		{
+			display = getPlatformDisplay( EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr );
+		}
+		if ( display == EGL_NO_DISPLAY )
+		{
+			display = eglGetDisplay( EGL_DEFAULT_DISPLAY );
+		}
+
+		EGLint major = 0, minor = 0;
+		if ( display == EGL_NO_DISPLAY || !eglInitialize( display, &major, &minor ) )
+		{
+			SDL_LogError( SDL_LOG_CATEGORY_ERROR, "[Headless] Could not initialize EGL display" );
+			return false;
+		}
+
+		if ( !eglBindAPI( EGL_OPENGL_API ) )
+		{
+			SDL_LogError( SDL_LOG_CATEGORY_ERROR, "[Headless] Desktop OpenGL is not supported by EGL" );
+			return false;
+		}
+
+		const bool surfaceless = HasExtension( eglQueryString( display, EGL_EXTENSIONS ), "EGL_KHR_surfaceless_context" );
+
+		const EGLint configAttribs[] =
+		{
+			EGL_SURFACE_TYPE,    surfaceless ? 0 : EGL_PBUFFER_BIT,
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+			EGL_DEPTH_SIZE, 24,
+			EGL_NONE
+		};
+		EGLConfig config = nullptr;
+		EGLint configCount = 0;
+		if ( !eglChooseConfig( display, configAttribs, &config, 1, &configCount ) || configCount == 0 )
+		{
+			SDL_LogError( SDL_LOG_CATEGORY_ERROR, "[Headless] No suitable EGL config" );
+			return false;
+		}
+
+		// the application uses direct state access, so at least 4.5 core is needed
+		const EGLint contextAttribs[] =
+		{
+			EGL_CONTEXT_MAJOR_VERSION, 4,
+			EGL_CONTEXT_MINOR_VERSION, 5,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE
+		};
+		context = eglCreateContext( display, config, EGL_NO_CONTEXT, contextAttribs );
+		if ( context == EGL_NO_CONTEXT )
+		{
+			SDL_LogError( SDL_LOG_CATEGORY_ERROR, "[Headless] Could not create an OpenGL 4.5 core context" );
+			return false;
+		}
+
+		if ( !surfaceless )
+		{
+			const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+			surface = eglCreatePbufferSurface( display, config, pbufferAttribs );
+		}
+
+		if ( !eglMakeCurrent( display, surface, surface, context ) )
+		{
+			SDL_LogError( SDL_LOG_CATEGORY_ERROR, "[Headless] Could not make the EGL context current" );
+			return false;
+		}
+
+		// we never swap, but make sure nothing waits for vsync
+		eglSwapInterval( display, 0 );
+
+		return true;
+	}
+
+	void Destroy()
+	{
+		if ( display == EGL_NO_DISPLAY ) return;
+
+		eglMakeCurrent( display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT );
+		if ( surface != EGL_NO_SURFACE ) eglDestroySurface( display, surface );
+		if ( context != EGL_NO_CONTEXT ) eglDestroyContext( display, context );
+		eglTerminate( display );
+
+		display = EGL_NO_DISPLAY;
+		context = EGL_NO_CONTEXT;
+		surface = EGL_NO_SURFACE;
+	}
+};
+
+int RunHeadlessBenchmark( const HeadlessBenchmarkOptions& options )
+{
+	HeadlessContext eglContext;
+	if ( !eglContext.Create() )
+	{
+		eglContext.Destroy();
+		return 1;
+	}
+
+	// glewInit() would look for a GLX display, glewContextInit() only loads the entry points of the current context
+	if ( glewContextInit() != GLEW_OK )
+	{
+		SDL_LogError( SDL_LOG_CATEGORY_ERROR, "[GLEW] Error during the initialization of glew." );
+		eglContext.Destroy();
+		return 1;
+	}
+
+	SDL_LogInfo( SDL_LOG_CATEGORY_APPLICATION, "[Headless] %s, %s, %dx%d, %d frames",
+				 glGetString( GL_RENDERER ), glGetString( GL_VERSION ), options.width, options.height, options.frameCount );
+
+	// offscreen render target
+	GLuint framebufferID = 0;
+	GLuint renderbufferIDs[ 2 ] = {};
+	glCreateFramebuffers( 1, &framebufferID );
+	glCreateRenderbuffers( 2, renderbufferIDs );
+	glNamedRenderbufferStorage( renderbufferIDs[ 0 ], GL_RGBA8, options.width, options.height );
+	glNamedRenderbufferStorage( renderbufferIDs[ 1 ], GL_DEPTH24_STENCIL8, options.width, options.height );
+	glNamedFramebufferRenderbuffer( framebufferID, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbufferIDs[ 0 ] );
+	glNamedFramebufferRenderbuffer( framebufferID, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbufferIDs[ 1 ] );
+
+	if ( glCheckNamedFramebufferStatus( framebufferID, GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
+	{
+		SDL_LogError( SDL_LOG_CATEGORY_ERROR, "[Headless] Incomplete offscreen framebuffer" );
+		glDeleteFramebuffers( 1, &framebufferID );
+		glDeleteRenderbuffers( 2, renderbufferIDs );
+		eglContext.Destroy();
+		return 1;
+	}
+	glBindFramebuffer( GL_FRAMEBUFFER, framebufferID );
+
+	// one GPU timer query per frame, read back after the run so the CPU never waits for them
+	std::vector<GLuint> timerQueries( options.frameCount );
+	glCreateQueries( GL_TIME_ELAPSED, options.frameCount, timerQueries.data() );
+
+	std::vector<FrameTiming> timings( options.frameCount );
+
+	int exitCode = 0;
+	{
+		CMyApp app;
+		if ( !app.Init() )
+		{
+			SDL_LogError( SDL_LOG_CATEGORY_ERROR, "[app.Init] Error during the initialization of the application!" );
+			exitCode = 1;
+		}
+		else
+		{
+			app.SetTargetFramebuffer( framebufferID );
+			app.Resize( options.width, options.height );
+			app.SetCrowdSize( options.crowdSize );
+			app.SetInstancing( options.instancing );
+			app.SetLightCount( options.lightCount );
+			app.SetDepthPrepassMode( options.prepass );
+			app.SetShowWater( options.water );
+
+			// fixed time step, so the runs are reproducible
+			constexpr float FRAME_TIME = 1.0f / 60.0f;
+
+			const AABBBatch cullBoxes = MakeCullBenchmarkBoxes( static_cast<std::size_t>( options.cullBoxes ) );
+			std::vector<std::uint8_t> cullVisible;
+
+			for ( int frame = 0; frame < options.frameCount; ++frame )
+			{
+				// scripted camera path: one orbit around the scene while bobbing up and down
+				const float t = static_cast<float>( frame ) / options.frameCount;
+				const float angle = glm::two_pi<float>() * t;
+				const glm::vec3 eye( 12.0f * cosf( angle ), 5.0f + 3.0f * sinf( 2.0f * angle ), 12.0f * sinf( angle ) );
+				app.SetCameraView( eye, glm::vec3( 0.0f ), glm::vec3( 0.0f, 1.0f, 0.0f ) );
+
+				// outside of the frame time: only the culling of the boxes against the camera of the frame
+				if ( cullBoxes.Size() > 0 )
+				{
+					const auto cullStart = std::chrono::steady_clock::now();
+					CullAABBBatch( Frustum::FromViewProj( app.GetCamera().GetViewProj() ), cullBoxes, cullVisible );
+					timings[ frame ].cullMs = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - cullStart ).count();
+					timings[ frame ].culledVisible = static_cast<std::size_t>( std::count( cullVisible.begin(), cullVisible.end(), std::uint8_t( 1 ) ) );
+				}
+
+				const auto cpuStart = std::chrono::steady_clock::now();
+
+				const SUpdateInfo updateInfo{ frame * static_cast<double>( FRAME_TIME ), FRAME_TIME };
+				app.FixedUpdate( updateInfo );
+				app.Update( updateInfo );
+
+				glBeginQuery( GL_TIME_ELAPSED, timerQueries[ frame ] );
+				app.Render();
+				glEndQuery( GL_TIME_ELAPSED );
+
+				// stands in for the swap: hand the frame over to the driver
+				glFlush();
+
+				const auto cpuEnd = std::chrono::steady_clock::now();
+				timings[ frame ].cpuMs = std::chrono::duration<double, std::milli>( cpuEnd - cpuStart ).count();
+			}
+
+			glFinish();
+
+			for ( int frame = 0; frame < options.frameCount; ++frame )
+			{
+				GLuint64 elapsedNs = 0;
+				glGetQueryObjectui64v( timerQueries[ frame ], GL_QUERY_RESULT, &elapsedNs );
+				timings[ frame ].gpuMs = elapsedNs / 1.0e6;
+			}
+
+			KernelTimings kernels;
+			if ( options.flipWidth > 0 ) RunFlipBenchmark( options.flipWidth, options.flipHeight, kernels );
+			if ( options.pickTriangles > 0 ) RunPickBenchmark( options.pickTriangles, kernels );
+			if ( options.imageBench ) RunImageLoadBenchmark( kernels );
+
+			if ( WriteReport( options, timings, kernels ) )
+			{
+				SDL_LogInfo( SDL_LOG_CATEGORY_APPLICATION, "[Headless] Report written to %s", options.reportFile.string().c_str() );
+			}
+			else
+			{
+				SDL_LogError( SDL_LOG_CATEGORY_ERROR, "[Headless] Could not write report %s", options.reportFile.string().c_str() );
+				exitCode = 1;
+			}
+		}
+
+		app.Clean();
+	}
+
+	glDeleteQueries( options.frameCount, timerQueries.data() );
+	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+	glDeleteFramebuffers( 1, &framebufferID );
+	glDeleteRenderbuffers( 2, renderbufferIDs );
+
+	eglContext.Destroy();
+
+	return exitCode;
+}
+
+#else // HEADLESS_EGL_SUPPORT
+
+int RunHeadlessBenchmark( const HeadlessBenchmarkOptions& )
+{
+	SDL_LogError( SDL_LOG_CATEGORY_ERROR, "[Headless] This build has no EGL support, the headless mode is not available." );
+	return 1;
+}
+
+#endif // HEADLESS_EGL_SUPPORT
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <filesystem>
+
+#include "DepthPrepass.h"
+
+// Options of the headless benchmark mode:
+//   --headless [--frames N] [--size WxH] [--crowd N] [--no-instancing] [--lights N] [--prepass off|on|auto] [--water] [--cull-boxes N] [--flip-bench WxH] [--pick-triangles N] [--image-bench] [--report <file.json>]
+struct HeadlessBenchmarkOptions
+{
+	int frameCount = 600;
+	int width  = 1280;
+	int height = 720;
+	int crowdSize = 0; // number of animated objects
+	bool instancing = true; // the animated objects are drawn instanced, otherwise one draw call each
+	int lightCount = 0; // point lights of the clustered shading (0 - 4096)
+	DepthPrepassMode prepass = DepthPrepassMode::AUTO;
+	bool water = false; // the FFT ocean is simulated and drawn
+	int cullBoxes = 0; // every frame this many boxes are culled with CullAABBBatch against the camera, timed separately
+	int flipWidth = 0; // FlipImageRGBA timed on a synthetic image of this size (e.g. 7680x4320), serial and threaded (0: off)
+	int flipHeight = 0;
+	int pickTriangles = 0; // MeshBVH built over a sphere of about this many triangles, then a fixed set of rays picked (0: off)
+	bool imageBench = false; // every image of Assets/ is loaded with ImageFromFile, decode time and peak buffer memory reported
+	std::filesystem::path reportFile = "benchmark_report.json";
+};
+
+// Returns true if the command line requests the headless mode, the options are filled from the command line.
+bool ParseHeadlessBenchmarkOptions( int argc, char* args[], HeadlessBenchmarkOptions& options );
+
+// Renders the scene into an offscreen framebuffer through an EGL surfaceless (or pbuffer) context, without vsync,
+// along a scripted camera path, and writes the per-frame CPU and GPU times into a JSON report.
+// Returns the process exit code.
+int RunHeadlessBenchmark( const HeadlessBenchmarkOptions& options );
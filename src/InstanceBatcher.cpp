@@ -0,0 +1,106 @@
+#include "InstanceBatcher.h"
+
+#include "GLUtils.hpp"
+
+void InstanceBatcher::Init()
+{
+	glCreateBuffers( 1, &m_bufferID );
+	m_bufferCapacity = 0;
+}
+
+void InstanceBatcher::Clean()
+{
+	glDeleteBuffers( 1, &m_bufferID );
+	m_bufferID = 0;
+	m_bufferCapacity = 0;
+
+	m_batches.clear();
+	m_batchIndices.clear();
+	m_commands.clear();
+	m_instanceCount = 0;
+}
+
+void InstanceBatcher::Clear()
+{
+	for ( Batch& batch : m_batches ) batch.instances.clear();
+	m_commands.clear();
+	m_instanceCount = 0;
+}
+
+InstanceBatcher::Batch& InstanceBatcher::FindBatch( const DrawCommand& mesh )
+{
+	// VAO and texture identify the mesh; the rest only differs if the same VAO is drawn differently
+	const std::uint64_t key = ( static_cast<std::uint64_t>( mesh.vaoID ) << 32 ) | mesh.textureID;
+
+	auto it = m_batchIndices.find( key );
+	if ( it != m_batchIndices.end() )
+	{
+		Batch& batch = m_batches[ it->second ];
+		batch.mesh = mesh;
+		return batch;
+	}
+
+	m_batchIndices.emplace( key, m_batches.size() );
+	m_batches.push_back( { mesh, {} } );
+	return m_batches.back();
+}
+
+void InstanceBatcher::Add( const DrawCommand& mesh, const InstanceTransform& instance )
+{
+	FindBatch( mesh ).instances.push_back( instance );
+}
+
+void InstanceBatcher::Add( const DrawCommand& mesh, const InstanceTransform* instances, std::size_t count )
+{
+	if ( count == 0 ) return;
+
+	std::vector<InstanceTransform>& batchInstances = FindBatch( mesh ).instances;
+	batchInstances.insert( batchInstances.end(), instances, instances + count );
+}
+
+void InstanceBatcher::Add( const DrawCommand& mesh, const InstanceTransform* instances, std::size_t count, const glm::vec3& offset )
+{
+	if ( count == 0 ) return;
+
+	std::vector<InstanceTransform>& batchInstances = FindBatch( mesh ).instances;
+	const std::size_t first = batchInstances.size();
+	batchInstances.insert( batchInstances.end(), instances, instances + count );
+	for ( std::size_t i = first; i < batchInstances.size(); ++i )
+		batchInstances[ i ].world[ 3 ] += glm::vec4( offset, 0.0f );
+}
+
+void InstanceBatcher::Upload()
+{
+	m_commands.clear();
+	m_instanceCount = 0;
+	for ( const Batch& batch : m_batches ) m_instanceCount += batch.instances.size();
+
+	if ( m_instanceCount == 0 ) return;
+
+	if ( !ReserveDynamicBuffer( m_bufferID, m_bufferCapacity, m_instanceCount * sizeof( InstanceTransform ) ) )
+	{
+		m_instanceCount = 0;
+		return;
+	}
+
+	GLuint firstInstance = 0;
+	for ( const Batch& batch : m_batches )
+	{
+		if ( batch.instances.empty() ) continue;
+
+		glNamedBufferSubData( m_bufferID, firstInstance * sizeof( InstanceTransform ),
+							  batch.instances.size() * sizeof( InstanceTransform ), batch.instances.data() );
+
+		DrawCommand command = batch.mesh;
+		command.instanceCount = static_cast<GLsizei>( batch.instances.size() );
+		command.firstInstance = firstInstance;
+		m_commands.push_back( command );
+
+		firstInstance += static_cast<GLuint>( batch.instances.size() );
+	}
+}
+
+void InstanceBatcher::Bind() const
+{
+	glBindBufferBase( GL_SHADER_STORAGE_BUFFER, STORAGE_BINDING, m_bufferID );
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "RenderCommandList.h"
+
+// Per-instance data of the instanced shaders (std430 layout, 128 bytes).
+struct InstanceTransform
+{
+	glm::mat4 world;
+	glm::mat4 worldIT;
+};
+
+// Collects the instances of a frame by mesh and uploads them into one shader storage buffer.
+// Every non-empty batch becomes one instanced draw: instanceCount instances from firstInstance.
+class InstanceBatcher
+{
+public:
+	void Init();
+	void Clean();
+
+	// Keeps the batches (and their memory), only empties them.
+	void Clear();
+
+	// The instances of the same mesh (VAO, count, texture, sampler) are drawn together, world/worldIT of the mesh are ignored.
+	void Add( const DrawCommand& mesh, const InstanceTransform& instance );
+	void Add( const DrawCommand& mesh, const InstanceTransform* instances, std::size_t count );
+	// The same, with offset added to the translation of every instance (e.g. to move them to another origin).
+	void Add( const DrawCommand& mesh, const InstanceTransform* instances, std::size_t count, const glm::vec3& offset );
+
+	// Uploads the instances and fills the draws. Has to be called on the thread of the context.
+	void Upload();
+	// Binds the buffer for the instanced shaders.
+	void Bind() const;
+
+	const std::vector<DrawCommand>& Commands() const { return m_commands; }
+	std::size_t InstanceCount() const { return m_instanceCount; }
+
+	static constexpr GLuint STORAGE_BINDING = 0; // binding of InstanceTransforms in the shaders
+
+private:
+	struct Batch
+	{
+		DrawCommand mesh;
+		std::vector<InstanceTransform> instances;
+	};
+
+	std::vector<Batch> m_batches;
+	std::unordered_map<std::uint64_t, std::size_t> m_batchIndices;
+
+	std::vector<DrawCommand> m_commands;
+	std::size_t m_instanceCount = 0;
+
+	GLuint m_bufferID = 0;
+	std::size_t m_bufferCapacity = 0; // in bytes
+
+	Batch& FindBatch( const DrawCommand& mesh );
+};
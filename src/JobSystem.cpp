@@ -0,0 +1,143 @@
+#include "JobSystem.h"
+
+// index of the queue owned by the current thread, -1 for threads unknown to the job system
+static thread_local int t_queueIndex = -1;
+
+JobSystem::~JobSystem()
+{
+	Stop();
+}
+
+void JobSystem::Start( unsigned workerCount )
+{
+	if ( m_running ) return;
+
+	if ( workerCount == 0 )
+		workerCount = std::max( std::thread::hardware_concurrency(), 2u ) - 1;
+
+	m_queues.clear();
+	for ( unsigned i = 0; i < workerCount + 1; ++i )
+		m_queues.push_back( std::make_unique<WorkStealingQueue>() );
+
+	t_queueIndex = 0;
+	m_running = true;
+
+	for ( unsigned i = 1; i <= workerCount; ++i )
+		m_workers.emplace_back( &JobSystem::WorkerLoop, this, i );
+}
+
+void JobSystem::Stop()
+{
+	if ( !m_running ) return;
+
+	{
+		std::lock_guard<std::mutex> lock( m_sleepMutex );
+		m_running = false;
+	}
+	m_wakeUp.notify_all();
+
+	for ( std::thread& worker : m_workers ) worker.join();
+	m_workers.clear();
+	m_queues.clear();
+
+	t_queueIndex = -1;
+}
+
+unsigned JobSystem::CurrentQueueIndex() const
+{
+	return t_queueIndex < 0 ? 0u : static_cast<unsigned>( t_queueIndex );
+}
+
+void JobSystem::Schedule( Job job, JobCounter* counter )
+{
+	if ( counter ) counter->m_pending.fetch_add( 1, std::memory_order_relaxed );
+
+	// not started (or stopped): run inline, so the callers do not need a serial code path
+	if ( !m_running )
+	{
+		job();
+		if ( counter ) counter->m_pending.fetch_sub( 1, std::memory_order_release );
+		return;
+	}
+
+	// workers keep their own jobs, the main thread spreads them (it is busy submitting GL commands)
+	unsigned queueIndex = CurrentQueueIndex();
+	if ( queueIndex == 0 && !m_workers.empty() )
+		queueIndex = 1 + m_nextQueue.fetch_add( 1, std::memory_order_relaxed ) % static_cast<unsigned>( m_workers.size() );
+
+	m_queues[ queueIndex ]->Push( Task{ std::move( job ), counter } );
+
+	{
+		std::lock_guard<std::mutex> lock( m_sleepMutex );
+		m_queuedTasks.fetch_add( 1, std::memory_order_release );
+	}
+	m_wakeUp.notify_one();
+}
+
+void JobSystem::Wait( const JobCounter& counter )
+{
+	const unsigned queueIndex = CurrentQueueIndex();
+	while ( !counter.IsDone() )
+	{
+		if ( !m_running || !TryRunTask( queueIndex ) )
+			std::this_thread::yield();
+	}
+}
+
+bool JobSystem::TryRunTask( unsigned queueIndex )
+{
+	Task task;
+
+	bool found = m_queues[ queueIndex ]->Pop( task );
+	for ( std::size_t i = 1; !found && i < m_queues.size(); ++i )
+		found = m_queues[ ( queueIndex + i ) % m_queues.size() ]->Steal( task );
+
+	if ( !found ) return false;
+
+	m_queuedTasks.fetch_sub( 1, std::memory_order_relaxed );
+
+	task.job();
+	if ( task.counter ) task.counter->m_pending.fetch_sub( 1, std::memory_order_release );
+
+	return true;
+}
+
+void JobSystem::WorkerLoop( unsigned queueIndex )
+{
+	t_queueIndex = static_cast<int>( queueIndex );
+
+	while ( true )
+	{
+		if ( TryRunTask( queueIndex ) ) continue;
+
+		std::unique_lock<std::mutex> lock( m_sleepMutex );
+		m_wakeUp.wait( lock, [ this ]() { return !m_running || m_queuedTasks.load( std::memory_order_acquire ) > 0; } );
+		if ( !m_running ) return;
+	}
+}
+
+void JobSystem::WorkStealingQueue::Push( Task&& task )
+{
+	std::lock_guard<std::mutex> lock( mutex );
+	tasks.push_back( std::move( task ) );
+}
+
+bool JobSystem::WorkStealingQueue::Pop( Task& task )
+{
+	std::lock_guard<std::mutex> lock( mutex );
+	if ( tasks.empty() ) return false;
+
+	task = std::move( tasks.back() );
+	tasks.pop_back();
+	return true;
+}
+
+bool JobSystem::WorkStealingQueue::Steal( Task& task )
+{
+	std::lock_guard<std::mutex> lock( mutex );
+	if ( tasks.empty() ) return false;
+
+	task = std::move( tasks.front() );
+	tasks.pop_front();
+	return true;
+}
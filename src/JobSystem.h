@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Counts the unfinished jobs of a group, JobSystem::Wait() blocks until it reaches zero.
+class JobCounter
+{
+public:
+	bool IsDone() const { return m_pending.load( std::memory_order_acquire ) == 0; }
+
+private:
+	friend class JobSystem;
+	std::atomic<int> m_pending{ 0 };
+};
+
+// Fixed pool of worker threads, each with its own work stealing deque: the owner pushes and pops at the back (LIFO,
+// cache friendly for nested jobs), idle workers steal from the front of the others. The thread that called Start()
+// has a queue too, jobs scheduled from it are distributed over the workers. Waiting threads run jobs instead of blocking.
+class JobSystem
+{
+public:
+	using Job = std::function<void()>;
+
+	JobSystem() = default;
+	~JobSystem();
+
+	JobSystem( const JobSystem& ) = delete;
+	JobSystem& operator=( const JobSystem& ) = delete;
+
+	// workerCount == 0: one worker per hardware thread, except the calling one
+	void Start( unsigned workerCount = 0 );
+	void Stop();
+
+	unsigned WorkerCount() const { return static_cast<unsigned>( m_workers.size() ); }
+
+	void Schedule( Job job, JobCounter* counter = nullptr );
+	void Wait( const JobCounter& counter );
+
+	// fn( begin, end ) over [0, count) in chunks of at most grainSize, returns when every chunk finished
+	template <typename Function>
+	void ParallelFor( std::size_t count, std::size_t grainSize, Function fn );
+
+private:
+	struct Task
+	{
+		Job job;
+		JobCounter* counter = nullptr;
+	};
+
+	struct WorkStealingQueue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+
+		void Push( Task&& task );
+		bool Pop( Task& task );   // owner, back
+		bool Steal( Task& task ); // thief, front
+	};
+
+	std::vector<std::unique_ptr<WorkStealingQueue>> m_queues; // [0]: the thread that called Start()
+	std::vector<std::thread> m_workers;
+
+	std::atomic<bool> m_running{ false };
+	std::atomic<int> m_queuedTasks{ 0 };
+	std::atomic<unsigned> m_nextQueue{ 0 };
+	std::mutex m_sleepMutex;
+	std::condition_variable m_wakeUp;
+
+	void WorkerLoop( unsigned queueIndex );
+	bool TryRunTask( unsigned queueIndex );
+	unsigned CurrentQueueIndex() const;
+};
+
+template <typename Function>
+void JobSystem::ParallelFor( std::size_t count, std::size_t grainSize, Function fn )
+{
+	if ( count == 0 ) return;
+
+	grainSize = std::max<std::size_t>( grainSize, 1 );
+	if ( count <= grainSize || m_workers.empty() )
+	{
+		fn( std::size_t( 0 ), count );
+		return;
+	}
+
+	JobCounter counter;
+	for ( std::size_t begin = 0; begin < count; begin += grainSize )
+	{
+		const std::size_t end = std::min( begin + grainSize, count );
+		Schedule( [ &fn, begin, end ]() { fn( begin, end ); }, &counter );
+	}
+	Wait( counter );
+}
@@ -0,0 +1,151 @@
+#include "LightClusters.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "GLUtils.hpp"
+
+void LightClusters::Init()
+{
+	glCreateBuffers( 1, &m_lightBufferID );
+	glCreateBuffers( 1, &m_clusterBufferID );
+	glCreateBuffers( 1, &m_indexBufferID );
+
+	glNamedBufferData( m_clusterBufferID, CLUSTER_COUNT * sizeof( glm::uvec2 ), nullptr, GL_DYNAMIC_DRAW );
+	m_lightCapacity = 0;
+	m_indexCapacity = 0;
+}
+
+void LightClusters::Clean()
+{
+	glDeleteBuffers( 1, &m_lightBufferID );
+	glDeleteBuffers( 1, &m_clusterBufferID );
+	glDeleteBuffers( 1, &m_indexBufferID );
+	m_lightBufferID = m_clusterBufferID = m_indexBufferID = 0;
+	m_lightCapacity = m_indexCapacity = 0;
+}
+
+// exponential slices: every slice is the same ratio deeper than the previous one
+std::uint32_t LightClusters::SliceOfDepth( float depth ) const
+{
+	if ( depth <= m_depthRange.x ) return 0;
+
+	const float slice = std::log( depth / m_depthRange.x ) / std::log( m_depthRange.y / m_depthRange.x ) * GRID_Z;
+	return std::min( static_cast<std::uint32_t>( slice ), GRID_Z - 1 );
+}
+
+float LightClusters::DepthOfSlice( std::uint32_t slice ) const
+{
+	return m_depthRange.x * std::pow( m_depthRange.y / m_depthRange.x, static_cast<float>( slice ) / GRID_Z );
+}
+
+// Tile range [first, last] along one screen axis of the sphere part between the depths near and far:
+// the tile boundaries are planes through the eye, x / depth = ( 2 i / count - 1 ) * tanHalf.
+static void TileRange( float center, float radius, float nearDepth, float farDepth, float tanHalf, std::uint32_t count,
+					   std::uint32_t& first, std::uint32_t& last )
+{
+	// (center -+ radius) / depth is monotonic in the depth, the extremes are at the ends of the range
+	const float low = std::min( ( center - radius ) / nearDepth, ( center - radius ) / farDepth );
+	const float high = std::max( ( center + radius ) / nearDepth, ( center + radius ) / farDepth );
+
+	auto toTile = [ tanHalf, count ]( float ratio )
+	{
+		const float tile = ( ratio / tanHalf * 0.5f + 0.5f ) * static_cast<float>( count );
+		return static_cast<std::int32_t>( std::floor( std::clamp( tile, -1.0f, static_cast<float>( count ) ) ) );
+	};
+
+	first = static_cast<std::uint32_t>( std::clamp( toTile( low ), 0, static_cast<std::int32_t>( count ) - 1 ) );
+	last = static_cast<std::uint32_t>( std::clamp( toTile( high ), 0, static_cast<std::int32_t>( count ) - 1 ) );
+}
+
+void LightClusters::Build( const std::vector<PointLight>& lights, const glm::dvec3& origin, const glm::mat4& view, float fovy, float aspect, glm::vec2 depthRange )
+{
+	m_view = view;
+	m_depthRange = depthRange;
+	m_lights = lights;
+	for ( PointLight& light : m_lights )
+		light.position = glm::vec3( glm::dvec3( light.position ) - origin );
+
+	const float tanHalfY = std::tan( fovy * 0.5f );
+	const float tanHalfX = tanHalfY * aspect;
+
+	// 1. the clusters touched by every light, counted per cluster
+	std::vector<std::uint32_t> counts( CLUSTER_COUNT, 0 );
+	m_bounds.resize( m_lights.size() );
+	for ( std::size_t i = 0; i < m_lights.size(); ++i )
+	{
+		LightBounds& bounds = m_bounds[ i ];
+		bounds.slice0 = 1;
+		bounds.slice1 = 0; // empty
+
+		const PointLight& light = m_lights[ i ];
+		const glm::vec3 center = glm::vec3( view * glm::vec4( light.position, 1.0f ) );
+		const float depth = -center.z;
+
+		if ( depth + light.radius <= 0.0f || depth - light.radius >= m_depthRange.y ) continue;
+
+		bounds.slice0 = SliceOfDepth( depth - light.radius );
+		bounds.slice1 = SliceOfDepth( depth + light.radius );
+
+		for ( std::uint32_t z = bounds.slice0; z <= bounds.slice1; ++z )
+		{
+			// the part of the sphere inside the slice (the first slice starts at the eye)
+			const float nearDepth = std::max( { z == 0 ? 1e-3f : DepthOfSlice( z ), depth - light.radius, 1e-3f } );
+			const float farDepth = std::max( std::min( z + 1 == GRID_Z ? m_depthRange.y : DepthOfSlice( z + 1 ), depth + light.radius ), nearDepth );
+
+			TileRange( center.x, light.radius, nearDepth, farDepth, tanHalfX, GRID_X, bounds.x0[ z ], bounds.x1[ z ] );
+			TileRange( center.y, light.radius, nearDepth, farDepth, tanHalfY, GRID_Y, bounds.y0[ z ], bounds.y1[ z ] );
+
+			for ( std::uint32_t y = bounds.y0[ z ]; y <= bounds.y1[ z ]; ++y )
+				for ( std::uint32_t x = bounds.x0[ z ]; x <= bounds.x1[ z ]; ++x )
+					++counts[ ( z * GRID_Y + y ) * GRID_X + x ];
+		}
+	}
+
+	// 2. prefix sum: the range of every cluster in the index list
+	m_clusters.resize( CLUSTER_COUNT );
+	std::uint32_t offset = 0;
+	m_maxLightsPerCluster = 0;
+	for ( std::uint32_t c = 0; c < CLUSTER_COUNT; ++c )
+	{
+		m_clusters[ c ] = glm::uvec2( offset, 0 );
+		offset += counts[ c ];
+		m_maxLightsPerCluster = std::max( m_maxLightsPerCluster, counts[ c ] );
+	}
+
+	// 3. the light indices, in light order inside every cluster
+	m_indices.resize( offset );
+	for ( std::size_t i = 0; i < m_lights.size(); ++i )
+	{
+		const LightBounds& bounds = m_bounds[ i ];
+		for ( std::uint32_t z = bounds.slice0; z <= bounds.slice1; ++z )
+			for ( std::uint32_t y = bounds.y0[ z ]; y <= bounds.y1[ z ]; ++y )
+				for ( std::uint32_t x = bounds.x0[ z ]; x <= bounds.x1[ z ]; ++x )
+				{
+					glm::uvec2& cluster = m_clusters[ ( z * GRID_Y + y ) * GRID_X + x ];
+					m_indices[ cluster.x + cluster.y++ ] = static_cast<std::uint32_t>( i );
+				}
+	}
+}
+
+void LightClusters::Upload()
+{
+	UploadDynamicBuffer( m_lightBufferID, m_lightCapacity, m_lights );
+	UploadDynamicBuffer( m_indexBufferID, m_indexCapacity, m_indices );
+	glNamedBufferSubData( m_clusterBufferID, 0, m_clusters.size() * sizeof( glm::uvec2 ), m_clusters.data() );
+}
+
+void LightClusters::Bind() const
+{
+	glBindBufferBase( GL_SHADER_STORAGE_BUFFER, LIGHT_BINDING, m_lightBufferID );
+	glBindBufferBase( GL_SHADER_STORAGE_BUFFER, CLUSTER_BINDING, m_clusterBufferID );
+	glBindBufferBase( GL_SHADER_STORAGE_BUFFER, INDEX_BINDING, m_indexBufferID );
+}
+
+void LightClusters::SetUniforms( GLuint programID, const glm::vec2& viewportSize ) const
+{
+	glProgramUniform3ui( programID, ul( programID, "clusterGrid" ), GRID_X, GRID_Y, GRID_Z );
+	glProgramUniform2f( programID, ul( programID, "clusterDepthRange" ), m_depthRange.x, m_depthRange.y );
+	glProgramUniform2f( programID, ul( programID, "viewportSize" ), viewportSize.x, viewportSize.y );
+	glProgramUniformMatrix4fv( programID, ul( programID, "view" ), 1, GL_FALSE, &m_view[ 0 ][ 0 ] );
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+// Point light of the clustered shading (std430 layout, matches PointLight in Shaders/Frag_Lighting.frag).
+struct PointLight
+{
+	glm::vec3 position;
+	float radius; // no light beyond this distance
+	glm::vec3 color;
+	float padding = 0.0f;
+};
+
+// Clustered forward lighting: the view frustum is split into a 3D grid (screen tiles x exponential depth slices),
+// the lights are binned into the clusters their sphere touches on the CPU, and the fragment shader only loops over
+// the lights of its own cluster. Lights, per-cluster ranges and the light index list live in shader storage buffers.
+class LightClusters
+{
+public:
+	void Init();
+	void Clean();
+
+	// The light positions are taken relative to origin (the camera position with camera-relative rendering),
+	// view: that space -> view space, fovy and aspect: those of the projection.
+	// Beyond depthRange the lights are not binned (the last slice ends there).
+	void Build( const std::vector<PointLight>& lights, const glm::dvec3& origin, const glm::mat4& view, float fovy, float aspect, glm::vec2 depthRange );
+	// Uploads the lights and the clusters, has to be called on the thread of the context.
+	void Upload();
+	void Bind() const;
+	// The uniforms of the lighting shader ("clusterGrid", "clusterDepthRange", "view", "viewportSize").
+	void SetUniforms( GLuint programID, const glm::vec2& viewportSize ) const;
+
+	std::size_t LightCount() const { return m_lights.size(); }
+	std::size_t IndexCount() const { return m_indices.size(); }
+	std::uint32_t MaxLightsPerCluster() const { return m_maxLightsPerCluster; }
+
+	static constexpr std::uint32_t GRID_X = 16;
+	static constexpr std::uint32_t GRID_Y = 9;
+	static constexpr std::uint32_t GRID_Z = 24;
+	static constexpr std::uint32_t CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+
+	static constexpr GLuint LIGHT_BINDING = 3;
+	static constexpr GLuint CLUSTER_BINDING = 4;
+	static constexpr GLuint INDEX_BINDING = 5;
+
+private:
+	// the touched cluster range of one light
+	struct LightBounds
+	{
+		std::uint32_t slice0, slice1;
+		std::uint32_t x0[ GRID_Z ], x1[ GRID_Z ], y0[ GRID_Z ], y1[ GRID_Z ];
+	};
+
+	std::vector<PointLight> m_lights;
+	std::vector<LightBounds> m_bounds;
+	std::vector<glm::uvec2> m_clusters; // offset and count in m_indices
+	std::vector<std::uint32_t> m_indices;
+	std::uint32_t m_maxLightsPerCluster = 0;
+
+	glm::mat4 m_view = glm::mat4( 1.0f );
+	glm::vec2 m_depthRange = glm::vec2( 0.1f, 100.0f );
+
+	GLuint m_lightBufferID = 0;
+	GLuint m_clusterBufferID = 0;
+	GLuint m_indexBufferID = 0;
+	std::size_t m_lightCapacity = 0; // in bytes
+	std::size_t m_indexCapacity = 0;
+
+	std::uint32_t SliceOfDepth( float depth ) const;
+	float DepthOfSlice( std::uint32_t slice ) const;
+};
@@ -3,13 +3,15 @@
 #include "ObjParser.h"
 #include "ParametricSurfaceMesh.hpp"
 #include "ParametricSurface.h"
-#include "ProgramBuilder.h"
+#include "TextureCache.h"
 
 #include <imgui.h>
 
 #include <string>
 #include <array>
 #include <algorithm>
+#include <chrono>
+#include <cmath>
 
 CMyApp::CMyApp()
 {
@@ -35,45 +37,58 @@ void CMyApp::SetupDebugCallback()
 
 void CMyApp::InitShaders()
 {
-	m_programID = glCreateProgram();
-	ProgramBuilder{ m_programID }
-		.ShaderStage( GL_VERTEX_SHADER, "Shaders/Vert_PosNormTex.vert" )
-		.ShaderStage( GL_FRAGMENT_SHADER, "Shaders/Frag_Lighting.frag" )
-		.Link();
+	m_shaderReloader.AddProgram( &m_programID, {
+		{ GL_VERTEX_SHADER,   "Shaders/Vert_PosNormTex.vert" },
+		{ GL_FRAGMENT_SHADER, "Shaders/Frag_Lighting.frag" } } );
+
+	// ugyanez példányosított rajzoláshoz, a transzformációk az InstanceBatcher pufferéből jönnek
+	m_shaderReloader.AddProgram( &m_programInstancedID, {
+		{ GL_VERTEX_SHADER,   "Shaders/Vert_PosNormTex_instanced.vert" },
+		{ GL_FRAGMENT_SHADER, "Shaders/Frag_Lighting.frag" } } );
+
+	// mélységi menetek (árnyéktérképek) a csak pozíciót olvasó VAO-kkal
+	m_shaderReloader.AddProgram( &m_programDepthID, {
+		{ GL_VERTEX_SHADER,   "Shaders/Vert_depth.vert" },
+		{ GL_FRAGMENT_SHADER, "Shaders/Frag_depth.frag" } } );
+
+	m_shaderReloader.AddProgram( &m_programDepthInstancedID, {
+		{ GL_VERTEX_SHADER,   "Shaders/Vert_depth_instanced.vert" },
+		{ GL_FRAGMENT_SHADER, "Shaders/Frag_depth.frag" } } );
+
+	// a víz: a rács csúcsait az FFT elmozdulás textúrája mozgatja, a mélységi előmenetnek ugyanazzal a vertex shaderrel
+	m_shaderReloader.AddProgram( &m_programWaterID, {
+		{ GL_VERTEX_SHADER,   "Shaders/Vert_water.vert" },
+		{ GL_FRAGMENT_SHADER, "Shaders/Frag_Lighting.frag" } } );
+
+	m_shaderReloader.AddProgram( &m_programWaterDepthID, {
+		{ GL_VERTEX_SHADER,   "Shaders/Vert_water.vert" },
+		{ GL_FRAGMENT_SHADER, "Shaders/Frag_depth.frag" } } );
 	
 	InitSkyboxShaders();
 	
-	m_programAxis = glCreateProgram();
-	ProgramBuilder{ m_programAxis }
-		.ShaderStage(GL_VERTEX_SHADER, "Shaders/Vert_axes.vert")
-		.ShaderStage(GL_FRAGMENT_SHADER, "Shaders/Frag_PosCol.frag")
-		.Link();
+	m_shaderReloader.AddProgram( &m_programAxis, {
+		{ GL_VERTEX_SHADER,   "Shaders/Vert_axes.vert" },
+		{ GL_FRAGMENT_SHADER, "Shaders/Frag_PosCol.frag" } } );
+
+	m_shaderReloader.AddProgram( &m_programTrajectory, {
+		{ GL_VERTEX_SHADER,   "Shaders/Vert_traj.vert" },
+		{ GL_FRAGMENT_SHADER, "Shaders/Frag_PosCol.frag" } } );
 
 }
 
 void CMyApp::InitSkyboxShaders()
 {
-	m_programSkyboxID = glCreateProgram();
-	ProgramBuilder{ m_programSkyboxID }
-	.ShaderStage(GL_VERTEX_SHADER, "Shaders/Vert_skybox.vert")
-	.ShaderStage(GL_FRAGMENT_SHADER, "Shaders/Frag_skybox_skeleton.frag")
-	.Link();
+	m_shaderReloader.AddProgram( &m_programSkyboxID, {
+		{ GL_VERTEX_SHADER,   "Shaders/Vert_skybox.vert" },
+		{ GL_FRAGMENT_SHADER, "Shaders/Frag_skybox_skeleton.frag" } } );
 
 }
 
 
 void CMyApp::CleanShaders()
 {
-	glDeleteProgram( m_programID );
-	glDeleteProgram( m_programID );
-
-	CleanSkyboxShaders();
-
-}
-
-void CMyApp::CleanSkyboxShaders()
-{
-	glDeleteProgram( m_programSkyboxID );
+	// minden programot (a skyboxét és a tengelyekét is) a reloader töröl
+	m_shaderReloader.DeletePrograms();
 }
 
 
@@ -108,11 +123,24 @@ void CMyApp::InitGeometry()
 
     MeshObject<Vertex> suzanneMeshCPU = ObjParser::parse("Assets/Suzanne.obj");
     m_SuzanneGPU = CreateGLObjectFromMesh(suzanneMeshCPU,vertexAttribList);
+	m_SuzanneBVH.Build( suzanneMeshCPU );
 
 	MeshObject<Vertex> SurfaceMeshCPU = GetParamSurfMesh( b );
 	m_SurfaceGPU = CreateGLObjectFromMesh( SurfaceMeshCPU, vertexAttribList );
+	m_SurfaceBVH.Build( SurfaceMeshCPU );
+
+	// a színtér objektumainak transzformációi, az Update állítja be őket
+	m_transforms.Clear();
+	for ( TransformHandle& transform : m_objectTransform )
+		transform = m_transforms.Create();
+
+	// a színtér BVH-ja az első Update-ben épül fel, amikor már ismertek a világ transzformációk
+	m_sceneBVH.Clear();
 
 	InitSkyboxGeometry();
+
+	// a tengelyek a gl_VertexID-ből számolnak, de core profilban is kell egy VAO a rajzoláshoz
+	glCreateVertexArrays( 1, &m_AxesVAO );
 }
 
 void CMyApp::CleanGeometry()
@@ -120,6 +148,9 @@ void CMyApp::CleanGeometry()
 	CleanOGLObject( m_SurfaceGPU );
     CleanOGLObject( m_SuzanneGPU );
     CleanSkyboxGeometry();
+
+	glDeleteVertexArrays( 1, &m_AxesVAO );
+	m_AxesVAO = 0;
 }
 
 void CMyApp::InitSkyboxGeometry()
@@ -164,6 +195,8 @@ void CMyApp::InitSkyboxGeometry()
 		}
 	};
 
+	ComputeMeshBounds( skyboxCPU );
+
 	m_SkyboxGPU = CreateGLObjectFromMesh( skyboxCPU, { { 0, offsetof( glm::vec3,x ), 3, GL_FLOAT } } );
 }
 
@@ -184,24 +217,15 @@ void CMyApp::InitTextures()
 
 	// diffuse texture
 
-	ImageRGBA Image = ImageFromFile( "Assets/color_checkerboard.png" );
-
-	glCreateTextures( GL_TEXTURE_2D, 1, &m_TextureID );
-	glTextureStorage2D( m_TextureID, NumberOfMIPLevels( Image ), GL_RGBA8, Image.width, Image.height );
-	glTextureSubImage2D( m_TextureID, 0, 0, 0, Image.width, Image.height, GL_RGBA, GL_UNSIGNED_BYTE, Image.data() );
+	// a MIP szinteket a CPU állítja elő, tömörítve az Assets/ mappában cache-eljük ( *.texcache )
+	m_TextureID = TextureFromFileCached( "Assets/color_checkerboard.png" );
 
-	glGenerateTextureMipmap( m_TextureID );
+	m_SuzanneTextureID = TextureFromFileCached( "Assets/wood.jpg" );
 
-	ImageRGBA SuzanneImage = ImageFromFile( "Assets/wood.jpg" );
-
-	glCreateTextures( GL_TEXTURE_2D, 1, &m_SuzanneTextureID );
-	glTextureStorage2D( m_SuzanneTextureID, NumberOfMIPLevels( SuzanneImage ), GL_RGBA8, SuzanneImage.width, SuzanneImage.height );
-	glTextureSubImage2D( m_SuzanneTextureID, 0, 0, 0, SuzanneImage.width, SuzanneImage.height, GL_RGBA, GL_UNSIGNED_BYTE, SuzanneImage.data() );
-
-	glGenerateTextureMipmap( m_SuzanneTextureID );
-
-	InitSkyboxTextures();
+	// az égbolt alapból procedurális, a hat képet csak akkor töltjük be, ha a textúrás égboltot választják (SkyboxTexture)
+	m_proceduralSky.Init( m_skyFaceSize );
 
+	glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
 }
 
 void CMyApp::CleanTextures()
@@ -210,6 +234,7 @@ void CMyApp::CleanTextures()
 	glDeleteTextures( 1, &m_SuzanneTextureID );
 
 	CleanSkyboxTextures();
+	m_proceduralSky.Clean();
 }
 
 void CMyApp::InitSkyboxTextures()
@@ -237,13 +262,29 @@ void CMyApp::InitSkyboxTextures()
 	 {
 	 	glTextureSubImage3D( m_SkyboxTextureID, 0, 0, 0, face, images[ face ].width, images[ face ].height, 1, GL_RGBA, GL_UNSIGNED_BYTE, images[ face ].data() );
 	 }
-
-	 glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
 }
 
 void CMyApp::CleanSkyboxTextures()
 {
 	 glDeleteTextures( 1, &m_SkyboxTextureID );
+	 m_SkyboxTextureID = 0;
+}
+
+GLuint CMyApp::SkyboxTexture()
+{
+	if ( m_skySource == SKY_TEXTURES )
+	{
+		if ( m_SkyboxTextureID == 0 ) InitSkyboxTextures();
+		return m_SkyboxTextureID;
+	}
+
+	// a nap a fényforrás irányában
+	m_skyParameters.model = m_skySource == SKY_GRADIENT ? SkyModel::GRADIENT : SkyModel::PREETHAM;
+	m_skyParameters.sunDirection = glm::normalize( m_lightDirection );
+	const bool rebuilt = m_proceduralSky.Update( m_skyParameters );
+	m_profiler.SetCounter( "Sky rebuilt", rebuilt ? 1.0 : 0.0 );
+
+	return m_proceduralSky.TextureID();
 }
 
 
@@ -251,16 +292,30 @@ bool CMyApp::Init()
 {
 	SetupDebugCallback();
 
+	m_profiler.Init();
+
 	// törlési szín legyen kékes
 	glClearColor(0.125f, 0.25f, 0.5f, 1.0f);
 
 	glPointSize( 16.0f ); // nagyobb pontok
 	glLineWidth( 4.0f ); // vastagabb vonalak
 
+	m_shaderReloader.Init( "Shaders" );
 	InitShaders();
 	InitGeometry();
 	InitTextures();
 
+	m_instanceBatcher.Init();
+	m_shadowInstanceBatcher.Init();
+	m_trajectoryBuffer.Init();
+	m_lightClusters.Init();
+	m_shadowMap.Init( m_shadowResolution );
+	m_prepassSelector.Init();
+	// a víz rácsa, spektruma és pufferei csak az első bekapcsoláskor jönnek létre (Update), az indulást nem lassítják
+
+	m_jobs.Start();
+	m_crowd.Init( m_jobs );
+
 	//
 	// egyéb inicializálás
 	//
@@ -272,8 +327,8 @@ bool CMyApp::Init()
 
 	// kamera
 	m_camera.SetView(
-		glm::vec3(0.0, 7.0, 7.0),	// honnan nézzük a színteret	   - eye
-		glm::vec3(0.0, 0.0, 0.0),   // a színtér melyik pontját nézzük - at
+		glm::dvec3(0.0, 7.0, 7.0),	// honnan nézzük a színteret	   - eye
+		glm::dvec3(0.0, 0.0, 0.0),  // a színtér melyik pontját nézzük - at
 		glm::vec3(0.0, 1.0, 0.0));  // felfelé mutató irány a világban - up
 
 	m_cameraManipulator.SetCamera( &m_camera );
@@ -281,33 +336,238 @@ bool CMyApp::Init()
 
 	m_controlPoints.push_back(glm::vec3(-1.0f, 0.0, -1.0f));
 	m_controlPoints.push_back(glm::vec3( 1.0f, 0.0,  1.0f));
+	RebuildTrajectory();
 
 	return true;
 }
 
 void CMyApp::Clean()
 {
+	// a munkaszálak még a mostani képkockán dolgozhatnak
+	m_crowd.Clean();
+	m_jobs.Stop();
+
+	m_instanceBatcher.Clean();
+	m_shadowInstanceBatcher.Clean();
+	m_trajectoryBuffer.Clean();
+	m_lightClusters.Clean();
+	m_shadowMap.Clean();
+	m_prepassSelector.Clean();
+	m_water.Clean();
+
 	CleanShaders();
 	CleanGeometry();
 	CleanTextures();
+
+	m_shaderReloader.Clean();
+	m_profiler.Clean();
 }
 
 void CMyApp::Update( const SUpdateInfo& updateInfo )
 {
 	m_ElapsedTimeInSec = updateInfo.ElapsedTimeInSec;
 
+	// megváltozott shaderek újrafordítása, a kész programok cseréje (nem blokkol)
+	m_shaderReloader.Update();
+
 	m_cameraManipulator.Update( updateInfo.DeltaTimeInSec );
 	
 	// kivetelesen a fényforrás a kamera pozíciója legyen, hogy mindig lássuk a feluletet,
 	// es ne keljen allitgatni a fenyforrast
-    m_lightPos = glm::vec4( m_camera.GetEye(), 1.0 );
+	// (a shaderek kamerához relatív koordinátákban számolnak, a kamera az origóban van)
+    m_lightPos = glm::vec4( 0.0, 0.0, 0.0, 1.0 );
 	//m_lightPos = glm::vec4(5, 5, 5, 1);
+	// irány fényforrás esetén a GUI-n állított irány
+	if ( m_directionalLight )
+		m_lightPos = glm::vec4( m_lightDirection, 0.0f );
+
+	UpdateSceneObjects();
+	UpdateFollowers();
+	UpdatePointLights();
+
+	// Az előző képkockában indított építés eredményét rajzoljuk most ki, közben a munkaszálak már a következőt építik.
+	// A vágás így egy képkockával korábbi kamerával történik.
+	CrowdFrameInput crowdInput;
+	crowdInput.origin = m_camera.GetEye();
+	crowdInput.viewProj = m_camera.GetRelativeViewProj();
+	crowdInput.time = m_ElapsedTimeInSec + updateInfo.DeltaTimeInSec;
+	crowdInput.count = m_crowdSize;
+	crowdInput.parallel = m_multithreaded;
+	crowdInput.instanced = m_instancing;
+	crowdInput.shadowCasters = m_shadows && m_directionalLight;
+	crowdInput.vaoID = m_SuzanneGPU.vaoID;
+	crowdInput.depthVaoID = m_SuzanneGPU.depthVaoID;
+	crowdInput.indexCount = m_SuzanneGPU.count;
+	crowdInput.textureID = m_SuzanneTextureID;
+	crowdInput.samplerID = m_SamplerID;
+	crowdInput.meshBounds = m_SuzanneGPU.boundingSphere;
+	{
+		ProfileZone zone( m_profiler, "CrowdWait" );
+		m_crowd.Finish();
+	}
+
+	// a víz spektruma a szabad munkaszálakon, mielőtt a következő tömeg építése elindul
+	if ( m_showWater )
+	{
+		ProfileZone zone( m_profiler, "WaterFFT" );
+
+		if ( !m_water.IsInitialized() )
+			m_water.Init( WATER_GRID_RESOLUTION, WATER_FFT_SIZE, m_oceanParameters );
+		m_water.SetParameters( m_oceanParameters );
+		m_water.Update( m_ElapsedTimeInSec, m_jobs );
+	}
+
+	m_crowd.Kick( crowdInput );
+}
+
+void CMyApp::FixedUpdate( const SUpdateInfo& updateInfo )
+{
+	m_previousParam = m_currentParam;
+
+	if ( !m_animatePath ) return;
+
+	// oda-vissza a két végpont között
+	m_currentParam += m_pathDirection * m_pathSpeed * updateInfo.DeltaTimeInSec;
+	if ( m_currentParam > 1.0f || m_currentParam < 0.0f )
+	{
+		m_currentParam = glm::clamp( m_currentParam, 0.0f, 1.0f );
+		m_pathDirection = -m_pathDirection;
+	}
+}
+
+float CMyApp::RenderedPathParam() const
+{
+	if ( !m_animatePath ) return m_currentParam;
+
+	return glm::mix( m_previousParam, m_currentParam, m_interpolationAlpha );
+}
+
+void CMyApp::UpdateFollowers()
+{
+	// egyenletes távolságra egymástól, együtt haladnak a pályán; egy kötegben értékeljük ki mindet
+	const std::size_t count = static_cast<std::size_t>( m_followerCount );
+	m_followerDistances.resize( count );
+	m_followerPositions.resize( count );
+	m_followerFrames.resize( count );
+	m_followerTransforms.Resize( count );
+
+	const float length = m_trajectory.Length();
+	const float start = RenderedPathParam() * length;
+	for ( std::size_t i = 0; i < count; ++i )
+		m_followerDistances[ i ] = std::fmod( start + length * static_cast<float>( i + 1 ) / static_cast<float>( count + 1 ), length > 0.0f ? length : 1.0f );
+
+	m_trajectory.EvaluateFrameBatch( m_followerDistances.data(), count, m_followerPositions.data(), m_followerFrames.data() );
+
+	for ( std::size_t i = 0; i < count; ++i )
+		m_followerTransforms.SetTRS( static_cast<TransformHandle>( i ), glm::dvec3( m_followerPositions[ i ] ),
+									 glm::quat_cast( PathOrientation( m_followerFrames[ i ] ) ), glm::vec3( FOLLOWER_SCALE ) );
+	m_followerTransforms.Update();
+}
+
+void CMyApp::UpdatePointLights()
+{
+	// determinisztikus elrendezés: a fények a tömeg gyűrűjében keringenek, a sugár, magasság, sebesség és szín az indexből jön
+	const std::size_t count = static_cast<std::size_t>( std::clamp( m_pointLightCount, 0, MAX_POINT_LIGHT_COUNT ) );
+	m_pointLights.resize( count );
+
+	const float time = static_cast<float>( m_ElapsedTimeInSec );
+	for ( std::size_t i = 0; i < count; ++i )
+	{
+		const float golden = static_cast<float>( i ) * 0.618034f;
+		const float u = golden - std::floor( golden );
+		const float orbit = 2.0f + 20.0f * std::sqrt( static_cast<float>( i % 97 ) / 96.0f );
+		const float height = 0.5f + 2.5f * u;
+		const float speed = ( i % 2 == 0 ? 1.0f : -1.0f ) * ( 0.1f + 0.3f * u ) * 5.0f / orbit;
+		const float angle = static_cast<float>( i ) * 2.399963f + speed * time; // aranyszög
+
+		PointLight& light = m_pointLights[ i ];
+		light.position = glm::vec3( orbit * std::cos( angle ), height, orbit * std::sin( angle ) );
+		light.radius = m_pointLightRadius;
+		// a színkör mentén telített színek
+		light.color = glm::clamp( glm::abs( glm::mod( glm::vec3( u * 6.0f ) + glm::vec3( 0.0f, 4.0f, 2.0f ), glm::vec3( 6.0f ) ) - glm::vec3( 3.0f ) ) - glm::vec3( 1.0f ), glm::vec3( 0.0f ), glm::vec3( 1.0f ) ) * 4.0f;
+	}
+}
+
+void CMyApp::UpdateSceneObjects()
+{
+	const float pathParam = RenderedPathParam();
+	glm::vec3 current_pos = EvaluatePathPosition( pathParam );
+
+	const glm::quat rotation = glm::quat_cast( PathOrientation( EvaluatePathFrame( pathParam ) ) );
+
+	// a felület és Suzanne is a pályán mozog; a mátrixokat (a normálmátrixot is) a transzformációs rendszer számolja
+	m_transforms.SetTRS( m_objectTransform[ SCENE_SURFACE ], glm::dvec3( current_pos ), rotation, glm::vec3( 1.0f ) );
+	m_transforms.SetTRS( m_objectTransform[ SCENE_SUZANNE ], glm::dvec3( current_pos ), rotation, glm::vec3( 1.0f ) );
+	m_transforms.Update();
+
+	const OGLObject* objectGPU[ SCENE_OBJECT_COUNT ] = { &m_SurfaceGPU, &m_SuzanneGPU };
+
+	if ( m_sceneBVH.IsEmpty() )
+	{
+		std::vector<AABB> objectBounds( SCENE_OBJECT_COUNT );
+		for ( int i = 0; i < SCENE_OBJECT_COUNT; ++i )
+			objectBounds[ i ] = TransformAABB( objectGPU[ i ]->bounds, ObjectWorld( i ) );
+		m_sceneBVH.Build( objectBounds );
+	}
+	else
+	{
+		// csak a mozgó objektumok levelei és azok ősei frissülnek, a fa szerkezete marad
+		for ( int i = 0; i < SCENE_OBJECT_COUNT; ++i )
+			m_sceneBVH.RefitPrimitive( i, TransformAABB( objectGPU[ i ]->bounds, ObjectWorld( i ) ) );
+	}
+}
+
+void CMyApp::Pick( int x, int y )
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	// egérpozíció -> NDC -> a közeli és a távoli vágósík pontja világ térben
+	const glm::vec2 ndc( 2.0f * ( x + 0.5f ) / m_windowWidth - 1.0f, 1.0f - 2.0f * ( y + 0.5f ) / m_windowHeight );
+	const glm::mat4 invViewProj = glm::inverse( m_camera.GetViewProj() );
+	glm::vec4 nearPoint = invViewProj * glm::vec4( ndc, -1.0f, 1.0f );
+	glm::vec4 farPoint  = invViewProj * glm::vec4( ndc,  1.0f, 1.0f );
+	nearPoint /= nearPoint.w;
+	farPoint  /= farPoint.w;
+
+	Ray ray;
+	ray.origin = glm::vec3( nearPoint );
+	ray.direction = glm::vec3( farPoint - nearPoint ); // t = 1 a távoli vágósík
+
+	const MeshBVH* objectBVH[ SCENE_OBJECT_COUNT ] = { &m_SurfaceBVH, &m_SuzanneBVH };
+
+	m_pickedObject = -1;
+	float tMax = 1.0f;
+	m_sceneBVH.Traverse( ray, tMax, [ & ]( std::uint32_t slot, float& tClosest )
+	{
+		const std::uint32_t object = m_sceneBVH.PrimitiveAt( slot );
+
+		// a sugarat visszük modell térbe, a paraméterezése (t) nem változik
+		const glm::mat4 invWorld = glm::inverse( ObjectWorld( object ) );
+		Ray localRay;
+		localRay.origin = glm::vec3( invWorld * glm::vec4( ray.origin, 1.0f ) );
+		localRay.direction = glm::vec3( invWorld * glm::vec4( ray.direction, 0.0f ) );
+
+		RayHit hit;
+		hit.t = tClosest;
+		if ( objectBVH[ object ]->Intersect( localRay, hit ) )
+		{
+			tClosest = hit.t;
+			m_pickedObject = static_cast<int>( object );
+			m_pickHit = hit;
+		}
+	} );
+
+	if ( m_pickedObject != -1 )
+		m_pickPoint = ray.origin + m_pickHit.t * ray.direction;
+
+	m_pickTimeMs = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
 }
 
 void CMyApp::SetLightingUniforms( GLuint program, float Shininess, glm::vec3 Ka, glm::vec3 Kd, glm::vec3 Ks )
 {
 	// - Fényforrások beállítása
-	glProgramUniform3fv( program, ul( program, "cameraPos" ), 1, glm::value_ptr( m_camera.GetEye() ) );
+	// kamerához relatív koordináták: a kamera az origóban
+	glProgramUniform3fv( program, ul( program, "cameraPos" ), 1, glm::value_ptr( glm::vec3( 0.0f ) ) );
 	glProgramUniform4fv( program, ul( program, "lightPos" ),  1, glm::value_ptr( m_lightPos ) );
 
 	glProgramUniform3fv( program, ul( program, "La" ),		 1, glm::value_ptr( m_La ) );
@@ -328,133 +588,391 @@ void CMyApp::SetLightingUniforms( GLuint program, float Shininess, glm::vec3 Ka,
 
 void CMyApp::Render()
 {
-	// töröljük a frampuffert (GL_COLOR_BUFFER_BIT)...
-	// ... és a mélységi Z puffert (GL_DEPTH_BUFFER_BIT)
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	// az előző kirajzolás óta az ImGui, a shader újratöltés és a törölt objektumok is változtathattak az állapoton
+	m_glState.Invalidate();
+	m_glState.ResetCounters();
+
+	{
+		ProfileZone zone( m_profiler, "Clear" );
+
+		// a mélységi puffer törléséhez írhatónak kell lennie
+		m_glState.SetDepthMask( true );
+
+		// töröljük a frampuffert (GL_COLOR_BUFFER_BIT)...
+		// ... és a mélységi Z puffert (GL_DEPTH_BUFFER_BIT)
+		// a túlrajzolás megjelenítésénél fekete háttérre adódnak össze a rétegek
+		if ( m_overdrawView ) glClearColor( 0.0f, 0.0f, 0.0f, 1.0f );
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		if ( m_overdrawView ) glClearColor( 0.125f, 0.25f, 0.5f, 1.0f );
+	}
+
+	// kamerához relatív rajzolás: a GPU-ra kerülő pozíciók a kamerától mértek, a különbséget duplapontosan vesszük,
+	// így a nézeti mátrix csak forgatás, és az origótól távol sem remegnek az objektumok
+	const glm::dvec3 origin = m_camera.GetEye();
+	const glm::mat4& viewProj = m_camera.GetRelativeViewProj();
+
+	glm::vec3 pos2 = m_controlPoints[1];
+	const glm::mat4 matWorld = m_transforms.RelativeWorld( m_objectTransform[ SCENE_SUZANNE ], origin );
 
 	//
-	// Suzanne
+	// Láthatósági vizsgálat: a színtér BVH-ja a nézeti gúla ellen
 	//
+	{
+		ProfileZone zone( m_profiler, "Culling" );
 
-    // - Uniform paraméterek
-    // view és projekciós mátrix
-    glProgramUniformMatrix4fv( m_programID, ul( m_programID, "viewProj" ), 1, GL_FALSE, glm::value_ptr( m_camera.GetViewProj() ) );
+		m_visibility.assign( SCENE_OBJECT_COUNT, m_frustumCulling ? 0 : 1 );
+		if ( m_frustumCulling )
+		{
+			m_sceneBVH.CullFrustum( Frustum::FromViewProj( m_camera.GetViewProj() ), m_visibleObjects );
+			for ( std::uint32_t object : m_visibleObjects )
+				m_visibility[ object ] = 1;
+		}
+	}
 
-    glm::vec3 pos1 = m_controlPoints[0];
-	glm::vec3 pos2 = m_controlPoints[1];
-    glm::vec3 current_pos = (1.f - m_currentParam) * pos1 + m_currentParam * pos2;
+	//
+	// Pontfényforrások klaszterekbe sorolása a nézeti térben
+	//
+	const bool clusteredLights = !m_pointLights.empty();
+	if ( clusteredLights )
+	{
+		ProfileZone zone( m_profiler, "LightBinning" );
 
-	glm::vec3 u = normalize(pos2 - pos1);
-	glm::vec3 v = glm::normalize(glm::cross(u,glm::vec3(0.,1.,0.)));
-	glm::vec3 w = glm::cross(u,v); // or glm::cross(v,u) -> this way we don't need to negate the value 
-	
+		m_lightClusters.Build( m_pointLights, origin, m_camera.GetRelativeViewMatrix(), m_camera.GetAngle(), m_camera.GetAspect(),
+							   glm::vec2( 0.5f, std::min( m_clusterFar, m_camera.GetZFar() ) ) );
+		m_lightClusters.Upload();
+		m_lightClusters.Bind();
 
-	glm::mat4 matWorld = glm::translate(current_pos) * glm::mat4(glm::mat3(-v,-w,u));
+		m_profiler.SetCounter( "Light indices", static_cast<double>( m_lightClusters.IndexCount() ) );
+		m_profiler.SetCounter( "Max lights per cluster", static_cast<double>( m_lightClusters.MaxLightsPerCluster() ) );
+	}
 
-    glProgramUniformMatrix4fv( m_programID, ul( m_programID, "world" ), 1, GL_FALSE, glm::value_ptr( matWorld ) );
-    glProgramUniformMatrix4fv( m_programID, ul( m_programID, "worldIT" ), 1, GL_FALSE, glm::value_ptr( glm::transpose( glm::inverse( matWorld ) ) ) );
+	const bool shadows = m_shadows && m_directionalLight;
 
-	SetLightingUniforms(m_programID,m_Shininess,m_Ka,m_Kd,m_Ks);
+	//
+	// Kirajzolási sor: minden rajzolás egy rendezési kulccsal kerül bele (menet, program, textúra, mélység)
+	//
+	{
+		ProfileZone zone( m_profiler, "Queue" );
 
-    // - textúraegységek beállítása
-    glProgramUniform1i( m_programID, ul( m_programID, "texImage" ), 0 );
-//
-//	// - Textúrák beállítása, minden egységre külön
-	glBindTextureUnit( 0, m_TextureID );
-	glBindSampler( 0, m_SamplerID );
+		m_renderQueue.Clear();
 
-    // - VAO
-	glBindVertexArray( m_SurfaceGPU.vaoID );
+		// - a programonként közös uniformok egyszer, a world és worldIT-t a sor állítja rajzolásonként
+		glProgramUniformMatrix4fv( m_programID, ul( m_programID, "viewProj" ), 1, GL_FALSE, glm::value_ptr( viewProj ) );
+		SetLightingUniforms(m_programID,m_Shininess,m_Ka,m_Kd,m_Ks);
+		glProgramUniform1i( m_programID, ul( m_programID, "texImage" ), 0 );
 
-    // - Program
-	glUseProgram( m_programID );
+		glProgramUniformMatrix4fv( m_programInstancedID, ul( m_programInstancedID, "viewProj" ), 1, GL_FALSE, glm::value_ptr( viewProj ) );
+		SetLightingUniforms(m_programInstancedID,m_Shininess,m_Ka,m_Kd,m_Ks);
+		glProgramUniform1i( m_programInstancedID, ul( m_programInstancedID, "texImage" ), 0 );
 
-	// Rajzolási parancs kiadása
-	glDrawElements( GL_TRIANGLES,
-					m_SurfaceGPU.count,
-					GL_UNSIGNED_INT,
-					nullptr );
+		if ( m_showWater )
+		{
+			glProgramUniformMatrix4fv( m_programWaterID, ul( m_programWaterID, "viewProj" ), 1, GL_FALSE, glm::value_ptr( viewProj ) );
+			SetLightingUniforms( m_programWaterID, 64.0f, m_Ka, m_Kd, glm::vec3( 1.0f ) );
+			glProgramUniform1i( m_programWaterID, ul( m_programWaterID, "texImage" ), 0 );
+			m_water.SetUniforms( m_programWaterID, WATER_TEXTURE_UNIT );
+			m_water.SetUniforms( m_programWaterDepthID, WATER_TEXTURE_UNIT );
+			m_glState.BindTextureUnit( WATER_TEXTURE_UNIT, m_water.DisplacementTexture() );
+			m_glState.BindSampler( WATER_TEXTURE_UNIT, 0 );
+		}
 
-	glBindTextureUnit( 0, m_SuzanneTextureID );
-	glBindSampler( 0, m_SamplerID );
+		// - az irány fényforrás árnyéktérképeinek kaszkádjai a mostani kamerához
+		if ( shadows )
+			m_shadowMap.Update( m_camera, m_lightDirection, m_shadowCascadeCount, m_shadowDistance, m_shadowSplitLambda );
 
-	// - VAO
-	glBindVertexArray( m_SuzanneGPU.vaoID );
+		for ( GLuint program : { m_programID, m_programInstancedID, m_programWaterID } )
+		{
+			glProgramUniform1i( program, ul( program, "clusteredLights" ), clusteredLights );
+			if ( clusteredLights )
+				m_lightClusters.SetUniforms( program, glm::vec2( m_windowWidth, m_windowHeight ) );
+
+			// a mintavételező típusa miatt akkor is a saját egységén legyen, ha nincs árnyék
+			glProgramUniform1i( program, ul( program, "shadowMap" ), SHADOW_TEXTURE_UNIT );
+			glProgramUniform1i( program, ul( program, "shadows" ), shadows );
+			glProgramUniform1i( program, ul( program, "shadowShowCascades" ), m_shadowShowCascades );
+			glProgramUniform1i( program, ul( program, "overdrawView" ), m_overdrawView );
+			if ( shadows )
+				m_shadowMap.SetUniforms( program, SHADOW_TEXTURE_UNIT, m_shadowPCFRadius );
+		}
 
-	// - Program
-	glUseProgram( m_programID );
+		glProgramUniformMatrix4fv( m_programSkyboxID, ul( m_programSkyboxID,"viewProj"), 1, GL_FALSE, glm::value_ptr( viewProj ) );
+		glProgramUniform1i(m_programSkyboxID,ul(m_programSkyboxID,"skyboxTexture"),0);
 
-	// Rajzolási parancs kiadása
-	glDrawElements( GL_TRIANGLES,
-					m_SuzanneGPU.count,
-					GL_UNSIGNED_INT,
-					nullptr );
+		glProgramUniform1f(m_programAxis, ul(m_programAxis, "mult"), 0.5f);
+		glProgramUniformMatrix4fv(m_programAxis, ul(m_programAxis, "viewProj"), 1, GL_FALSE, glm::value_ptr( viewProj ));
 
+		// - az átlátszatlan rajzolások a mélységi előmenet sorába is bekerülnek, a csak pozíciót olvasó programmal
+		m_prepassQueue.Clear();
+		auto submitOpaque = [ this ]( GLuint programID, GLuint depthProgramID, const DrawCommand& command, float depth )
+		{
+			m_renderQueue.Submit( RENDER_PASS_OPAQUE, programID, command, depth );
+			m_prepassQueue.Submit( RENDER_PASS_OPAQUE, depthProgramID, command, depth );
+		};
+
+		// - Felület és Suzanne: a mélység a befoglaló gömb középpontjának távolsága a kamerától
+		const OGLObject* sceneObjects[ SCENE_OBJECT_COUNT ] = { &m_SurfaceGPU, &m_SuzanneGPU };
+		const GLuint sceneTextures[ SCENE_OBJECT_COUNT ] = { m_TextureID, m_SuzanneTextureID };
+		for ( int object = 0; object < SCENE_OBJECT_COUNT; ++object )
+		{
+			if ( !m_visibility[ object ] ) continue;
+
+			DrawCommand command;
+			command.vaoID = sceneObjects[ object ]->vaoID;
+			command.depthVaoID = sceneObjects[ object ]->depthVaoID;
+			command.count = sceneObjects[ object ]->count;
+			command.textureID = sceneTextures[ object ];
+			command.samplerID = m_SamplerID;
+			command.world = m_transforms.RelativeWorld( m_objectTransform[ object ], origin );
+			command.worldIT = m_transforms.NormalMatrix( m_objectTransform[ object ] );
+
+			const glm::vec3 center = glm::vec3( command.world * glm::vec4( sceneObjects[ object ]->boundingSphere.center, 1.0f ) );
+			submitOpaque( m_programID, m_programDepthID, m_renderQueue.Store( command ), glm::length( center ) );
+		}
 
-	GLint prevDepthFnc;
-	glGetIntegerv(GL_DEPTH_FUNC, &prevDepthFnc);
+		// - Animált objektumok: a munkaszálakon rögzített parancslista, nem kell másolni,
+		//   csak ha a kamera azóta elmozdult (az építésük indításakori kamerához relatívak)
+		const glm::vec3 crowdOffset = glm::vec3( m_crowd.Origin() - origin );
+		auto crowdCommand = [ &crowdOffset ]( RenderQueue& queue, const DrawCommand& command ) -> const DrawCommand&
+		{
+			if ( crowdOffset == glm::vec3( 0.0f ) ) return command;
 
-	// most kisebb-egyenlőt használjunk, mert mindent kitolunk a távoli vágósíkokra
-	glDepthFunc(GL_LEQUAL);
+			DrawCommand moved = command;
+			moved.world[ 3 ] += glm::vec4( crowdOffset, 0.0f );
+			return queue.Store( moved );
+		};
+		for ( const DrawCommand& command : m_crowd.Commands() )
+		{
+			const DrawCommand& moved = crowdCommand( m_renderQueue, command );
+			submitOpaque( m_programID, m_programDepthID, moved, glm::length( glm::vec3( moved.world[ 3 ] ) ) );
+		}
 
-	// - uniform parameterek
-	glProgramUniformMatrix4fv( m_programSkyboxID, ul( m_programSkyboxID,"viewProj"), 1, GL_FALSE, glm::value_ptr( m_camera.GetViewProj() ) );
-	glProgramUniformMatrix4fv( m_programSkyboxID, ul( m_programSkyboxID,"world"),    1, GL_FALSE, glm::value_ptr( glm::translate( m_camera.GetEye() ) ) );
+		// - Példányosított rajzolás: hálónként egy rajzolási parancs, a transzformációk egy pufferben
+		m_instanceBatcher.Clear();
+		m_instanceBatcher.Add( m_crowd.Mesh(), m_crowd.Instances().data(), m_crowd.Instances().size(), crowdOffset );
+
+		DrawCommand followerMesh;
+		followerMesh.vaoID = m_SuzanneGPU.vaoID;
+		followerMesh.depthVaoID = m_SuzanneGPU.depthVaoID;
+		followerMesh.count = m_SuzanneGPU.count;
+		followerMesh.textureID = m_SuzanneTextureID;
+		followerMesh.samplerID = m_SamplerID;
+		for ( TransformHandle follower = 0; follower < m_followerTransforms.Size(); ++follower )
+			m_instanceBatcher.Add( followerMesh, { m_followerTransforms.RelativeWorld( follower, origin ), m_followerTransforms.NormalMatrix( follower ) } );
+		m_instanceBatcher.Upload();
+		m_instanceBatcher.Bind();
+
+		for ( const DrawCommand& command : m_instanceBatcher.Commands() )
+			submitOpaque( m_programInstancedID, m_programDepthInstancedID, command, 0.0f );
+
+		// - Víz: egy rajzolás az egész rácsra, árnyékot nem vet
+		if ( m_showWater )
+		{
+			DrawCommand command = m_water.Command();
+			command.samplerID = m_SamplerID;
+			command.world = glm::translate( m_camera.RelativeTo( glm::dvec3( 0.0, m_waterLevel, 0.0 ) ) );
+			command.worldIT = glm::mat4( 1.0f );
+			submitOpaque( m_programWaterID, m_programWaterDepthID, m_renderQueue.Store( command ), 0.0f );
+		}
 
-	// - VAO
-	glBindVertexArray( m_SkyboxGPU.vaoID );
+		// - Skybox: a saját menetében a többi után, így csak a le nem takart pixelekre fut
+		{
+			DrawCommand command;
+			command.vaoID = m_SkyboxGPU.vaoID;
+			command.count = m_SkyboxGPU.count;
+			command.textureID = SkyboxTexture();
+			command.samplerID = m_SamplerID;
+			command.world = glm::mat4( 1.0f ); // a kamera az origóban
+			m_renderQueue.Submit( RENDER_PASS_SKY, m_programSkyboxID, m_renderQueue.Store( command ), 0.0f );
+		}
 
-	// - Program
-	glUseProgram( m_programSkyboxID );
+		// - Tengelyek: Suzanne-on és a második kontrollponton, mélységi teszt nélkül
+		for ( const glm::mat4& axesWorld : { matWorld, glm::translate( m_camera.RelativeTo( glm::dvec3( pos2 ) ) ) } )
+		{
+			DrawCommand command;
+			command.vaoID = m_AxesVAO;
+			command.mode = GL_LINES;
+			command.count = 6;
+			command.indexed = false;
+			command.world = axesWorld;
+			m_renderQueue.Submit( RENDER_PASS_OVERLAY, m_programAxis, m_renderQueue.Store( command ), 0.0f );
+		}
 
-	glProgramUniform1i(m_programSkyboxID,ul(m_programSkyboxID,"skyboxTexture"),0); //Programnak nem kell aktívnak lennie
-    glBindTextureUnit(0,m_SkyboxTextureID);
-	glBindSampler(0,m_SamplerID);
+		m_renderQueue.Sort();
+		m_prepassQueue.Sort();
 
-	// - Rajzolas
-	glDrawElements( GL_TRIANGLES, m_SkyboxGPU.count, GL_UNSIGNED_INT, nullptr );
+		// - Árnyékvetők: a színtér objektumai akkor is, ha a kamera nem látja őket, és az animált objektumok
+		m_shadowQueue.Clear();
+		if ( shadows )
+		{
+			for ( int object = 0; object < SCENE_OBJECT_COUNT; ++object )
+			{
+				DrawCommand command;
+				command.vaoID = sceneObjects[ object ]->vaoID;
+				command.depthVaoID = sceneObjects[ object ]->depthVaoID;
+				command.count = sceneObjects[ object ]->count;
+				command.world = m_transforms.RelativeWorld( m_objectTransform[ object ], origin );
+				m_shadowQueue.Submit( RENDER_PASS_OPAQUE, m_programDepthID, m_shadowQueue.Store( command ), 0.0f );
+			}
+			// a tömegből az összes, nem csak a kamera által látottak: a képen kívüliek is vethetnek árnyékot a képbe
+			for ( const DrawCommand& command : m_crowd.CasterCommands() )
+				m_shadowQueue.Submit( RENDER_PASS_OPAQUE, m_programDepthID, crowdCommand( m_shadowQueue, command ), 0.0f );
+
+			m_shadowInstanceBatcher.Clear();
+			m_shadowInstanceBatcher.Add( m_crowd.Mesh(), m_crowd.CasterInstances().data(), m_crowd.CasterInstances().size(), crowdOffset );
+			for ( TransformHandle follower = 0; follower < m_followerTransforms.Size(); ++follower )
+				m_shadowInstanceBatcher.Add( followerMesh, { m_followerTransforms.RelativeWorld( follower, origin ), m_followerTransforms.NormalMatrix( follower ) } );
+			m_shadowInstanceBatcher.Upload();
+			for ( const DrawCommand& command : m_shadowInstanceBatcher.Commands() )
+				m_shadowQueue.Submit( RENDER_PASS_OPAQUE, m_programDepthInstancedID, command, 0.0f );
+			m_shadowQueue.Sort();
+		}
+	}
 
-	glDepthFunc(prevDepthFnc);
-	// shader kikapcsolasa
-	glUseProgram( 0 );
+	//
+	// Árnyéktérképek: kaszkádonként egy mélységi menet a fény felől
+	//
+	if ( shadows )
+	{
+		ProfileZone zone( m_profiler, "Shadows" );
+
+		static constexpr const char* CASCADE_ZONES[ CascadedShadowMap::MAX_CASCADES ] = { "ShadowCascade0", "ShadowCascade1", "ShadowCascade2", "ShadowCascade3" };
+
+		m_glState.SetDepthTest( true );
+		m_glState.SetDepthFunc( GL_LESS );
+		m_glState.SetDepthMask( true );
+		// a felület egyoldalú, mindkét oldala vessen árnyékot
+		m_glState.SetCullFace( false );
+		m_glState.SetPolygonMode( GL_FILL );
+		glEnable( GL_POLYGON_OFFSET_FILL );
+		glPolygonOffset( 2.0f, 4.0f );
+
+		// a kép célja a saját framebuffer is lehet (headless mód), a végén oda tér vissza
+		m_shadowMap.Begin( m_targetFramebufferID, glm::ivec4( 0, 0, m_windowWidth, m_windowHeight ) );
+		m_shadowInstanceBatcher.Bind();
+		for ( int cascade = 0; cascade < m_shadowMap.CascadeCount(); ++cascade )
+		{
+			ProfileZone cascadeZone( m_profiler, CASCADE_ZONES[ cascade ] );
 
-	// - Textúrák kikapcsolása, minden egységre külön
-	glBindTextureUnit( 0, 0 );
-	glBindSampler( 0, 0 );
+			m_shadowMap.BeginCascade( cascade );
+			for ( GLuint program : { m_programDepthID, m_programDepthInstancedID } )
+				glProgramUniformMatrix4fv( program, ul( program, "viewProj" ), 1, GL_FALSE, glm::value_ptr( m_shadowMap.CascadeViewProj( cascade ) ) );
+			m_shadowQueue.ExecuteDepthOnly( m_glState );
+		}
 
-	// VAO kikapcsolása
-	glBindVertexArray( 0 );
+		glDisable( GL_POLYGON_OFFSET_FILL );
+		m_shadowMap.End();
+		m_instanceBatcher.Bind();
+	}
+	m_glState.BindTextureUnit( SHADOW_TEXTURE_UNIT, m_shadowMap.TextureID() );
+	m_glState.BindSampler( SHADOW_TEXTURE_UNIT, 0 );
 
+	//
+	// Pályák: a pontok egy tároló pufferben, az összes pálya egy rajzolási paranccsal
+	//
+	if ( ( m_showPath || m_testPathCount > 0 ) && !m_overdrawView )
+	{
+		ProfileZone zone( m_profiler, "Trajectories" );
 
-	glm::mat4 matWorld2 = glm::translate(pos1);
+		if ( m_trajectoryBufferDirty )
+		{
+			RebuildTrajectoryBuffer();
+		}
+		else if ( m_pathDirtySegments.count > 0 )
+		{
+			if ( m_showPath ) m_trajectoryBuffer.UpdatePath( 0, m_trajectory, m_pathDirtySegments );
+			m_pathDirtySegments = {};
+		}
 
-	glDisable(GL_DEPTH_TEST);
+		glProgramUniformMatrix4fv( m_programTrajectory, ul( m_programTrajectory, "viewProj" ), 1, GL_FALSE, glm::value_ptr( viewProj ) );
+		// a pálya pontjai világ koordinátákban vannak a pufferben
+		glProgramUniformMatrix4fv( m_programTrajectory, ul( m_programTrajectory, "world" ), 1, GL_FALSE, glm::value_ptr( glm::translate( m_camera.RelativeTo( glm::dvec3( 0.0 ) ) ) ) );
+		glProgramUniform1f( m_programTrajectory, ul( m_programTrajectory, "mult" ), 1.0f );
 
-	glProgramUniform1f(m_programAxis, ul(m_programAxis, "mult"), 0.5f);
+		// a szalag mindkét oldala látszik; a később rajzolt objektumok a mélységi teszt miatt így is takarják
+		m_glState.SetDepthTest( true );
+		m_glState.SetDepthFunc( GL_LESS );
+		m_glState.SetDepthMask( true );
+		m_glState.SetCullFace( false );
+		m_glState.SetPolygonMode( m_polygonMode );
 
-	glProgramUniformMatrix4fv(m_programAxis, ul(m_programAxis, "viewProj"), 1, GL_FALSE, glm::value_ptr(m_camera.GetViewProj()));
-	glProgramUniformMatrix4fv(m_programAxis, ul(m_programAxis, "world"), 1, GL_FALSE, glm::value_ptr(matWorld));
+		m_trajectoryBuffer.Draw( m_glState, m_programTrajectory, m_pathRibbon ? m_pathRibbonWidth : 0.0f,
+								 glm::vec2( m_windowWidth, m_windowHeight ) );
+	}
 
-	glUseProgram(m_programAxis);
+	//
+	// Mélységi előmenet: csak a mélység íródik, így a drága színezés pixelenként egyszer fut
+	//
+	const bool prepass = m_prepassSelector.BeginFrame( static_cast<DepthPrepassMode>( m_depthPrepassMode ),
+													   static_cast<std::uint64_t>( m_windowWidth ) * static_cast<std::uint64_t>( m_windowHeight ) );
+	if ( prepass )
+	{
+		ProfileZone zone( m_profiler, "DepthPrepass" );
 
-	glDrawArrays(GL_LINES, 0, 6);
+		// az árnyék menetek a saját mátrixukat hagyták a programokon
+		for ( GLuint program : { m_programDepthID, m_programDepthInstancedID, m_programWaterDepthID } )
+			glProgramUniformMatrix4fv( program, ul( program, "viewProj" ), 1, GL_FALSE, glm::value_ptr( viewProj ) );
 
-	glEnable(GL_DEPTH_TEST);
+		m_glState.SetDepthTest( true );
+		m_glState.SetDepthFunc( GL_LESS );
+		m_glState.SetDepthMask( true );
+		m_glState.SetCullFace( true );
+		m_glState.SetBlend( false );
+		m_glState.SetPolygonMode( GL_FILL );
+		glColorMask( GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE );
 
-	matWorld2 = glm::translate(pos2);
+		m_prepassQueue.ExecuteDepthOnly( m_glState );
+
+		glColorMask( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE );
+		m_prepassSelector.EndPrepass();
+	}
 
-	glDisable(GL_DEPTH_TEST);
+	{
+		ProfileZone zone( m_profiler, "Draw" );
 
-	glProgramUniform1f(m_programAxis, ul(m_programAxis, "mult"), 0.5f);
+		// menetenkénti állapot; a skyboxnál kisebb-egyenlőt használjunk, mert mindent kitolunk a távoli vágósíkokra
+		std::array<RenderPassState, RENDER_PASS_COUNT> passStates;
+		passStates[ RENDER_PASS_SKY ].depthFunc = GL_LEQUAL;
+		passStates[ RENDER_PASS_OVERLAY ].depthTest = false;
 
-	glProgramUniformMatrix4fv(m_programAxis, ul(m_programAxis, "viewProj"), 1, GL_FALSE, glm::value_ptr(m_camera.GetViewProj()));
-	glProgramUniformMatrix4fv(m_programAxis, ul(m_programAxis, "world"), 1, GL_FALSE, glm::value_ptr(matWorld2));
+		// előmenet után már csak a látható felületek egyeznek a mélységgel, írni nem kell
+		if ( prepass )
+		{
+			// a drótváz vonalainak mélysége nem bitre egyezik a kitöltött háromszögekével
+			passStates[ RENDER_PASS_OPAQUE ].depthFunc = m_polygonMode == GL_FILL ? GL_EQUAL : GL_LEQUAL;
+			passStates[ RENDER_PASS_OPAQUE ].depthWrite = false;
+		}
 
-	glUseProgram(m_programAxis);
+		if ( m_overdrawView )
+		{
+			passStates[ RENDER_PASS_OPAQUE ].additiveBlend = true;
+			passStates[ RENDER_PASS_SKY ].enabled = false;
+			passStates[ RENDER_PASS_OVERLAY ].enabled = false;
+		}
+
+		// az átlátszatlan menet külön, a mérés (idő, árnyalt fragmentek) csak erre vonatkozik
+		std::array<RenderPassState, RENDER_PASS_COUNT> opaqueStates = passStates;
+		opaqueStates[ RENDER_PASS_SKY ].enabled = false;
+		opaqueStates[ RENDER_PASS_OVERLAY ].enabled = false;
+		passStates[ RENDER_PASS_OPAQUE ].enabled = false;
+
+		m_glState.SetPolygonMode( m_polygonMode );
+
+		m_prepassSelector.BeginShading();
+		m_renderQueue.Execute( m_glState, opaqueStates );
+		m_prepassSelector.EndShading();
+
+		m_renderQueue.Execute( m_glState, passStates );
+
+		m_glState.SetDepthTest( true );
+		m_glState.SetBlend( false );
+	}
 
-	glDrawArrays(GL_LINES, 0, 6);
+	m_profiler.SetCounter( "Depth prepass", prepass ? 1.0 : 0.0 );
+	m_profiler.SetCounter( "Overdraw", m_prepassSelector.Overdraw() );
 
-	glEnable(GL_DEPTH_TEST);
+	m_profiler.SetCounter( "Draw calls", static_cast<double>( m_renderQueue.Size() ) );
+	m_profiler.SetCounter( "GL state calls", m_glState.IssuedCalls() );
+	m_profiler.SetCounter( "GL state calls filtered", m_glState.FilteredCalls() );
 }
 
 void CMyApp::RenderGUI()
@@ -479,9 +997,11 @@ void CMyApp::RenderGUI()
 			m_Ks = glm::vec3( Ksf );
 		}
 
+		// irány fényforrás; különben a fény a kamerában van
+		ImGui::Checkbox( "Directional light", &m_directionalLight );
 		{
 			static glm::vec2 lightPosXZ = glm::vec2( 0.0f );
-			lightPosXZ = glm::vec2( m_lightPos.x, m_lightPos.z );
+			lightPosXZ = glm::vec2( m_lightDirection.x, m_lightDirection.z );
 			if ( ImGui::SliderFloat2( "Light Position XZ", glm::value_ptr( lightPosXZ ), -1.0f, 1.0f ) )
 			{
 				float lightPosL2 = lightPosXZ.x * lightPosXZ.x + lightPosXZ.y * lightPosXZ.y;
@@ -491,12 +1011,34 @@ void CMyApp::RenderGUI()
 					lightPosL2 = 1.0f;
 				}
 
-				m_lightPos.x = lightPosXZ.x;
-				m_lightPos.z = lightPosXZ.y;
-				m_lightPos.y = sqrtf( 1.0f - lightPosL2 );
+				m_lightDirection.x = lightPosXZ.x;
+				m_lightDirection.z = lightPosXZ.y;
+				m_lightDirection.y = sqrtf( 1.0f - lightPosL2 );
 			}
-			ImGui::LabelText( "Light Position Y", "%f", m_lightPos.y );
+			ImGui::LabelText( "Light Position Y", "%f", m_lightDirection.y );
 		}
+
+		ImGui::Checkbox( "Shadows", &m_shadows );
+		ImGui::SliderInt( "Cascades", &m_shadowCascadeCount, 1, CascadedShadowMap::MAX_CASCADES );
+		static const int SHADOW_RESOLUTIONS[] = { 512, 1024, 2048, 4096 };
+		static const char* SHADOW_RESOLUTION_NAMES[] = { "512", "1024", "2048", "4096" };
+		int resolutionIndex = static_cast<int>( std::find( std::begin( SHADOW_RESOLUTIONS ), std::end( SHADOW_RESOLUTIONS ), m_shadowResolution ) - std::begin( SHADOW_RESOLUTIONS ) );
+		if ( ImGui::Combo( "Shadow map size", &resolutionIndex, SHADOW_RESOLUTION_NAMES, IM_ARRAYSIZE( SHADOW_RESOLUTION_NAMES ) ) )
+		{
+			m_shadowResolution = SHADOW_RESOLUTIONS[ resolutionIndex ];
+			m_shadowMap.Init( m_shadowResolution );
+		}
+		ImGui::SliderInt( "PCF radius", &m_shadowPCFRadius, 0, 3 );
+		ImGui::SliderFloat( "Shadow distance", &m_shadowDistance, 5.0f, 500.0f, "%.0f", ImGuiSliderFlags_Logarithmic );
+		ImGui::SliderFloat( "Split lambda", &m_shadowSplitLambda, 0.0f, 1.0f );
+		ImGui::Checkbox( "Show cascades", &m_shadowShowCascades );
+
+		ImGui::Separator();
+		ImGui::Text( "Point lights" );
+		ImGui::SliderInt( "Count", &m_pointLightCount, 0, MAX_POINT_LIGHT_COUNT, "%d", ImGuiSliderFlags_Logarithmic );
+		ImGui::SliderFloat( "Radius", &m_pointLightRadius, 0.5f, 10.0f );
+		ImGui::SliderFloat( "Cluster far", &m_clusterFar, 10.0f, 1000.0f, "%.0f", ImGuiSliderFlags_Logarithmic );
+		ImGui::Text( "Light indices: %d, max per cluster: %u", static_cast<int>( m_lightClusters.IndexCount() ), m_lightClusters.MaxLightsPerCluster() );
 	}
 	ImGui::End();
 
@@ -504,11 +1046,191 @@ void CMyApp::RenderGUI()
 	if (ImGui::Begin("Params"))
 	{
 		ImGui::SliderFloat("m_currentParam",&m_currentParam,0.f,1.f);
-		ImGui::DragFloat3("pos1",&m_controlPoints[0].x,0.1f);
-		ImGui::DragFloat3("pos2",&m_controlPoints[1].x,0.1f);
+
+		// a pálya táblázata csak szerkesztéskor épül újra: a pont mozgatásakor csak az érintett szakaszok,
+		// a pontok számának vagy a görbe típusának változásakor az egész
+		bool pathChanged = false;
+		bool pathMoved = false;
+		static const char* splineNames[] = { "Linear", "Catmull-Rom", "B-spline" };
+		pathChanged |= ImGui::Combo("Spline", &m_splineType, splineNames, IM_ARRAYSIZE( splineNames ) );
+
+		// hosszú pályánál is csak a látható sorok
+		ImGui::BeginChild("ControlPoints", ImVec2( 0.0f, 8.0f * ImGui::GetFrameHeightWithSpacing() ), true );
+		ImGuiListClipper clipper;
+		clipper.Begin( static_cast<int>( m_controlPoints.size() ) );
+		while ( clipper.Step() )
+		{
+			for ( int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i )
+			{
+				ImGui::PushID( i );
+				if ( ImGui::DragFloat3("pos",&m_controlPoints[i].x,0.1f) )
+				{
+					m_trajectory.MoveControlPoint( i, m_controlPoints[i] );
+					pathMoved = true;
+				}
+				ImGui::PopID();
+			}
+		}
+		ImGui::EndChild();
+
+		if ( ImGui::Button("Add point") )
+		{
+			// az utolsó szakasz irányában folytatjuk
+			const glm::vec3 last = m_controlPoints.back();
+			m_controlPoints.push_back( last + ( last - m_controlPoints[ m_controlPoints.size() - 2 ] ) );
+			pathChanged = true;
+		}
+		ImGui::SameLine();
+		if ( m_controlPoints.size() > 2 && ImGui::Button("Remove point") )
+		{
+			m_controlPoints.pop_back();
+			pathChanged = true;
+		}
+		ImGui::SameLine();
+		if ( ImGui::Button("Long path") )
+		{
+			// sok pontos teszt pálya a szerkesztés sebességéhez
+			m_controlPoints.resize( LONG_PATH_POINT_COUNT );
+			for ( int i = 0; i < LONG_PATH_POINT_COUNT; ++i )
+			{
+				const float angle = 0.05f * static_cast<float>( i );
+				m_controlPoints[i] = glm::vec3( ( 4.0f + 0.001f * i ) * std::cos( angle ), 0.5f * std::sin( 0.37f * angle ), ( 4.0f + 0.001f * i ) * std::sin( angle ) );
+			}
+			pathChanged = true;
+		}
+
+		if ( pathChanged )
+			RebuildTrajectory();
+		else if ( pathMoved )
+			UpdateTrajectory();
+		ImGui::Text("Length: %.3f", m_trajectory.Length() );
+		ImGui::SliderInt("Followers", &m_followerCount, 0, 10000, "%d", ImGuiSliderFlags_Logarithmic );
+
+		m_trajectoryBufferDirty |= ImGui::Checkbox("Show path", &m_showPath );
+		ImGui::Checkbox("Ribbon", &m_pathRibbon );
+		ImGui::SameLine();
+		ImGui::SliderFloat("Width (px)", &m_pathRibbonWidth, 1.0f, 32.0f );
+		// az újraépítés drága, csak a csúszka elengedésekor
+		ImGui::SliderInt("Test paths", &m_testPathCount, 0, 256 );
+		m_trajectoryBufferDirty |= ImGui::IsItemDeactivatedAfterEdit();
+		ImGui::SliderInt("Points / test path", &m_testPathPoints, 2, 1000000, "%d", ImGuiSliderFlags_Logarithmic );
+		m_trajectoryBufferDirty |= ImGui::IsItemDeactivatedAfterEdit();
+		ImGui::Text("Path points: %d in %d paths (max %zu)", static_cast<int>( m_trajectoryBuffer.PointCount() ), static_cast<int>( m_trajectoryBuffer.PathCount() ),
+					m_trajectoryBuffer.MaxPointCount() );
+		ImGui::Checkbox("Animate", &m_animatePath);
+		ImGui::SliderFloat("Speed", &m_pathSpeed, 0.0f, 2.0f);
+
+		ImGui::Checkbox("Frustum culling", &m_frustumCulling);
+		const int visibleCount = static_cast<int>( std::count( m_visibility.begin(), m_visibility.end(), 1 ) );
+		ImGui::Text("Visible objects: %d / %d", visibleCount, static_cast<int>( m_visibility.size() ) );
+
+		static const char* objectNames[ SCENE_OBJECT_COUNT ] = { "Surface", "Suzanne" };
+		if ( m_pickedObject != -1 )
+			ImGui::Text("Picked: %s, triangle %u at (%.2f, %.2f, %.2f) in %.3f ms", objectNames[ m_pickedObject ], m_pickHit.triangle,
+						m_pickPoint.x, m_pickPoint.y, m_pickPoint.z, m_pickTimeMs );
+		else
+			ImGui::Text("Picked: -");
 
 		ImGui::End();
 	}
+
+	if ( ImGui::Begin( "Crowd" ) )
+	{
+		ImGui::SliderInt( "Count", &m_crowdSize, 0, 1000000, "%d", ImGuiSliderFlags_Logarithmic );
+		ImGui::Checkbox( "Multithreaded", &m_multithreaded );
+		ImGui::Checkbox( "Instancing", &m_instancing );
+		ImGui::Text( "Workers: %u", m_jobs.WorkerCount() );
+		ImGui::Text( "Visible: %d / %d", static_cast<int>( m_crowd.VisibleCount() ), static_cast<int>( m_crowd.AgentCount() ) );
+		ImGui::Text( "Build time: %.3f ms", m_crowd.BuildTimeMs() );
+	}
+	ImGui::End();
+
+	if ( ImGui::Begin( "Sky" ) )
+	{
+		static const char* SKY_SOURCES[] = { "Cubemap textures", "Gradient", "Preetham" };
+		ImGui::Combo( "Source", &m_skySource, SKY_SOURCES, IM_ARRAYSIZE( SKY_SOURCES ) );
+		if ( m_skySource == SKY_GRADIENT )
+		{
+			ImGui::ColorEdit3( "Ground", glm::value_ptr( m_skyParameters.groundColor ) );
+			ImGui::ColorEdit3( "Sky", glm::value_ptr( m_skyParameters.skyColor ) );
+		}
+		else if ( m_skySource == SKY_PREETHAM )
+		{
+			ImGui::SliderFloat( "Turbidity", &m_skyParameters.turbidity, 2.0f, 10.0f );
+			ImGui::SliderFloat( "Exposure", &m_skyParameters.exposure, 0.05f, 4.0f, "%.2f", ImGuiSliderFlags_Logarithmic );
+			ImGui::ColorEdit3( "Ground", glm::value_ptr( m_skyParameters.groundColor ) );
+			ImGui::TextUnformatted( "The sun follows the light direction" );
+		}
+
+		static const int SKY_FACE_SIZES[] = { 16, 32, 64, 128, 256 };
+		static const char* SKY_FACE_SIZE_NAMES[] = { "16", "32", "64", "128", "256" };
+		int faceSizeIndex = static_cast<int>( std::find( std::begin( SKY_FACE_SIZES ), std::end( SKY_FACE_SIZES ), m_skyFaceSize ) - std::begin( SKY_FACE_SIZES ) );
+		if ( m_skySource != SKY_TEXTURES && ImGui::Combo( "Face size", &faceSizeIndex, SKY_FACE_SIZE_NAMES, IM_ARRAYSIZE( SKY_FACE_SIZE_NAMES ) ) )
+		{
+			m_skyFaceSize = SKY_FACE_SIZES[ faceSizeIndex ];
+			m_proceduralSky.Init( m_skyFaceSize );
+		}
+	}
+	ImGui::End();
+
+	if ( ImGui::Begin( "Water" ) )
+	{
+		ImGui::Checkbox( "Show", &m_showWater );
+		ImGui::SliderFloat( "Level", &m_waterLevel, -10.0f, 2.0f );
+		ImGui::SliderFloat( "Grid size", &m_water.gridSize, 16.0f, 1024.0f, "%.0f m", ImGuiSliderFlags_Logarithmic );
+		ImGui::SliderFloat( "Choppiness", &m_water.choppiness, 0.0f, 2.0f );
+		ImGui::Separator();
+		// a spektrum paramétereinek változása újraépíti a kezdeti spektrumot (SetParameters)
+		ImGui::SliderFloat( "Patch size", &m_oceanParameters.patchSize, 8.0f, 512.0f, "%.0f m", ImGuiSliderFlags_Logarithmic );
+		ImGui::SliderFloat( "Wind speed", &m_oceanParameters.windSpeed, 1.0f, 40.0f, "%.1f m/s" );
+		ImGui::SliderFloat2( "Wind direction", glm::value_ptr( m_oceanParameters.windDirection ), -1.0f, 1.0f );
+		ImGui::SliderFloat( "Amplitude", &m_oceanParameters.phillipsConstant, 1.0e-5f, 1.0e-2f, "%.5f", ImGuiSliderFlags_Logarithmic );
+		ImGui::Text( "FFT %dx%d: %.3f ms", WATER_FFT_SIZE, WATER_FFT_SIZE, m_water.SimulationMs() );
+	}
+	ImGui::End();
+
+	if ( ImGui::Begin( "Depth prepass" ) )
+	{
+		static const char* PREPASS_MODES[] = { "Off", "On", "Auto" };
+		ImGui::Combo( "Mode", &m_depthPrepassMode, PREPASS_MODES, IM_ARRAYSIZE( PREPASS_MODES ) );
+		ImGui::Checkbox( "Overdraw view", &m_overdrawView );
+		ImGui::Text( "Shaded fragments / pixel: %.2f", m_prepassSelector.Overdraw() );
+		ImGui::Text( "Opaque GPU time without prepass: %.3f ms", m_prepassSelector.CostMs( false ) );
+		ImGui::Text( "Opaque GPU time with prepass: %.3f ms (prepass %.3f ms)", m_prepassSelector.CostMs( true ), m_prepassSelector.PrepassMs() );
+	}
+	ImGui::End();
+
+	if ( ImGui::Begin( "Timing" ) )
+	{
+		ImGui::Text( "Elapsed: %.3f s, dt: %.3f ms", m_clock.GetElapsedTime(), m_clock.GetDeltaTime() * 1000.0 );
+
+		bool fixedStep = m_clock.IsFixedTimeStep();
+		static int simulationRate = 60;
+		if ( ImGui::Checkbox( "Fixed time step", &fixedStep ) )
+		{
+			m_clock.SetFixedTimeStep( fixedStep ? 1.0 / simulationRate : 0.0 );
+		}
+		if ( fixedStep && ImGui::SliderInt( "Simulation Hz", &simulationRate, 10, 240 ) )
+		{
+			m_clock.SetFixedTimeStep( 1.0 / simulationRate );
+		}
+
+		bool vsync = SDL_GL_GetSwapInterval() != 0;
+		if ( ImGui::Checkbox( "VSync", &vsync ) )
+		{
+			SDL_GL_SetSwapInterval( vsync ? 1 : 0 );
+		}
+
+		// csak vsync nélkül van szerepe
+		static int frameRateCap = 0;
+		if ( !vsync && ImGui::SliderInt( "FPS cap (0 = off)", &frameRateCap, 0, 240 ) )
+		{
+			m_framePacer.SetTargetFrameRate( frameRateCap );
+		}
+	}
+	ImGui::End();
+
+	m_profiler.RenderGUI();
 }
 
 // https://wiki.libsdl.org/SDL2/SDL_KeyboardEvent
@@ -522,17 +1244,14 @@ void CMyApp::KeyboardDown(const SDL_KeyboardEvent& key)
 	{
 		if ( key.keysym.sym == SDLK_F5 && key.keysym.mod & KMOD_CTRL )
 		{
-			CleanShaders();
-			InitShaders();
+			// a háttérben fordul újra, a régi programok a csere pillanatáig használhatók maradnak
+			m_shaderReloader.ReloadAll();
 		}
 		if ( key.keysym.sym == SDLK_F1 )
 		{
-			GLint polygonModeFrontAndBack[ 2 ] = {};
-			// https://registry.khronos.org/OpenGL-Refpages/gl4/html/glGet.xhtml
-			glGetIntegerv( GL_POLYGON_MODE, polygonModeFrontAndBack ); // Kérdezzük le a jelenlegi polygon módot! Külön adja a front és back módokat.
-			GLenum polygonMode = ( polygonModeFrontAndBack[ 0 ] != GL_FILL ? GL_FILL : GL_LINE ); // Váltogassuk FILL és LINE között!
+			// Váltogassuk FILL és LINE között! A Render a színes menetekre az állapot gyorsítótáron át állítja be
 			// https://registry.khronos.org/OpenGL-Refpages/gl4/html/glPolygonMode.xhtml
-			glPolygonMode( GL_FRONT_AND_BACK, polygonMode ); // Állítsuk be az újat!
+			m_polygonMode = ( m_polygonMode != GL_FILL ? GL_FILL : GL_LINE );
 		}
 	}
 	m_cameraManipulator.KeyboardDown( key );
@@ -554,10 +1273,20 @@ void CMyApp::MouseMove(const SDL_MouseMotionEvent& mouse)
 
 void CMyApp::MouseDown(const SDL_MouseButtonEvent& mouse)
 {
+	if ( mouse.button == SDL_BUTTON_LEFT )
+	{
+		m_mouseDownX = mouse.x;
+		m_mouseDownY = mouse.y;
+	}
 }
 
 void CMyApp::MouseUp(const SDL_MouseButtonEvent& mouse)
 {
+	// kattintás (nem kameraforgatás): alig mozdult az egér a lenyomás óta
+	if ( mouse.button == SDL_BUTTON_LEFT && std::abs( mouse.x - m_mouseDownX ) <= 3 && std::abs( mouse.y - m_mouseDownY ) <= 3 )
+	{
+		Pick( mouse.x, mouse.y );
+	}
 }
 
 // https://wiki.libsdl.org/SDL2/SDL_MouseWheelEvent
@@ -573,6 +1302,16 @@ void CMyApp::Resize(int _w, int _h)
 {
 	glViewport(0, 0, _w, _h);
 	m_camera.SetAspect( static_cast<float>(_w) / _h );
+
+	m_windowWidth  = _w;
+	m_windowHeight = _h;
+}
+
+void CMyApp::SetCameraView( const glm::vec3& eye, const glm::vec3& at, const glm::vec3& up )
+{
+	m_camera.SetView( glm::dvec3( eye ), glm::dvec3( at ), up );
+	// a manipulátor a saját gömbi koordinátáiból számolja a nézetet, ezeket is frissíteni kell
+	m_cameraManipulator.SetCamera( &m_camera );
 }
 
 // Le nem kezelt, egzotikus esemény kezelése
@@ -584,38 +1323,79 @@ void CMyApp::OtherEvent( const SDL_Event& ev )
 }
 
 
-// Pozíció kiszámítása a kontrollpontok alapján
-glm::vec3 CMyApp::EvaluatePathPosition() const
+void CMyApp::RebuildTrajectory()
 {
-	if (m_controlPoints.size() == 0) // Ha nincs pont, akkor visszaadjuk az origót
-		return glm::vec3(0);
-
-	const int interval = (const int)m_currentParam; // Melyik két pont között vagyunk?
-
-	if (interval < 0) // Ha a paraméter negatív, akkor a kezdőpontot adjuk vissza
-		return m_controlPoints[0];
+	m_trajectory.SetControlPoints( m_controlPoints, static_cast<SplineType>( m_splineType ) );
+	m_trajectoryBufferDirty = true;
+	m_pathDirtySegments = {};
+}
 
-	if (interval >= m_controlPoints.size() - 1) // Ha a paraméter nagyobb, mint a pontok száma, akkor az utolsó pontot adjuk vissza
-		return m_controlPoints[m_controlPoints.size() - 1];
+void CMyApp::UpdateTrajectory()
+{
+	const TrajectorySegmentRange range = m_trajectory.Update();
+	if ( range.count == 0 ) return;
 
-	float localT = m_currentParam - interval; // A paramétert normalizáljuk az aktuális intervallumra
-	
-	return glm::mix( m_controlPoints[interval], m_controlPoints[interval + 1], localT ); // Lineárisan interpolálunk a két kontrollpont között
+	// a GPU-ra a következő Render tölti fel, az addig összegyűlt szakaszokat egyben
+	if ( m_pathDirtySegments.count == 0 )
+	{
+		m_pathDirtySegments = range;
+	}
+	else
+	{
+		const std::size_t first = std::min( m_pathDirtySegments.first, range.first );
+		const std::size_t end = std::max( m_pathDirtySegments.first + m_pathDirtySegments.count, range.first + range.count );
+		m_pathDirtySegments = { first, end - first };
+	}
 }
 
-// Tangens kiszámítása a kontrollpontok alapján
-glm::vec3 CMyApp::EvaluatePathTangent() const
+void CMyApp::RebuildTrajectoryBuffer()
 {
-	if (m_controlPoints.size() < 2) // Ha nincs elég pont az interpolációhoy, akkor visszaadjuk az x tengelyt
-		return glm::vec3(1.0,0.0,0.0);
+	m_trajectoryBuffer.Clear();
 
-	int interval = (int)m_currentParam; // Melyik két pont között vagyunk?
+	// a szerkesztett pálya mindig az első, így a változott szakaszai a puffer elejére esnek
+	if ( m_showPath )
+		m_trajectoryBuffer.AddPath( m_trajectory, glm::vec3( 1.0f, 0.0f, 1.0f ) );
 
-	if (interval < 0) // Ha a paraméter negatív, akkor a kezdő intervallumot adjuk vissza
-		interval = 0;
+	// terheléses teszt: sok hosszú, egymásba nem kötött spirál; a pontok együtt egy tároló blokkba kell férjenek,
+	// így a pályánkénti pontszámot a maradék helyhez igazítjuk
+	std::size_t testPathPoints = static_cast<std::size_t>( m_testPathPoints );
+	if ( m_testPathCount > 0 )
+	{
+		const std::size_t freePoints = m_trajectoryBuffer.MaxPointCount() - std::min( m_trajectoryBuffer.PointCount(), m_trajectoryBuffer.MaxPointCount() );
+		testPathPoints = std::min( testPathPoints, freePoints / static_cast<std::size_t>( m_testPathCount ) );
+	}
+	std::vector<glm::vec3> points( testPathPoints );
+	for ( int path = 0; path < m_testPathCount; ++path )
+	{
+		const float radius = 6.0f + 0.25f * static_cast<float>( path );
+		for ( std::size_t i = 0; i < points.size(); ++i )
+		{
+			const float t = static_cast<float>( i ) / static_cast<float>( points.size() );
+			const float angle = glm::two_pi<float>() * 8.0f * t + 0.7f * static_cast<float>( path );
+			points[ i ] = glm::vec3( radius * std::cos( angle ), 4.0f * t - 2.0f, radius * std::sin( angle ) );
+		}
+		m_trajectoryBuffer.AddPoints( points.data(), points.size(), glm::vec3( 0.5f + 0.5f * std::sin( static_cast<float>( path ) ), 0.8f, 0.3f ) );
+	}
 
-	if (interval >= m_controlPoints.size() - 1) // Ha a paraméter nagyobb, mint az intervallumok száma, akkor az utolsót adjuk vissza
-		interval = static_cast<int>( m_controlPoints.size() - 2 );
+	m_trajectoryBuffer.Upload();
+	m_trajectoryBufferDirty = false;
+	m_pathDirtySegments = {};
+}
 
-	return glm::normalize(m_controlPoints[interval + 1] - m_controlPoints[interval]);
+// Pozíció a pályán: a paraméter [0,1]-ben a megtett ív hossza arányában, így a mozgás egyenletes sebességű
+glm::vec3 CMyApp::EvaluatePathPosition( float param ) const
+{
+	return m_trajectory.PositionAtDistance( param * m_trajectory.Length() );
+}
+
+// Forgatás-minimalizáló keret a pályán: érintő, normális, binormális
+glm::mat3 CMyApp::EvaluatePathFrame( float param ) const
+{
+	return m_trajectory.FrameAtDistance( param * m_trajectory.Length() );
+}
+
+// Az objektum a pálya érintője (z) felé néz, a keret normálisa a felfelé irány (y)
+glm::mat3 CMyApp::PathOrientation( const glm::mat3& frame )
+{
+	return glm::mat3( -frame[ 2 ], frame[ 1 ], frame[ 0 ] );
 }
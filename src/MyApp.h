@@ -20,11 +20,29 @@
 #include "GLUtils.hpp"
 #include "Camera.h"
 #include "CameraManipulator.h"
+#include "ShaderReloader.h"
+#include "FrameProfiler.h"
+#include "SimulationClock.h"
+#include "Frustum.h"
+#include "BVH.h"
+#include "JobSystem.h"
+#include "Crowd.h"
+#include "GLStateCache.h"
+#include "RenderQueue.h"
+#include "InstanceBatcher.h"
+#include "TransformSystem.h"
+#include "Trajectory.h"
+#include "TrajectoryBuffer.h"
+#include "LightClusters.h"
+#include "ShadowCascades.h"
+#include "DepthPrepass.h"
+#include "ProceduralSky.h"
+#include "Water.h"
 
 struct SUpdateInfo
 {
-	float ElapsedTimeInSec = 0.0f; // Program indulása óta eltelt idő
-	float DeltaTimeInSec   = 0.0f; // Előző Update óta eltelt idő
+	double ElapsedTimeInSec = 0.0; // Program indulása óta eltelt idő (double, hogy órák után is pontos legyen)
+	float  DeltaTimeInSec   = 0.0f; // Előző Update óta eltelt idő
 };
 
 class CMyApp
@@ -37,6 +55,10 @@ public:
 	void Clean();
 
 	void Update( const SUpdateInfo& );
+	// Szimuláció léptetése: fix időlépéssel akár többször is egy képkocka alatt, különben képkockánként egyszer
+	void FixedUpdate( const SUpdateInfo& );
+	// A kirajzolás hol tart az utolsó két szimulált állapot között [0,1]
+	void SetInterpolationAlpha( float alpha ) { m_interpolationAlpha = alpha; }
 	void Render();
 	void RenderGUI();
 
@@ -49,6 +71,28 @@ public:
 	void Resize(int, int);
 
 	void OtherEvent( const SDL_Event& );
+
+	// Kamera beállítása kívülről (pl. a headless benchmark kamerapályája)
+	void SetCameraView( const glm::vec3& eye, const glm::vec3& at, const glm::vec3& up );
+	const Camera& GetCamera() const { return m_camera; }
+
+	// A kép célja, ha nem az ablak framebuffere (pl. a headless benchmark saját framebuffere)
+	void SetTargetFramebuffer( GLuint framebufferID ) { m_targetFramebufferID = framebufferID; }
+
+	// A főciklus is ebbe méri az Update, ImGui és Swap zónákat
+	FrameProfiler& GetProfiler() { return m_profiler; }
+
+	// Időzítés, a főciklus használja, a GUI állítja
+	SimulationClock& GetClock() { return m_clock; }
+	FramePacer& GetFramePacer() { return m_framePacer; }
+
+	// Animált objektumok száma (pl. a skálázódás méréséhez)
+	void SetCrowdSize( int count ) { m_crowdSize = count; }
+	void SetInstancing( bool enable ) { m_instancing = enable; }
+	// További pontfényforrások száma (klaszterezett megvilágítás)
+	void SetLightCount( int count ) { m_pointLightCount = count; }
+	void SetDepthPrepassMode( DepthPrepassMode mode ) { m_depthPrepassMode = static_cast<int>( mode ); }
+	void SetShowWater( bool show ) { m_showWater = show; }
 protected:
 	void SetupDebugCallback();
 
@@ -56,16 +100,58 @@ protected:
 	// Adat változók
 	//
 
-	float m_ElapsedTimeInSec = 0.0f;
+	double m_ElapsedTimeInSec = 0.0;
+
+	// CPU/GPU időmérés
+	FrameProfiler m_profiler;
+
+	// Időzítés
+	SimulationClock m_clock;
+	FramePacer m_framePacer;
+	float m_interpolationAlpha = 1.0f;
 
 
 	// Mozgás trajektória
 	float m_currentParam = 0.0;
-	static constexpr int MAX_POINT_COUNT = 20;
+
+	// a pálya paraméterének animálása (FixedUpdate), a kirajzolás a két utolsó állapot között interpolál
+	bool  m_animatePath = false;
+	float m_pathSpeed = 0.25f; // paraméter / mp
+	float m_pathDirection = 1.0f;
+	float m_previousParam = 0.0f;
+	float RenderedPathParam() const;
 	std::vector<glm::vec3> m_controlPoints;
 
-	glm::vec3 EvaluatePathPosition() const;
-	glm::vec3 EvaluatePathTangent() const;
+	// a kontrollpontokra illesztett görbe, ívhossz táblázattal
+	Trajectory m_trajectory;
+	int m_splineType = static_cast<int>( SplineType::CATMULL_ROM );
+	void RebuildTrajectory();
+	void UpdateTrajectory(); // csak a mozgatott pontok szakaszai
+	static constexpr int LONG_PATH_POINT_COUNT = 10000;
+
+	// a pályák kirajzolása: mintavételezett pontok tároló pufferben, vonalként vagy szalagként
+	TrajectoryBuffer m_trajectoryBuffer;
+	bool m_trajectoryBufferDirty = true;
+	TrajectorySegmentRange m_pathDirtySegments; // feltöltésre váró szakaszok
+	bool m_showPath = true;
+	bool m_pathRibbon = true;
+	float m_pathRibbonWidth = 6.0f;
+	int m_testPathCount = 0;
+	int m_testPathPoints = 100000;
+	void RebuildTrajectoryBuffer();
+
+	glm::vec3 EvaluatePathPosition( float param ) const;
+	glm::mat3 EvaluatePathFrame( float param ) const;
+	static glm::mat3 PathOrientation( const glm::mat3& frame );
+
+	// a pályán egymás után haladó Suzanne-ok, példányosítva rajzolva
+	static constexpr float FOLLOWER_SCALE = 0.2f;
+	int m_followerCount = 0;
+	std::vector<float> m_followerDistances;
+	std::vector<glm::vec3> m_followerPositions;
+	std::vector<glm::mat3> m_followerFrames;
+	TransformSystem m_followerTransforms;
+	void UpdateFollowers();
 
 	// biztonsági üveg
 	static constexpr glm::vec3 GLASS_POSITION = glm::vec3( 0.0f, 0.0f, 21.0f );
@@ -94,7 +180,33 @@ protected:
 	// shaderekhez szükséges változók
 	GLuint m_programID = 0;		  // shaderek programja
 	GLuint m_programAxis = 0;
+	GLuint m_programTrajectory = 0;
 	GLuint m_programSkyboxID = 0; // skybox programja
+	GLuint m_programInstancedID = 0; // példányosított rajzolás programja
+	GLuint m_programDepthID = 0; // mélységi menetek (csak pozíció)
+	GLuint m_programDepthInstancedID = 0;
+	GLuint m_programWaterID = 0; // a víz rácsa, a magasságot a vertex shader olvassa ki
+	GLuint m_programWaterDepthID = 0;
+
+	// a programok tulajdonosa, a Shaders/ mappa változásakor a háttérben újrafordítja őket
+	ShaderReloader m_shaderReloader;
+
+	// a redundáns állapotváltások kiszűrése
+	GLStateCache m_glState;
+	GLenum m_polygonMode = GL_FILL; // F1: drótváz, csak a színes menetekre (az árnyék és az előmenet mindig kitöltött)
+
+	// a képkocka rajzolásai, rendezési kulcs szerint sorba rakva
+	RenderQueue m_renderQueue;
+
+	// mélységi előmenet: az átlátszatlan rajzolások csak pozícióval, utána a színezés GL_EQUAL teszttel;
+	// AUTO módban a mért GPU idő alapján kapcsol
+	RenderQueue m_prepassQueue;
+	DepthPrepassSelector m_prepassSelector;
+	int m_depthPrepassMode = static_cast<int>( DepthPrepassMode::AUTO );
+	bool m_overdrawView = false; // az árnyalt fragmentek száma pixelenként, szürkeárnyalatosan
+
+	// a példányok hálónként csoportosítva, egy pufferbe feltöltve
+	InstanceBatcher m_instanceBatcher;
 
 	// Fényforrás- ...
 	glm::vec4 m_lightPos = glm::vec4( 0.0f, 1.0f, 0.0f, 0.0f );
@@ -107,6 +219,30 @@ protected:
 	float m_lightLinearAttenuation      = 0.0;
 	float m_lightQuadraticAttenuation   = 0.0;
 
+	// irány fényforrás (különben a kamerában lévő pontfény), és a kaszkádolt árnyéktérképei
+	bool m_directionalLight = false;
+	glm::vec3 m_lightDirection = glm::vec3( 0.5f, 0.70710678f, 0.5f ); // a fény felé mutat
+	bool m_shadows = true;
+	int m_shadowCascadeCount = 4;
+	int m_shadowResolution = 2048;
+	int m_shadowPCFRadius = 1;
+	float m_shadowDistance = 60.0f;
+	float m_shadowSplitLambda = 0.75f;
+	bool m_shadowShowCascades = false;
+	static constexpr GLint SHADOW_TEXTURE_UNIT = 1;
+	CascadedShadowMap m_shadowMap;
+	RenderQueue m_shadowQueue; // az árnyékvetők, a kamerával való vágás nélkül a színtér objektumai
+	InstanceBatcher m_shadowInstanceBatcher; // a tömeg összes példánya (vágás nélkül) és a követők, az árnyék menetekhez
+
+	// sok pontfényforrás a színtér körül keringve, klaszterekbe sorolva (csak a klaszter fényeit nézi a fragment shader)
+	static constexpr int MAX_POINT_LIGHT_COUNT = 4096;
+	int m_pointLightCount = 0;
+	float m_pointLightRadius = 3.0f;
+	float m_clusterFar = 100.0f; // eddig soroljuk be a fényeket
+	std::vector<PointLight> m_pointLights;
+	LightClusters m_lightClusters;
+	void UpdatePointLights();
+
 	// ... és anyagjellemzők
 	glm::vec3 m_Ka = glm::vec3( 1.0 );
 	glm::vec3 m_Kd = glm::vec3( 1.0 );
@@ -118,12 +254,48 @@ protected:
 	void InitShaders();
 	void CleanShaders();
 	void InitSkyboxShaders();
-	void CleanSkyboxShaders();
 	// Geometriával kapcsolatos változók
 
 	OGLObject m_SurfaceGPU = {};
 	OGLObject m_SuzanneGPU = {};
 	OGLObject m_SkyboxGPU = {};
+	GLuint m_AxesVAO = 0;
+
+	// Színtér objektumai: világ transzformáció, háromszög BVH (kiválasztáshoz) és a színtér BVH-ja
+	enum SceneObject { SCENE_SURFACE, SCENE_SUZANNE, SCENE_OBJECT_COUNT };
+	TransformSystem m_transforms;
+	TransformHandle m_objectTransform[ SCENE_OBJECT_COUNT ] = {};
+	const glm::mat4& ObjectWorld( int object ) const { return m_transforms.World( m_objectTransform[ object ] ); }
+	MeshBVH m_SurfaceBVH;
+	MeshBVH m_SuzanneBVH;
+	BVH m_sceneBVH;
+	void UpdateSceneObjects();
+
+	// Nézeti gúla vágás
+	bool m_frustumCulling = true;
+	std::vector<std::uint32_t> m_visibleObjects;
+	std::vector<std::uint8_t> m_visibility;
+
+	// Munkaszálak, és a rajtuk a következő képkockára felépülő sok animált objektum
+	JobSystem m_jobs;
+	Crowd m_crowd;
+	int m_crowdSize = 0;
+	bool m_multithreaded = true;
+	bool m_instancing = true;
+
+	// a kép célja: framebuffer és az ablak mérete (Resize), a mellékmenetek után ide térünk vissza
+	GLuint m_targetFramebufferID = 0;
+
+	// Kiválasztás egérrel
+	int m_windowWidth  = 1;
+	int m_windowHeight = 1;
+	int m_mouseDownX = 0;
+	int m_mouseDownY = 0;
+	int m_pickedObject = -1;
+	RayHit m_pickHit;
+	glm::vec3 m_pickPoint = glm::vec3( 0.0f );
+	double m_pickTimeMs = 0.0;
+	void Pick( int x, int y );
 
 	// Geometria inicializálása, és törtlése
 	void InitGeometry();
@@ -136,7 +308,24 @@ protected:
 
 	GLuint m_TextureID = 0;
 	GLuint m_SuzanneTextureID = 0;
-	GLuint m_SkyboxTextureID = 0;
+	GLuint m_SkyboxTextureID = 0; // az Assets/ képeiből, csak ha a textúrás égboltot választják
+
+	// procedurális égbolt: alacsony felbontású cubemapbe számolva, csak ha a paraméterei változnak
+	enum SkySource { SKY_TEXTURES, SKY_GRADIENT, SKY_PREETHAM };
+	int m_skySource = SKY_PREETHAM;
+	int m_skyFaceSize = 64;
+	SkyParameters m_skyParameters;
+	ProceduralSky m_proceduralSky;
+	GLuint SkyboxTexture();
+
+	// óceán: közös UV rács, az elmozdulásokat képkockánként a CPU FFT számolja a munkaszálakon
+	bool m_showWater = false;
+	float m_waterLevel = -2.5f;
+	OceanParameters m_oceanParameters;
+	static constexpr int WATER_GRID_RESOLUTION = 1024;
+	static constexpr int WATER_FFT_SIZE = 256;
+	static constexpr GLint WATER_TEXTURE_UNIT = 2;
+	Water m_water;
 
 
 	void InitTextures();
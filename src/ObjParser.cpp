@@ -446,6 +446,8 @@ ObjParser::Mesh ObjParser::parse(const std::filesystem::path& fileName)
 		tokenizer.ToNextLine();
 	}
 
+	ComputeMeshBounds( resultMesh );
+
 	return resultMesh;
 }
 
@@ -0,0 +1,246 @@
+#include "OceanFFT.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include <glm/gtc/constants.hpp>
+
+#if defined( __SSE__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 1 )
+#define OCEAN_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+static constexpr float GRAVITY = 9.81f;
+static constexpr std::size_t ROW_GRAIN_SIZE = 16;
+
+void OceanFFT::Init( int size, const OceanParameters& parameters )
+{
+	m_size = size;
+	m_parameters = parameters;
+
+	const std::size_t N = static_cast<std::size_t>( size );
+	m_h0.resize( N * N );
+	m_h0Conj.resize( N * N );
+	m_omega.resize( N * N );
+	m_direction.resize( N * N );
+	m_a.Resize( N * N );
+	m_b.Resize( N * N );
+	m_aT.Resize( N * N );
+	m_bT.Resize( N * N );
+
+	// Phillips spectrum: A exp( -1 / (k L)^2 ) / k^4 |k.w|^2, the waves much shorter than L / 1000 are damped
+	const glm::vec2 wind = glm::length( parameters.windDirection ) > 0.0f ? glm::normalize( parameters.windDirection ) : glm::vec2( 1.0f, 0.0f );
+	const float L = parameters.windSpeed * parameters.windSpeed / GRAVITY;
+	const float damping = L * 0.001f;
+	// the spectrum is a density over the wave vectors, one sample stands for a dk x dk cell:
+	// the heights do not depend on the resolution
+	const float dk = glm::two_pi<float>() / parameters.patchSize;
+	const float scale = parameters.phillipsConstant * dk * dk;
+
+	auto phillips = [ & ]( glm::vec2 k )
+	{
+		const float k2 = glm::dot( k, k );
+		if ( k2 < 1.0e-12f ) return 0.0f;
+		const float kw = glm::dot( k, wind ) / std::sqrt( k2 );
+		return scale * std::exp( -1.0f / ( k2 * L * L ) ) / ( k2 * k2 ) * kw * kw * std::exp( -k2 * damping * damping );
+	};
+
+	std::mt19937 random( parameters.seed );
+	std::normal_distribution<float> gaussian;
+
+	std::vector<std::complex<float>> h0( N * N );
+	for ( std::size_t z = 0; z < N; ++z )
+	{
+		for ( std::size_t x = 0; x < N; ++x )
+		{
+			const glm::vec2 k = glm::two_pi<float>() / parameters.patchSize
+							  * glm::vec2( static_cast<float>( x ) - 0.5f * N, static_cast<float>( z ) - 0.5f * N );
+			const std::size_t i = z * N + x;
+			const float xi = gaussian( random );
+			const float eta = gaussian( random );
+			h0[ i ] = std::complex<float>( xi, eta ) * std::sqrt( phillips( k ) * 0.5f );
+			// the Nyquist frequency is its own negative, the displacements of it would not be real: left out
+			if ( x == 0 || z == 0 ) h0[ i ] = 0.0f;
+
+			const float kLength = glm::length( k );
+			m_omega[ i ] = std::sqrt( GRAVITY * kLength );
+			m_direction[ i ] = kLength > 0.0f ? k / kLength : glm::vec2( 0.0f );
+		}
+	}
+
+	for ( std::size_t z = 0; z < N; ++z )
+	{
+		for ( std::size_t x = 0; x < N; ++x )
+		{
+			const std::size_t negative = ( ( N - z ) % N ) * N + ( N - x ) % N;
+			m_h0[ z * N + x ] = h0[ z * N + x ];
+			m_h0Conj[ z * N + x ] = std::conj( h0[ negative ] );
+		}
+	}
+
+	// twiddles and the bit reversal permutation
+	m_twiddleRe.resize( N > 1 ? N - 1 : 0 );
+	m_twiddleIm.resize( m_twiddleRe.size() );
+	for ( std::size_t half = 1; half < N; half *= 2 )
+	{
+		for ( std::size_t j = 0; j < half; ++j )
+		{
+			const double angle = glm::pi<double>() * static_cast<double>( j ) / static_cast<double>( half );
+			m_twiddleRe[ half - 1 + j ] = static_cast<float>( std::cos( angle ) );
+			m_twiddleIm[ half - 1 + j ] = static_cast<float>( std::sin( angle ) );
+		}
+	}
+
+	int bits = 0;
+	while ( ( std::size_t( 1 ) << bits ) < N ) ++bits;
+	m_bitReverse.resize( N );
+	for ( std::size_t i = 0; i < N; ++i )
+	{
+		std::uint32_t reversed = 0;
+		for ( int bit = 0; bit < bits; ++bit )
+			if ( i & ( std::size_t( 1 ) << bit ) ) reversed |= 1u << ( bits - 1 - bit );
+		m_bitReverse[ i ] = reversed;
+	}
+}
+
+// In-place radix-2 decimation in time inverse FFT of one row (not normalized).
+void OceanFFT::InverseFFTRow( float* re, float* im ) const
+{
+	const std::size_t N = static_cast<std::size_t>( m_size );
+
+	for ( std::size_t i = 0; i < N; ++i )
+	{
+		const std::size_t j = m_bitReverse[ i ];
+		if ( i < j )
+		{
+			std::swap( re[ i ], re[ j ] );
+			std::swap( im[ i ], im[ j ] );
+		}
+	}
+
+	for ( std::size_t half = 1; half < N; half *= 2 )
+	{
+		const float* twiddleRe = m_twiddleRe.data() + half - 1;
+		const float* twiddleIm = m_twiddleIm.data() + half - 1;
+
+		for ( std::size_t block = 0; block < N; block += 2 * half )
+		{
+			float* aRe = re + block;
+			float* aIm = im + block;
+			float* bRe = aRe + half;
+			float* bIm = aIm + half;
+
+			std::size_t j = 0;
+#ifdef OCEAN_USE_SSE
+			// four butterflies at once, the twiddles of a stage are contiguous
+			for ( ; j + 4 <= half; j += 4 )
+			{
+				const __m128 wRe = _mm_loadu_ps( twiddleRe + j );
+				const __m128 wIm = _mm_loadu_ps( twiddleIm + j );
+				const __m128 xRe = _mm_loadu_ps( bRe + j );
+				const __m128 xIm = _mm_loadu_ps( bIm + j );
+				const __m128 vRe = _mm_sub_ps( _mm_mul_ps( xRe, wRe ), _mm_mul_ps( xIm, wIm ) );
+				const __m128 vIm = _mm_add_ps( _mm_mul_ps( xRe, wIm ), _mm_mul_ps( xIm, wRe ) );
+				const __m128 uRe = _mm_loadu_ps( aRe + j );
+				const __m128 uIm = _mm_loadu_ps( aIm + j );
+				_mm_storeu_ps( aRe + j, _mm_add_ps( uRe, vRe ) );
+				_mm_storeu_ps( aIm + j, _mm_add_ps( uIm, vIm ) );
+				_mm_storeu_ps( bRe + j, _mm_sub_ps( uRe, vRe ) );
+				_mm_storeu_ps( bIm + j, _mm_sub_ps( uIm, vIm ) );
+			}
+#endif
+			for ( ; j < half; ++j )
+			{
+				const float vRe = bRe[ j ] * twiddleRe[ j ] - bIm[ j ] * twiddleIm[ j ];
+				const float vIm = bRe[ j ] * twiddleIm[ j ] + bIm[ j ] * twiddleRe[ j ];
+				const float uRe = aRe[ j ];
+				const float uIm = aIm[ j ];
+				aRe[ j ] = uRe + vRe;
+				aIm[ j ] = uIm + vIm;
+				bRe[ j ] = uRe - vRe;
+				bIm[ j ] = uIm - vIm;
+			}
+		}
+	}
+}
+
+void OceanFFT::Transpose( const ComplexField& source, ComplexField& destination, int size, std::size_t rowBegin, std::size_t rowEnd )
+{
+	// destination rows [rowBegin, rowEnd), in tiles so both sides stay in the cache
+	constexpr std::size_t TILE = 16;
+	const std::size_t N = static_cast<std::size_t>( size );
+	for ( std::size_t column = 0; column < N; column += TILE )
+	{
+		const std::size_t columnEnd = std::min( column + TILE, N );
+		for ( std::size_t row = rowBegin; row < rowEnd; ++row )
+		{
+			for ( std::size_t c = column; c < columnEnd; ++c )
+			{
+				destination.re[ row * N + c ] = source.re[ c * N + row ];
+				destination.im[ row * N + c ] = source.im[ c * N + row ];
+			}
+		}
+	}
+}
+
+void OceanFFT::Evaluate( double time, JobSystem& jobs, glm::vec4* out )
+{
+	const std::size_t N = static_cast<std::size_t>( m_size );
+	if ( N == 0 ) return;
+
+	// 1. spectrum at the time, then the FFT along x: h(k, t) = h0(k) e^(i w t) + conj(h0(-k)) e^(-i w t)
+	jobs.ParallelFor( N, ROW_GRAIN_SIZE, [ this, N, time ]( std::size_t begin, std::size_t end )
+	{
+		for ( std::size_t z = begin; z < end; ++z )
+		{
+			for ( std::size_t x = 0; x < N; ++x )
+			{
+				const std::size_t i = z * N + x;
+				// w t grows without bound, only its remainder is converted to float
+				const float phase = static_cast<float>( std::fmod( static_cast<double>( m_omega[ i ] ) * time, glm::two_pi<double>() ) );
+				const std::complex<float> rotation( std::cos( phase ), std::sin( phase ) );
+				const std::complex<float> h = m_h0[ i ] * rotation + m_h0Conj[ i ] * std::conj( rotation );
+
+				// displacement: D(k) = -i k / |k| h; the x displacement goes into the imaginary part of the height:
+				// h + i Dx = h ( 1 + kx / |k| )
+				const glm::vec2 direction = m_direction[ i ];
+				const std::complex<float> a = h * ( 1.0f + direction.x );
+				const std::complex<float> b = std::complex<float>( 0.0f, -direction.y ) * h;
+				m_a.re[ i ] = a.real();
+				m_a.im[ i ] = a.imag();
+				m_b.re[ i ] = b.real();
+				m_b.im[ i ] = b.imag();
+			}
+
+			InverseFFTRow( m_a.re.data() + z * N, m_a.im.data() + z * N );
+			InverseFFTRow( m_b.re.data() + z * N, m_b.im.data() + z * N );
+		}
+	} );
+
+	// 2. transpose, then the FFT along z
+	jobs.ParallelFor( N, ROW_GRAIN_SIZE, [ this, N ]( std::size_t begin, std::size_t end )
+	{
+		Transpose( m_a, m_aT, m_size, begin, end );
+		Transpose( m_b, m_bT, m_size, begin, end );
+		for ( std::size_t x = begin; x < end; ++x )
+		{
+			InverseFFTRow( m_aT.re.data() + x * N, m_aT.im.data() + x * N );
+			InverseFFTRow( m_bT.re.data() + x * N, m_bT.im.data() + x * N );
+		}
+	} );
+
+	// 3. the frequencies run from -N/2, which is a (-1)^(x+z) factor in the spatial domain
+	jobs.ParallelFor( N, ROW_GRAIN_SIZE, [ this, N, out ]( std::size_t begin, std::size_t end )
+	{
+		for ( std::size_t z = begin; z < end; ++z )
+		{
+			for ( std::size_t x = 0; x < N; ++x )
+			{
+				const std::size_t i = x * N + z; // transposed
+				const float sign = ( ( x + z ) & 1 ) ? -1.0f : 1.0f;
+				out[ z * N + x ] = glm::vec4( sign * m_aT.im[ i ], sign * m_aT.re[ i ], sign * m_bT.re[ i ], 0.0f );
+			}
+		}
+	} );
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "JobSystem.h"
+
+struct OceanParameters
+{
+	float patchSize = 64.0f; // the height field tiles with this period (meters)
+	float windSpeed = 12.0f; // m/s
+	glm::vec2 windDirection = glm::vec2( 1.0f, 0.0f );
+	float phillipsConstant = 7.0e-4f; // A of the Phillips spectrum, the wave height grows with its square root
+	std::uint32_t seed = 1;
+
+	bool operator==( const OceanParameters& ) const = default;
+};
+
+// Tessendorf's FFT ocean on the CPU. The Phillips spectrum is set up once (Init), every frame the spectrum is
+// advanced in time and transformed back with two 2D inverse FFTs: height + i * x displacement packed into one
+// (both are real), and the z displacement. The 2D FFT is radix-2 row FFTs, a transpose, and row FFTs again,
+// the rows are distributed over the job system and the butterflies run 4-wide with SSE (split real/imaginary arrays).
+class OceanFFT
+{
+public:
+	// size: power of two, the resolution of the height field
+	void Init( int size, const OceanParameters& parameters );
+
+	// Writes size * size texels: ( x displacement, height, z displacement, 0 ), row z at out + z * size.
+	// out may be mapped GPU memory, every texel is written exactly once. time: seconds since the start (double,
+	// the phases are reduced in double so the waves stay precise however long the program runs).
+	void Evaluate( double time, JobSystem& jobs, glm::vec4* out );
+
+	int Size() const { return m_size; }
+	const OceanParameters& Parameters() const { return m_parameters; }
+
+private:
+	struct ComplexField
+	{
+		std::vector<float> re, im;
+		void Resize( std::size_t count ) { re.assign( count, 0.0f ); im.assign( count, 0.0f ); }
+	};
+
+	int m_size = 0;
+	OceanParameters m_parameters;
+
+	std::vector<std::complex<float>> m_h0;       // h0( k )
+	std::vector<std::complex<float>> m_h0Conj;   // conj( h0( -k ) )
+	std::vector<float> m_omega;                  // dispersion: sqrt( g |k| )
+	std::vector<glm::vec2> m_direction;          // k / |k|, zero for k = 0
+
+	// the two transformed fields and their transposes
+	ComplexField m_a, m_b, m_aT, m_bT;
+
+	// twiddles of the inverse FFT: exp( 2 pi i j / len ) of the stage with len = 2 * half at [ half - 1 + j ]
+	std::vector<float> m_twiddleRe, m_twiddleIm;
+	std::vector<std::uint32_t> m_bitReverse;
+
+	void InverseFFTRow( float* re, float* im ) const;
+	static void Transpose( const ComplexField& source, ComplexField& destination, int size, std::size_t rowBegin, std::size_t rowEnd );
+};
@@ -58,6 +58,8 @@ template <typename SurfT>
 			outputMesh.indexArray[ index + 5 ] = static_cast<GLuint>( ( i     ) + ( j + 1 ) * ( N + 1 ) );
 		}
 	}
-    
+
+	ComputeMeshBounds( outputMesh );
+
         return outputMesh;
 }
\ No newline at end of file
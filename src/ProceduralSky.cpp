@@ -0,0 +1,137 @@
+#include "ProceduralSky.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/gtc/constants.hpp>
+
+void ProceduralSky::Init( GLsizei faceSize )
+{
+	Clean();
+	m_faceSize = faceSize;
+
+	glCreateTextures( GL_TEXTURE_CUBE_MAP, 1, &m_textureID );
+	glTextureStorage2D( m_textureID, 1, GL_RGBA16F, faceSize, faceSize );
+	m_valid = false;
+}
+
+void ProceduralSky::Clean()
+{
+	glDeleteTextures( 1, &m_textureID );
+	m_textureID = 0;
+	m_faceSize = 0;
+	m_valid = false;
+}
+
+// Perez et al. luminance distribution: theta is the angle from the zenith, gamma from the sun
+static float Perez( const float coefficients[ 5 ], float cosTheta, float gamma, float cosGamma )
+{
+	return ( 1.0f + coefficients[ 0 ] * std::exp( coefficients[ 1 ] / cosTheta ) )
+		 * ( 1.0f + coefficients[ 2 ] * std::exp( coefficients[ 3 ] * gamma ) + coefficients[ 4 ] * cosGamma * cosGamma );
+}
+
+static glm::vec3 PreethamSky( const SkyParameters& parameters, const glm::vec3& direction )
+{
+	const float T = parameters.turbidity;
+	const glm::vec3 sun = parameters.sunDirection;
+
+	// below the horizon the sun is treated as if it was on it, so the sky fades out instead of blowing up
+	const float thetaSun = std::acos( std::clamp( sun.y, 0.0f, 1.0f ) );
+	const float theta2 = thetaSun * thetaSun;
+	const float theta3 = theta2 * thetaSun;
+
+	const float luminance[ 5 ] = { 0.1787f * T - 1.4630f, -0.3554f * T + 0.4275f, -0.0227f * T + 5.3251f, 0.1206f * T - 2.5771f, -0.0670f * T + 0.3703f };
+	const float chromaX[ 5 ] = { -0.0193f * T - 0.2592f, -0.0665f * T + 0.0008f, -0.0004f * T + 0.2125f, -0.0641f * T - 0.8989f, -0.0033f * T + 0.0452f };
+	const float chromaY[ 5 ] = { -0.0167f * T - 0.2608f, -0.0950f * T + 0.0092f, -0.0079f * T + 0.2102f, -0.0441f * T - 1.6537f, -0.0109f * T + 0.0529f };
+
+	// zenith chromaticity; the zenith luminance is left out, the exposure scales relative to it
+	const float zenithX = T * T * ( 0.00166f * theta3 - 0.00375f * theta2 + 0.00209f * thetaSun )
+						+ T * ( -0.02903f * theta3 + 0.06377f * theta2 - 0.03202f * thetaSun + 0.00394f )
+						+ ( 0.11693f * theta3 - 0.21196f * theta2 + 0.06052f * thetaSun + 0.25886f );
+	const float zenithY = T * T * ( 0.00275f * theta3 - 0.00610f * theta2 + 0.00317f * thetaSun )
+						+ T * ( -0.04214f * theta3 + 0.08970f * theta2 - 0.04153f * thetaSun + 0.00516f )
+						+ ( 0.15346f * theta3 - 0.26756f * theta2 + 0.06670f * thetaSun + 0.26688f );
+
+	const float cosTheta = std::max( direction.y, 0.01f );
+	const float cosGamma = std::clamp( glm::dot( direction, sun ), -1.0f, 1.0f );
+	const float gamma = std::acos( cosGamma );
+	const float cosThetaSun = std::cos( thetaSun );
+
+	const float Y = Perez( luminance, cosTheta, gamma, cosGamma ) / Perez( luminance, 1.0f, thetaSun, cosThetaSun );
+	const float x = zenithX * Perez( chromaX, cosTheta, gamma, cosGamma ) / Perez( chromaX, 1.0f, thetaSun, cosThetaSun );
+	const float y = zenithY * Perez( chromaY, cosTheta, gamma, cosGamma ) / Perez( chromaY, 1.0f, thetaSun, cosThetaSun );
+
+	// xyY -> XYZ -> linear sRGB
+	const float X = x / y * Y;
+	const float Z = ( 1.0f - x - y ) / y * Y;
+	const glm::vec3 rgb(
+		 3.2406f * X - 1.5372f * Y - 0.4986f * Z,
+		-0.9689f * X + 1.8758f * Y + 0.0415f * Z,
+		 0.0557f * X - 0.2040f * Y + 1.0570f * Z );
+
+	return glm::max( rgb, glm::vec3( 0.0f ) );
+}
+
+// the sky and the ground get darker as the sun sets
+static float Daylight( const glm::vec3& sunDirection )
+{
+	return std::clamp( sunDirection.y * 4.0f + 0.2f, 0.05f, 1.0f );
+}
+
+glm::vec3 ProceduralSky::Evaluate( const SkyParameters& parameters, const glm::vec3& direction )
+{
+	if ( parameters.model == SkyModel::GRADIENT )
+		return glm::mix( parameters.groundColor, parameters.skyColor, ( direction.y + 1.0f ) * 0.5f );
+
+	const float daylight = Daylight( parameters.sunDirection );
+	glm::vec3 color = PreethamSky( parameters, direction ) * daylight;
+	// exponential tone mapping, then gamma for the (linear) default framebuffer
+	color = glm::vec3( 1.0f ) - glm::exp( -parameters.exposure * color );
+	color = glm::pow( color, glm::vec3( 1.0f / 2.2f ) );
+
+	// below the horizon the ground color, blended over a few degrees
+	const float ground = std::clamp( -direction.y * 10.0f, 0.0f, 1.0f );
+	return glm::mix( color, parameters.groundColor * daylight, ground );
+}
+
+// Direction of the texel center of a cubemap face (s, t in [-1, 1]), in the order of the GL faces: +X, -X, +Y, -Y, +Z, -Z.
+static glm::vec3 CubeFaceDirection( int face, float s, float t )
+{
+	switch ( face )
+	{
+	case 0:  return glm::vec3(  1.0f,   -t,   -s );
+	case 1:  return glm::vec3( -1.0f,   -t,    s );
+	case 2:  return glm::vec3(     s, 1.0f,    t );
+	case 3:  return glm::vec3(     s,-1.0f,   -t );
+	case 4:  return glm::vec3(     s,   -t, 1.0f );
+	default: return glm::vec3(    -s,   -t,-1.0f );
+	}
+}
+
+bool ProceduralSky::Update( const SkyParameters& parameters )
+{
+	if ( m_valid && parameters == m_parameters ) return false;
+
+	m_parameters = parameters;
+	m_valid = true;
+
+	const std::size_t faceSize = static_cast<std::size_t>( m_faceSize );
+	m_face.resize( faceSize * faceSize );
+	for ( int face = 0; face < 6; ++face )
+	{
+		for ( std::size_t row = 0; row < faceSize; ++row )
+		{
+			const float t = ( static_cast<float>( row ) + 0.5f ) / static_cast<float>( faceSize ) * 2.0f - 1.0f;
+			for ( std::size_t column = 0; column < faceSize; ++column )
+			{
+				const float s = ( static_cast<float>( column ) + 0.5f ) / static_cast<float>( faceSize ) * 2.0f - 1.0f;
+				const glm::vec3 direction = glm::normalize( CubeFaceDirection( face, s, t ) );
+				m_face[ row * faceSize + column ] = glm::vec4( Evaluate( m_parameters, direction ), 1.0f );
+			}
+		}
+
+		glTextureSubImage3D( m_textureID, 0, 0, 0, face, m_faceSize, m_faceSize, 1, GL_RGBA, GL_FLOAT, m_face.data() );
+	}
+
+	return true;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+enum class SkyModel : int
+{
+	GRADIENT, // ground - sky color gradient by the height of the direction
+	PREETHAM, // analytic daylight model (Preetham, Shirley, Smits: A Practical Analytic Model for Daylight)
+};
+
+struct SkyParameters
+{
+	SkyModel model = SkyModel::PREETHAM;
+	glm::vec3 sunDirection = glm::vec3( 0.0f, 1.0f, 0.0f ); // towards the sun, unit length
+	float turbidity = 3.0f; // haze, 2 (clear) - 10 (hazy)
+	float exposure = 0.6f;
+	glm::vec3 groundColor = glm::vec3( 0.3f, 0.4f, 0.2f );
+	glm::vec3 skyColor = glm::vec3( 0.2f, 0.2f, 0.7f );
+
+	bool operator==( const SkyParameters& ) const = default;
+};
+
+// Sky evaluated analytically on the CPU and cached in a low resolution cubemap (RGBA16F, display ready colors).
+// The cubemap is only rebuilt when the parameters (or the face size) change, so there is no texture I/O at all
+// and the per-frame cost is the same as a cubemap skybox.
+class ProceduralSky
+{
+public:
+	void Init( GLsizei faceSize );
+	void Clean();
+
+	// Rebuilds the cubemap if the parameters differ from the cached ones. Returns true if it was rebuilt.
+	bool Update( const SkyParameters& parameters );
+
+	// The color of a direction (unit vector), the same as the cubemap stores.
+	static glm::vec3 Evaluate( const SkyParameters& parameters, const glm::vec3& direction );
+
+	GLuint TextureID() const { return m_textureID; }
+	GLsizei FaceSize() const { return m_faceSize; }
+
+private:
+	GLuint m_textureID = 0;
+	GLsizei m_faceSize = 0;
+	bool m_valid = false;
+	SkyParameters m_parameters;
+	std::vector<glm::vec4> m_face;
+};
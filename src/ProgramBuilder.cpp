@@ -2,6 +2,43 @@
 #include "GLUtils.hpp"
 #include <SDL2/SDL_log.h>
 
+#include <cstdio>
+#include <fstream>
+#include <string_view>
+
+// Header of the cached program binary files
+struct ProgramBinaryHeader
+{
+	char          magic[ 4 ];   // "PBIN"
+	std::uint32_t binaryFormat; // the format returned by glGetProgramBinary
+	std::uint64_t key;          // guards against colliding file names
+	std::uint64_t length;
+};
+
+// 64 bit FNV-1a
+static std::uint64_t HashBytes( std::uint64_t hash, std::string_view bytes )
+{
+	for ( unsigned char byte : bytes )
+	{
+		hash ^= byte;
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+static std::string_view GLString( GLenum name )
+{
+	const GLubyte* str = glGetString( name );
+	return str ? std::string_view( reinterpret_cast<const char*>( str ) ) : std::string_view();
+}
+
+static std::filesystem::path BinaryFileName( const std::filesystem::path& cacheDir, std::uint64_t key )
+{
+	char fileName[ 32 ];
+	std::snprintf( fileName, sizeof( fileName ), "%016llx.bin", static_cast<unsigned long long>( key ) );
+	return cacheDir / fileName;
+}
+
 ProgramBuilder::ProgramBuilder(const GLuint _programID) : programID(_programID)
 {
 	if (programID == 0)
@@ -20,11 +57,146 @@ ProgramBuilder::~ProgramBuilder()
 
 ProgramBuilder& ProgramBuilder::ShaderStage( const GLenum shaderType, const std::filesystem::path& filename)
 {
-    AttachShader( programID, shaderType, filename );
+    // The sources are only read here, compilation is deferred to Link(), which may skip it entirely.
+    Stage& stage = stages.emplace_back( Stage{ shaderType, filename, {} } );
+    LoadShaderCode( stage.code, filename );
     return *this;
 }
 
 void ProgramBuilder::Link()
 {
-    LinkProgram( programID, true );
+    LinkAsync();
+    FinishLink();
+}
+
+void ProgramBuilder::LinkAsync()
+{
+    if ( programID == 0 ) return;
+
+    cacheKey = ComputeCacheKey();
+
+    linkedFromCache = LoadBinary( cacheKey );
+    if ( linkedFromCache ) return;
+
+    // The compile status is only queried in FinishLink(), querying it here would wait for the compiler.
+    for ( const Stage& stage : stages )
+    {
+        AttachShaderCode( programID, stage.shaderType, stage.code, false );
+    }
+
+    glProgramParameteri( programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+
+    glLinkProgram( programID );
+}
+
+bool ProgramBuilder::IsLinkComplete() const
+{
+    if ( programID == 0 || linkedFromCache ) return true;
+
+    // Without the extension there is nothing to poll, the driver finishes the work on the first status query.
+    if ( !GLEW_KHR_parallel_shader_compile && !GLEW_ARB_parallel_shader_compile ) return true;
+
+    GLint completed = GL_FALSE;
+    glGetProgramiv( programID, GL_COMPLETION_STATUS_KHR, &completed );
+    return GL_FALSE != completed;
+}
+
+bool ProgramBuilder::FinishLink()
+{
+    if ( programID == 0 ) return false;
+    if ( linkedFromCache ) return true;
+
+    // compile logs of the stages (the shaders are deleted by CheckProgramLinkStatus)
+    GLint attachedShaders = 0;
+    glGetProgramiv( programID, GL_ATTACHED_SHADERS, &attachedShaders );
+    std::vector<GLuint> shaders( attachedShaders );
+    glGetAttachedShaders( programID, attachedShaders, nullptr, shaders.data() );
+    for ( GLuint shader : shaders )
+    {
+        CheckShaderCompileStatus( shader );
+    }
+
+    if ( !CheckProgramLinkStatus( programID, true ) ) return false;
+
+    SaveBinary( cacheKey );
+    return true;
+}
+
+std::uint64_t ProgramBuilder::ComputeCacheKey() const
+{
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+
+    // A binary is only valid for the driver that produced it
+    hash = HashBytes( hash, GLString( GL_VENDOR ) );
+    hash = HashBytes( hash, GLString( GL_RENDERER ) );
+    hash = HashBytes( hash, GLString( GL_VERSION ) );
+
+    for ( const Stage& stage : stages )
+    {
+        hash = HashBytes( hash, std::string_view( reinterpret_cast<const char*>( &stage.shaderType ), sizeof( stage.shaderType ) ) );
+        hash = HashBytes( hash, stage.code );
+    }
+
+    return hash;
+}
+
+bool ProgramBuilder::LoadBinary( std::uint64_t key )
+{
+    GLint formatCount = 0;
+    glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount );
+    if ( formatCount == 0 ) return false;
+
+    std::ifstream binaryStream( BinaryFileName( BINARY_CACHE_DIR, key ), std::ios::binary );
+    if ( !binaryStream ) return false;
+
+    ProgramBinaryHeader header = {};
+    if ( !binaryStream.read( reinterpret_cast<char*>( &header ), sizeof( header ) )
+         || std::string_view( header.magic, 4 ) != "PBIN"
+         || header.key != key
+         || header.length == 0 )
+    {
+        return false;
+    }
+
+    std::vector<char> binary( header.length );
+    if ( !binaryStream.read( binary.data(), binary.size() ) ) return false;
+
+    glProgramBinary( programID, header.binaryFormat, binary.data(), static_cast<GLsizei>( binary.size() ) );
+
+    // The driver may reject the binary (e.g. after an update), then we fall back to compiling the sources.
+    GLint result = GL_FALSE;
+    glGetProgramiv( programID, GL_LINK_STATUS, &result );
+    return GL_FALSE != result;
+}
+
+void ProgramBuilder::SaveBinary( std::uint64_t key ) const
+{
+    GLint binaryLength = 0;
+    glGetProgramiv( programID, GL_PROGRAM_BINARY_LENGTH, &binaryLength );
+    if ( binaryLength <= 0 ) return;
+
+    ProgramBinaryHeader header = { { 'P', 'B', 'I', 'N' }, 0, key, 0 };
+    std::vector<char> binary( binaryLength );
+
+    GLsizei writtenLength = 0;
+    GLenum binaryFormat = GL_NONE;
+    glGetProgramBinary( programID, binaryLength, &writtenLength, &binaryFormat, binary.data() );
+    if ( writtenLength <= 0 ) return;
+
+    header.binaryFormat = binaryFormat;
+    header.length = static_cast<std::uint64_t>( writtenLength );
+
+    std::error_code ec;
+    std::filesystem::create_directories( BINARY_CACHE_DIR, ec );
+
+    std::ofstream binaryStream( BinaryFileName( BINARY_CACHE_DIR, key ), std::ios::binary | std::ios::trunc );
+    binaryStream.write( reinterpret_cast<const char*>( &header ), sizeof( header ) );
+    binaryStream.write( binary.data(), writtenLength );
+
+    if ( !binaryStream )
+    {
+        SDL_LogMessage( SDL_LOG_CATEGORY_ERROR,
+                        SDL_LOG_PRIORITY_WARN,
+                        "[ProgramBuilder] Could not write program binary cache to %s", BINARY_CACHE_DIR.string().c_str() );
+    }
 }
\ No newline at end of file
@@ -1,12 +1,33 @@
 #pragma once
 
 #include <filesystem>
+#include <string>
+#include <vector>
+#include <cstdint>
 #include <GL/glew.h>
 
 class ProgramBuilder
 {
 private:
 	const GLuint programID;
+
+	struct Stage
+	{
+		GLenum shaderType;
+		std::filesystem::path fileName;
+		std::string code;
+	};
+	std::vector<Stage> stages;
+
+	std::uint64_t cacheKey = 0;
+	bool linkedFromCache = false;
+
+	// Linked program binaries are cached in this directory, keyed by the hash of the stage sources and the driver.
+	static inline const std::filesystem::path BINARY_CACHE_DIR = "ShaderCache";
+
+	std::uint64_t ComputeCacheKey() const;
+	bool LoadBinary(std::uint64_t);
+	void SaveBinary(std::uint64_t) const;
 protected:
 	//void LoadShader(const GLuint, const std::filesystem::path&);
 	//void CompileShaderFromSource(const GLuint, std::string_view);
@@ -16,4 +37,10 @@ public:
 	~ProgramBuilder();
 	ProgramBuilder& ShaderStage(const GLenum, const std::filesystem::path&);
 	void Link();
+
+	// Non-blocking variant of Link(): LinkAsync() issues the compile and link commands,
+	// IsLinkComplete() polls the driver (GL_KHR_parallel_shader_compile), FinishLink() checks the result.
+	void LinkAsync();
+	bool IsLinkComplete() const;
+	bool FinishLink();
 };
\ No newline at end of file
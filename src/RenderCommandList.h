@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+// One draw of a mesh with its own transform.
+struct DrawCommand
+{
+	GLuint vaoID = 0;
+	GLuint depthVaoID = 0; // position only vertex stream of the same buffers for depth-only passes, 0: vaoID is used
+	GLenum mode = GL_TRIANGLES;
+	GLsizei count = 0;    // number of indices, or vertices if not indexed
+	bool indexed = true;  // glDrawElements with GL_UNSIGNED_INT indices, otherwise glDrawArrays
+	GLuint textureID = 0; // texture unit 0
+	GLuint samplerID = 0;
+
+	// instanced draw if instanceCount > 0: the transforms come from the instance buffer ("firstInstance" uniform)
+	GLsizei instanceCount = 0;
+	GLuint firstInstance = 0;
+
+	glm::mat4 world = glm::mat4( 1.0f );
+	glm::mat4 worldIT = glm::mat4( 1.0f );
+};
+
+// Draw commands recorded without touching OpenGL (so on any thread). They are submitted on the thread
+// of the context through the RenderQueue, which also picks the program, so a shader reload in between is harmless.
+class RenderCommandList
+{
+public:
+	void Clear() { m_commands.clear(); }
+	void Reserve( std::size_t count ) { m_commands.reserve( count ); }
+	void Add( const DrawCommand& command ) { m_commands.push_back( command ); }
+
+	std::size_t Size() const { return m_commands.size(); }
+
+	std::vector<DrawCommand>::const_iterator begin() const { return m_commands.begin(); }
+	std::vector<DrawCommand>::const_iterator end() const { return m_commands.end(); }
+
+private:
+	std::vector<DrawCommand> m_commands;
+};
@@ -0,0 +1,175 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include "GLUtils.hpp"
+
+std::uint64_t RenderQueue::MakeSortKey( RenderPass pass, GLuint programID, GLuint materialID, float depth )
+{
+	// the bit pattern of a non-negative float grows with its value, so it sorts like an integer
+	depth = std::max( depth, 0.0f );
+	std::uint32_t depthBits;
+	std::memcpy( &depthBits, &depth, sizeof( depthBits ) );
+
+	// the names are only used for grouping, a collision in the truncated bits only costs a state change
+	return ( static_cast<std::uint64_t>( pass & 0xF ) << 60 )
+		 | ( static_cast<std::uint64_t>( programID & 0xFFF ) << 48 )
+		 | ( static_cast<std::uint64_t>( materialID & 0xFFFF ) << 32 )
+		 | depthBits;
+}
+
+void RenderQueue::Clear()
+{
+	m_items.clear();
+	m_draws.clear();
+	m_storedCommands.clear();
+	m_programLocations.clear();
+}
+
+void RenderQueue::Submit( RenderPass pass, GLuint programID, const DrawCommand& command, float depth )
+{
+	m_items.push_back( { MakeSortKey( pass, programID, command.textureID, depth ), static_cast<std::uint32_t>( m_draws.size() ) } );
+	m_draws.push_back( { programID, &command } );
+}
+
+const DrawCommand& RenderQueue::Store( const DrawCommand& command )
+{
+	m_storedCommands.push_back( command );
+	return m_storedCommands.back();
+}
+
+void RenderQueue::Sort()
+{
+	// LSD radix sort, 8 bits per pass; stable, so the equal keys keep the submission order
+	m_sortBuffer.resize( m_items.size() );
+
+	for ( int shift = 0; shift < 64; shift += 8 )
+	{
+		std::array<std::uint32_t, 256> histogram{};
+		for ( const Item& item : m_items )
+			++histogram[ ( item.key >> shift ) & 0xFF ];
+
+		// every key has the same digit here (typical for the pass and program bytes): nothing to do
+		if ( histogram[ ( m_items.empty() ? 0 : m_items.front().key >> shift ) & 0xFF ] == m_items.size() ) continue;
+
+		std::uint32_t offset = 0;
+		for ( std::uint32_t& count : histogram )
+		{
+			const std::uint32_t bucketSize = count;
+			count = offset;
+			offset += bucketSize;
+		}
+
+		for ( const Item& item : m_items )
+			m_sortBuffer[ histogram[ ( item.key >> shift ) & 0xFF ]++ ] = item;
+
+		m_items.swap( m_sortBuffer );
+	}
+}
+
+const RenderQueue::ProgramLocations& RenderQueue::Locations( GLuint programID ) const
+{
+	for ( const ProgramLocations& locations : m_programLocations )
+		if ( locations.programID == programID ) return locations;
+
+	m_programLocations.push_back( { programID, ul( programID, "world" ), ul( programID, "worldIT" ), ul( programID, "firstInstance" ) } );
+	return m_programLocations.back();
+}
+
+void RenderQueue::Execute( GLStateCache& state, const std::array<RenderPassState, RENDER_PASS_COUNT>& passStates ) const
+{
+	int currentPass = -1;
+	GLuint currentProgramID = 0;
+	const ProgramLocations* locations = nullptr;
+
+	for ( const Item& item : m_items )
+	{
+		const int pass = static_cast<int>( item.key >> 60 );
+		const RenderPassState& passState = passStates[ pass ];
+		if ( !passState.enabled ) continue;
+
+		if ( pass != currentPass )
+		{
+			state.SetDepthTest( passState.depthTest );
+			state.SetDepthFunc( passState.depthFunc );
+			state.SetDepthMask( passState.depthWrite );
+			state.SetCullFace( passState.cullFace );
+			state.SetBlend( passState.additiveBlend );
+			if ( passState.additiveBlend ) state.SetBlendFunc( GL_ONE, GL_ONE );
+			currentPass = pass;
+		}
+
+		const Draw& draw = m_draws[ item.draw ];
+		if ( draw.programID != currentProgramID )
+		{
+			state.UseProgram( draw.programID );
+			locations = &Locations( draw.programID );
+			currentProgramID = draw.programID;
+		}
+
+		const DrawCommand& command = *draw.command;
+		state.BindTextureUnit( 0, command.textureID );
+		state.BindSampler( 0, command.samplerID );
+		state.BindVertexArray( command.vaoID );
+
+		if ( command.instanceCount > 0 )
+		{
+			glProgramUniform1i( draw.programID, locations->firstInstance, static_cast<GLint>( command.firstInstance ) );
+
+			if ( command.indexed )
+				glDrawElementsInstanced( command.mode, command.count, GL_UNSIGNED_INT, nullptr, command.instanceCount );
+			else
+				glDrawArraysInstanced( command.mode, 0, command.count, command.instanceCount );
+			continue;
+		}
+
+		glProgramUniformMatrix4fv( draw.programID, locations->world, 1, GL_FALSE, glm::value_ptr( command.world ) );
+		glProgramUniformMatrix4fv( draw.programID, locations->worldIT, 1, GL_FALSE, glm::value_ptr( command.worldIT ) );
+
+		if ( command.indexed )
+			glDrawElements( command.mode, command.count, GL_UNSIGNED_INT, nullptr );
+		else
+			glDrawArrays( command.mode, 0, command.count );
+	}
+}
+
+void RenderQueue::ExecuteDepthOnly( GLStateCache& state ) const
+{
+	GLuint currentProgramID = 0;
+	const ProgramLocations* locations = nullptr;
+
+	for ( const Item& item : m_items )
+	{
+		const Draw& draw = m_draws[ item.draw ];
+		if ( draw.programID != currentProgramID )
+		{
+			state.UseProgram( draw.programID );
+			locations = &Locations( draw.programID );
+			currentProgramID = draw.programID;
+		}
+
+		const DrawCommand& command = *draw.command;
+		state.BindVertexArray( command.depthVaoID != 0 ? command.depthVaoID : command.vaoID );
+
+		if ( command.instanceCount > 0 )
+		{
+			glProgramUniform1i( draw.programID, locations->firstInstance, static_cast<GLint>( command.firstInstance ) );
+
+			if ( command.indexed )
+				glDrawElementsInstanced( command.mode, command.count, GL_UNSIGNED_INT, nullptr, command.instanceCount );
+			else
+				glDrawArraysInstanced( command.mode, 0, command.count, command.instanceCount );
+			continue;
+		}
+
+		glProgramUniformMatrix4fv( draw.programID, locations->world, 1, GL_FALSE, glm::value_ptr( command.world ) );
+
+		if ( command.indexed )
+			glDrawElements( command.mode, command.count, GL_UNSIGNED_INT, nullptr );
+		else
+			glDrawArrays( command.mode, 0, command.count );
+	}
+}
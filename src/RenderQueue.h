@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "GLStateCache.h"
+#include "RenderCommandList.h"
+
+// Passes in submission order.
+enum RenderPass : std::uint8_t
+{
+	RENDER_PASS_OPAQUE,
+	RENDER_PASS_SKY,     // after the opaque geometry, only the uncovered pixels pass the depth test
+	RENDER_PASS_OVERLAY, // gizmos
+	RENDER_PASS_COUNT
+};
+
+// Fixed function state of a pass, applied through the state cache when the pass begins.
+struct RenderPassState
+{
+	bool enabled = true; // the draws of a disabled pass are skipped
+	bool depthTest = true;
+	GLenum depthFunc = GL_LESS;
+	bool depthWrite = true;
+	bool cullFace = true;
+	bool additiveBlend = false; // GL_ONE, GL_ONE (e.g. overdraw visualization)
+};
+
+// Per-frame draw queue. Every draw gets a 64 bit sort key
+//   | pass : 4 | program : 12 | material : 16 | depth : 32 |
+// and the queue is radix sorted before submission: passes in order, within a pass grouped by program and texture
+// (the fewest state changes), and within the same state front to back for early-Z.
+class RenderQueue
+{
+public:
+	static std::uint64_t MakeSortKey( RenderPass pass, GLuint programID, GLuint materialID, float depth );
+
+	void Clear();
+
+	// The command is referenced, it has to stay alive until Execute() (e.g. a RenderCommandList of the frame).
+	void Submit( RenderPass pass, GLuint programID, const DrawCommand& command, float depth );
+	// Keeps a copy of the command for the frame, for the draws that are not recorded elsewhere.
+	const DrawCommand& Store( const DrawCommand& command );
+
+	void Sort();
+	// Sets "world" and "worldIT" (or "firstInstance" for instanced draws) of the program for every draw,
+	// everything else has to be set beforehand.
+	void Execute( GLStateCache& state, const std::array<RenderPassState, RENDER_PASS_COUNT>& passStates ) const;
+	// Depth-only submission of every draw: the position only VAOs, no textures and no "worldIT".
+	// The fixed function state (and the framebuffer) is left to the caller.
+	void ExecuteDepthOnly( GLStateCache& state ) const;
+
+	std::size_t Size() const { return m_items.size(); }
+
+private:
+	struct Item
+	{
+		std::uint64_t key;
+		std::uint32_t draw;
+	};
+
+	struct Draw
+	{
+		GLuint programID;
+		const DrawCommand* command;
+	};
+
+	// Uniform locations of a program, looked up once per frame (a reloaded program may reuse the name of the old one).
+	struct ProgramLocations
+	{
+		GLuint programID;
+		GLint world;
+		GLint worldIT;
+		GLint firstInstance;
+	};
+	const ProgramLocations& Locations( GLuint programID ) const;
+
+	std::vector<Item> m_items;
+	std::vector<Item> m_sortBuffer;
+	std::vector<Draw> m_draws;
+	std::deque<DrawCommand> m_storedCommands; // deque: the references stay valid while it grows
+	mutable std::vector<ProgramLocations> m_programLocations; // a handful of programs, searched linearly
+};
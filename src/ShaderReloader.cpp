@@ -0,0 +1,209 @@
+#include "ShaderReloader.h"
+
+#include <SDL2/SDL_log.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+ShaderReloader::ShaderReloader()
+{
+}
+
+ShaderReloader::~ShaderReloader()
+{
+	Clean();
+}
+
+void ShaderReloader::Init( const std::filesystem::path& shaderDir )
+{
+	// Let the driver compile on its own threads, so that the compile does not stall the frame
+	if ( GLEW_KHR_parallel_shader_compile )
+	{
+		glMaxShaderCompilerThreadsKHR( 0xFFFFFFFF );
+	}
+	else if ( GLEW_ARB_parallel_shader_compile )
+	{
+		glMaxShaderCompilerThreadsARB( 0xFFFFFFFF );
+	}
+	else
+	{
+		SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION,
+						SDL_LOG_PRIORITY_INFO,
+						"[ShaderReloader] Parallel shader compile is not supported, shader reloads will compile synchronously." );
+	}
+
+#ifdef __linux__
+	m_inotifyFD = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+	if ( m_inotifyFD < 0 || inotify_add_watch( m_inotifyFD, shaderDir.string().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO ) < 0 )
+	{
+		SDL_LogMessage( SDL_LOG_CATEGORY_ERROR,
+						SDL_LOG_PRIORITY_WARN,
+						"[ShaderReloader] Could not watch shader directory %s, only manual reload is available.", shaderDir.string().c_str() );
+		if ( m_inotifyFD >= 0 ) close( m_inotifyFD );
+		m_inotifyFD = -1;
+	}
+#endif
+}
+
+void ShaderReloader::Clean()
+{
+	DeletePrograms();
+
+#ifdef __linux__
+	if ( m_inotifyFD >= 0 ) close( m_inotifyFD );
+#endif
+	m_inotifyFD = -1;
+}
+
+void ShaderReloader::AddProgram( GLuint* pProgramID, std::initializer_list<ShaderStageDescriptor> stages )
+{
+	*pProgramID = glCreateProgram();
+
+	ProgramBuilder builder{ *pProgramID };
+	for ( const ShaderStageDescriptor& stage : stages )
+	{
+		builder.ShaderStage( stage.shaderType, stage.fileName );
+	}
+	builder.Link();
+
+	WatchedProgram& program = m_programs.emplace_back();
+	program.pProgramID = pProgramID;
+	program.stages = stages;
+}
+
+// Deletes a program whose link was not finished: its shaders are not flagged for deletion yet
+// (only the link check does that), deleting the program alone would just detach them.
+static void DeleteUnfinishedProgram( GLuint programID )
+{
+	if ( programID == 0 ) return;
+
+	GLint shaderCount = 0;
+	glGetProgramiv( programID, GL_ATTACHED_SHADERS, &shaderCount );
+	std::vector<GLuint> shaders( static_cast<std::size_t>( shaderCount ) );
+	if ( shaderCount > 0 )
+		glGetAttachedShaders( programID, shaderCount, nullptr, shaders.data() );
+
+	glDeleteProgram( programID );
+	for ( GLuint shader : shaders )
+		glDeleteShader( shader );
+}
+
+void ShaderReloader::DeletePrograms()
+{
+	for ( WatchedProgram& program : m_programs )
+	{
+		// a rebuild still in flight at shutdown
+		program.pendingBuilder.reset();
+		DeleteUnfinishedProgram( program.pendingProgramID );
+		program.pendingProgramID = 0;
+		glDeleteProgram( *program.pProgramID );
+		*program.pProgramID = 0;
+	}
+	m_programs.clear();
+}
+
+void ShaderReloader::ReloadAll()
+{
+	for ( WatchedProgram& program : m_programs )
+	{
+		program.dirty = true;
+	}
+}
+
+void ShaderReloader::Update()
+{
+	PollFileEvents();
+
+	for ( WatchedProgram& program : m_programs )
+	{
+		if ( program.pendingBuilder && program.pendingBuilder->IsLinkComplete() )
+		{
+			FinishRebuild( program );
+		}
+
+		// A change during a rebuild is picked up after the rebuild finished
+		if ( program.dirty && !program.pendingBuilder )
+		{
+			program.dirty = false;
+			StartRebuild( program );
+		}
+	}
+}
+
+void ShaderReloader::PollFileEvents()
+{
+#ifdef __linux__
+	if ( m_inotifyFD < 0 ) return;
+
+	alignas( inotify_event ) char buffer[ 4096 ];
+	for ( ;; )
+	{
+		const ssize_t length = read( m_inotifyFD, buffer, sizeof( buffer ) );
+		if ( length <= 0 ) break; // EAGAIN: no more events
+
+		for ( const char* ptr = buffer; ptr < buffer + length; )
+		{
+			const inotify_event* event = reinterpret_cast<const inotify_event*>( ptr );
+			if ( event->len > 0 ) MarkDirty( event->name );
+			ptr += sizeof( inotify_event ) + event->len;
+		}
+	}
+#endif
+}
+
+void ShaderReloader::MarkDirty( const std::filesystem::path& changedFile )
+{
+	// Only the programs using the changed file are rebuilt
+	for ( WatchedProgram& program : m_programs )
+	{
+		for ( const ShaderStageDescriptor& stage : program.stages )
+		{
+			if ( stage.fileName.filename() == changedFile.filename() )
+			{
+				program.dirty = true;
+				break;
+			}
+		}
+	}
+}
+
+void ShaderReloader::StartRebuild( WatchedProgram& program )
+{
+	program.pendingProgramID = glCreateProgram();
+	program.pendingBuilder = std::make_unique<ProgramBuilder>( program.pendingProgramID );
+
+	for ( const ShaderStageDescriptor& stage : program.stages )
+	{
+		program.pendingBuilder->ShaderStage( stage.shaderType, stage.fileName );
+	}
+	program.pendingBuilder->LinkAsync();
+}
+
+void ShaderReloader::FinishRebuild( WatchedProgram& program )
+{
+	const bool success = program.pendingBuilder->FinishLink();
+	program.pendingBuilder.reset();
+
+	if ( success )
+	{
+		// Swap in the new program. The uniforms are set every frame, so it is ready to be used right away.
+		glDeleteProgram( *program.pProgramID );
+		*program.pProgramID = program.pendingProgramID;
+
+		SDL_LogMessage( SDL_LOG_CATEGORY_APPLICATION,
+						SDL_LOG_PRIORITY_INFO,
+						"[ShaderReloader] Reloaded %s", program.stages.back().fileName.string().c_str() );
+	}
+	else
+	{
+		glDeleteProgram( program.pendingProgramID );
+
+		SDL_LogMessage( SDL_LOG_CATEGORY_ERROR,
+						SDL_LOG_PRIORITY_WARN,
+						"[ShaderReloader] Reload of %s failed, keeping the previous program.", program.stages.back().fileName.string().c_str() );
+	}
+	program.pendingProgramID = 0;
+}
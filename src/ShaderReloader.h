@@ -0,0 +1,62 @@
+#pragma once
+
+#include <filesystem>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "ProgramBuilder.h"
+
+struct ShaderStageDescriptor
+{
+	GLenum shaderType = GL_NONE;
+	std::filesystem::path fileName;
+};
+
+// Owns the shader programs of the application and rebuilds them in the background when their sources change.
+// The rebuilt program replaces the old one only after it was linked successfully, a broken edit keeps the old one running.
+class ShaderReloader
+{
+public:
+	ShaderReloader();
+	~ShaderReloader();
+
+	// Starts watching the shader directory for changes (inotify on Linux, elsewhere only ReloadAll() triggers rebuilds).
+	void Init( const std::filesystem::path& shaderDir );
+	void Clean();
+
+	// Builds the program synchronously into *pProgramID and registers it for reloading.
+	void AddProgram( GLuint* pProgramID, std::initializer_list<ShaderStageDescriptor> stages );
+	// Deletes every registered program (and the unfinished rebuilds), the registrations are dropped.
+	void DeletePrograms();
+
+	// Requests the rebuild of every registered program.
+	void ReloadAll();
+
+	// Has to be called once per frame. Processes the file events, starts the rebuilds
+	// and swaps in the finished programs. It never waits for the shader compiler.
+	void Update();
+
+private:
+	struct WatchedProgram
+	{
+		GLuint* pProgramID = nullptr;
+		std::vector<ShaderStageDescriptor> stages;
+
+		bool dirty = false;
+
+		GLuint pendingProgramID = 0;
+		std::unique_ptr<ProgramBuilder> pendingBuilder;
+	};
+
+	std::vector<WatchedProgram> m_programs;
+
+	int m_inotifyFD = -1;
+
+	void PollFileEvents();
+	void MarkDirty( const std::filesystem::path& changedFile );
+	void StartRebuild( WatchedProgram& program );
+	void FinishRebuild( WatchedProgram& program );
+};
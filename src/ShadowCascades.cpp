@@ -0,0 +1,124 @@
+#include "ShadowCascades.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "GLUtils.hpp"
+
+void CascadedShadowMap::Init( GLsizei resolution )
+{
+	Clean();
+	m_resolution = resolution;
+
+	glCreateTextures( GL_TEXTURE_2D_ARRAY, 1, &m_textureID );
+	glTextureStorage3D( m_textureID, 1, GL_DEPTH_COMPONENT32F, resolution, resolution, MAX_CASCADES );
+	glTextureParameteri( m_textureID, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+	glTextureParameteri( m_textureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+	glTextureParameteri( m_textureID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER );
+	glTextureParameteri( m_textureID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER );
+	// outside of the map it is lit
+	const float border[ 4 ] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	glTextureParameterfv( m_textureID, GL_TEXTURE_BORDER_COLOR, border );
+	glTextureParameteri( m_textureID, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE );
+	glTextureParameteri( m_textureID, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL );
+
+	glCreateFramebuffers( 1, &m_framebufferID );
+	glNamedFramebufferDrawBuffer( m_framebufferID, GL_NONE );
+	glNamedFramebufferReadBuffer( m_framebufferID, GL_NONE );
+}
+
+void CascadedShadowMap::Clean()
+{
+	glDeleteFramebuffers( 1, &m_framebufferID );
+	glDeleteTextures( 1, &m_textureID );
+	m_framebufferID = 0;
+	m_textureID = 0;
+	m_resolution = 0;
+}
+
+void CascadedShadowMap::Update( const Camera& camera, const glm::vec3& toLight, int cascadeCount, float shadowDistance, float splitLambda )
+{
+	m_cascadeCount = std::clamp( cascadeCount, 1, MAX_CASCADES );
+	m_view = camera.GetRelativeViewMatrix();
+
+	const float zNear = camera.GetZNear();
+	const float zFar = std::max( std::min( camera.GetZFar(), shadowDistance ), zNear * 1.001f );
+
+	// the frustum slices are symmetric around the view axis, x^2 + y^2 = k^2 depth^2 at the corners
+	const float tanHalfY = std::tan( camera.GetAngle() * 0.5f );
+	const float tanHalfX = tanHalfY * camera.GetAspect();
+	const float k2 = tanHalfX * tanHalfX + tanHalfY * tanHalfY;
+
+	const glm::vec3 forward = -glm::vec3( m_view[ 0 ][ 2 ], m_view[ 1 ][ 2 ], m_view[ 2 ][ 2 ] );
+	// the light rotation only depends on the light direction
+	const glm::vec3 up = std::abs( toLight.y ) > 0.99f ? glm::vec3( 0.0f, 0.0f, 1.0f ) : glm::vec3( 0.0f, 1.0f, 0.0f );
+
+	float sliceNear = zNear;
+	for ( int cascade = 0; cascade < m_cascadeCount; ++cascade )
+	{
+		// practical split scheme: mix of the logarithmic and the uniform split
+		const float t = static_cast<float>( cascade + 1 ) / static_cast<float>( m_cascadeCount );
+		const float logSplit = zNear * std::pow( zFar / zNear, t );
+		const float uniformSplit = zNear + ( zFar - zNear ) * t;
+		const float sliceFar = splitLambda * logSplit + ( 1.0f - splitLambda ) * uniformSplit;
+
+		// the smallest sphere around the slice: its center is on the view axis, the same distance from the near and far corners
+		const float centerDepth = std::min( 0.5f * ( sliceNear + sliceFar ) * ( 1.0f + k2 ), sliceFar );
+		float radius = std::sqrt( ( sliceFar - centerDepth ) * ( sliceFar - centerDepth ) + sliceFar * sliceFar * k2 );
+		// quantized, so the rounding errors do not change the texel size from frame to frame
+		radius = std::ceil( radius * 16.0f ) / 16.0f;
+		const glm::vec3 center = forward * centerDepth;
+
+		const glm::mat4 lightView = glm::lookAt( center + toLight * ( radius + CASTER_DISTANCE ), center, up );
+		glm::mat4 lightProj = glm::ortho( -radius, radius, -radius, radius, 0.0f, 2.0f * radius + CASTER_DISTANCE );
+
+		// texel snapping: the world origin has to land on a texel corner, so the map only moves in whole texels;
+		// relative to the camera it is at -eye, which may be far, so this is done in double precision
+		const glm::dvec4 origin = glm::dmat4( lightProj ) * glm::dmat4( lightView ) * glm::dvec4( -camera.GetEye(), 1.0 );
+		const double texelsPerUnit = static_cast<double>( m_resolution ) * 0.5;
+		const glm::dvec2 originTexels = glm::dvec2( origin.x, origin.y ) * texelsPerUnit;
+		const glm::vec2 offset = glm::vec2( ( glm::round( originTexels ) - originTexels ) / texelsPerUnit );
+		lightProj[ 3 ][ 0 ] += offset.x;
+		lightProj[ 3 ][ 1 ] += offset.y;
+
+		m_viewProj[ cascade ] = lightProj * lightView;
+		m_splits[ cascade ] = sliceFar;
+		m_texelSizes[ cascade ] = 2.0f * radius / static_cast<float>( m_resolution );
+
+		sliceNear = sliceFar;
+	}
+}
+
+void CascadedShadowMap::Begin( GLuint targetFramebufferID, const glm::ivec4& targetViewport )
+{
+	m_targetFramebufferID = targetFramebufferID;
+	m_targetViewport = targetViewport;
+}
+
+void CascadedShadowMap::BeginCascade( int cascade ) const
+{
+	glNamedFramebufferTextureLayer( m_framebufferID, GL_DEPTH_ATTACHMENT, m_textureID, 0, cascade );
+	glBindFramebuffer( GL_FRAMEBUFFER, m_framebufferID );
+	glViewport( 0, 0, m_resolution, m_resolution );
+	glClear( GL_DEPTH_BUFFER_BIT );
+}
+
+void CascadedShadowMap::End() const
+{
+	glBindFramebuffer( GL_FRAMEBUFFER, m_targetFramebufferID );
+	glViewport( m_targetViewport.x, m_targetViewport.y, m_targetViewport.z, m_targetViewport.w );
+}
+
+void CascadedShadowMap::SetUniforms( GLuint programID, GLint textureUnit, int pcfRadius ) const
+{
+	glProgramUniform1i( programID, ul( programID, "shadowMap" ), textureUnit );
+	glProgramUniform1i( programID, ul( programID, "shadowCascadeCount" ), m_cascadeCount );
+	glProgramUniformMatrix4fv( programID, ul( programID, "shadowMatrices" ), m_cascadeCount, GL_FALSE, glm::value_ptr( m_viewProj[ 0 ] ) );
+	glProgramUniform4fv( programID, ul( programID, "shadowSplits" ), 1, m_splits.data() );
+	glProgramUniform4fv( programID, ul( programID, "shadowTexelSizes" ), 1, m_texelSizes.data() );
+	glProgramUniform1i( programID, ul( programID, "shadowPCFRadius" ), pcfRadius );
+	glProgramUniformMatrix4fv( programID, ul( programID, "view" ), 1, GL_FALSE, glm::value_ptr( m_view ) );
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Camera.h"
+
+// Cascaded shadow maps of a directional light. The view distance is split into cascades (practical split scheme
+// between Camera::GetZNear() and the shadow distance), every cascade gets an orthographic light projection fitted
+// to the bounding sphere of its frustum slice. The sphere does not change with the camera rotation and the projection
+// is snapped to whole texels, so the shadow edges stay still while the camera moves.
+// The cascades are layers of one depth texture array, sampled with hardware depth comparison (sampler2DArrayShadow).
+class CascadedShadowMap
+{
+public:
+	static constexpr int MAX_CASCADES = 4;
+
+	// (Re)creates the depth texture array with resolution x resolution layers.
+	void Init( GLsizei resolution );
+	void Clean();
+
+	// toLight: unit vector towards the light. splitLambda: 0 uniform, 1 logarithmic splits.
+	// The matrices are camera-relative (Camera::GetRelativeViewMatrix), the snapping uses the world origin.
+	void Update( const Camera& camera, const glm::vec3& toLight, int cascadeCount, float shadowDistance, float splitLambda );
+
+	// Remembers the framebuffer and the viewport of the image (the target may be an offscreen framebuffer),
+	// given by the caller so that no state has to be read back from the driver.
+	void Begin( GLuint targetFramebufferID, const glm::ivec4& targetViewport );
+	// Binds the framebuffer of the layer, sets the viewport and clears the depth (the depth mask has to be on).
+	void BeginCascade( int cascade ) const;
+	// Restores the framebuffer and the viewport of Begin().
+	void End() const;
+
+	// The uniforms of the lighting shader ("shadowMap", "shadowMatrices", ...); the texture has to be bound to textureUnit.
+	void SetUniforms( GLuint programID, GLint textureUnit, int pcfRadius ) const;
+
+	GLuint TextureID() const { return m_textureID; }
+	GLsizei Resolution() const { return m_resolution; }
+	int CascadeCount() const { return m_cascadeCount; }
+	const glm::mat4& CascadeViewProj( int cascade ) const { return m_viewProj[ cascade ]; }
+	float CascadeFar( int cascade ) const { return m_splits[ cascade ]; }
+
+	// the casters between the light and the cascade are also rendered up to this distance
+	static constexpr float CASTER_DISTANCE = 50.0f;
+
+private:
+	GLuint m_textureID = 0;
+	GLuint m_framebufferID = 0;
+	GLsizei m_resolution = 0;
+
+	GLuint m_targetFramebufferID = 0;
+	glm::ivec4 m_targetViewport = glm::ivec4( 0 );
+
+	int m_cascadeCount = 0;
+	glm::mat4 m_view = glm::mat4( 1.0f );
+	std::array<glm::mat4, MAX_CASCADES> m_viewProj = {};
+	std::array<float, MAX_CASCADES> m_splits = {};     // far view depth of the cascades
+	std::array<float, MAX_CASCADES> m_texelSizes = {}; // world size of a shadow map texel
+};
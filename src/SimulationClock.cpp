@@ -0,0 +1,107 @@
+#include "SimulationClock.h"
+
+#include <SDL2/SDL_timer.h>
+
+#include <algorithm>
+#include <cmath>
+
+SimulationClock::SimulationClock()
+{
+	m_frequency = SDL_GetPerformanceFrequency();
+	Reset();
+}
+
+void SimulationClock::Reset()
+{
+	m_startCounter = SDL_GetPerformanceCounter();
+	m_lastCounter = m_startCounter;
+
+	m_elapsedTime = 0.0;
+	m_deltaTime = 0.0;
+	m_accumulator = 0.0;
+	m_fixedStepCount = 0;
+	m_stepsThisFrame = 0;
+}
+
+void SimulationClock::Tick()
+{
+	const Uint64 counter = SDL_GetPerformanceCounter();
+
+	m_elapsedTime = static_cast<double>( counter - m_startCounter ) / m_frequency;
+	m_deltaTime = std::min( static_cast<double>( counter - m_lastCounter ) / m_frequency, MAX_DELTA_TIME );
+	m_lastCounter = counter;
+
+	if ( IsFixedTimeStep() ) m_accumulator += m_deltaTime;
+	m_stepsThisFrame = 0;
+}
+
+void SimulationClock::SetFixedTimeStep( double step )
+{
+	m_fixedTimeStep = std::max( step, 0.0 );
+	m_accumulator = 0.0;
+	m_fixedStepCount = 0;
+}
+
+bool SimulationClock::ConsumeFixedStep()
+{
+	if ( !IsFixedTimeStep() || m_accumulator < m_fixedTimeStep ) return false;
+
+	if ( m_stepsThisFrame == MAX_STEPS_PER_FRAME )
+	{
+		// drop the backlog, only keep the fraction for the interpolation
+		m_accumulator = std::fmod( m_accumulator, m_fixedTimeStep );
+		return false;
+	}
+
+	m_accumulator -= m_fixedTimeStep;
+	++m_fixedStepCount;
+	++m_stepsThisFrame;
+	return true;
+}
+
+float SimulationClock::GetInterpolationAlpha() const
+{
+	if ( !IsFixedTimeStep() ) return 1.0f;
+
+	return static_cast<float>( std::clamp( m_accumulator / m_fixedTimeStep, 0.0, 1.0 ) );
+}
+
+FramePacer::FramePacer()
+{
+	m_frequency = SDL_GetPerformanceFrequency();
+}
+
+void FramePacer::SetTargetFrameRate( double fps )
+{
+	m_targetFrameRate = std::max( fps, 0.0 );
+	m_nextFrameCounter = 0;
+}
+
+void FramePacer::Wait()
+{
+	if ( m_targetFrameRate <= 0.0 ) return;
+
+	const Uint64 period = static_cast<Uint64>( m_frequency / m_targetFrameRate );
+	Uint64 now = SDL_GetPerformanceCounter();
+
+	// first frame, or we fell behind by more than a frame: restart the schedule instead of rushing to catch up
+	if ( m_nextFrameCounter == 0 || now > m_nextFrameCounter + period )
+	{
+		m_nextFrameCounter = now + period;
+		return;
+	}
+
+	const Uint64 spinCounts = static_cast<Uint64>( SPIN_TIME * m_frequency );
+	while ( now + spinCounts < m_nextFrameCounter )
+	{
+		const Uint32 sleepMs = static_cast<Uint32>( ( m_nextFrameCounter - now - spinCounts ) * 1000 / m_frequency );
+		SDL_Delay( std::max<Uint32>( sleepMs, 1 ) );
+		now = SDL_GetPerformanceCounter();
+	}
+	while ( now < m_nextFrameCounter )
+	{
+		now = SDL_GetPerformanceCounter();
+	}
+
+	m_nextFrameCounter += period;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <SDL2/SDL_stdinc.h>
+
+// Frame clock on SDL_GetPerformanceCounter. The elapsed time is always recomputed from the integer counter,
+// so it does not drift or lose precision however long the program runs.
+// With a fixed time step the simulation advances in whole steps (deterministic), the remainder of the frame
+// is returned as the interpolation factor between the last two simulated states.
+class SimulationClock
+{
+public:
+	SimulationClock();
+
+	void Reset();
+
+	// Has to be called once per frame, measures the time since the previous call.
+	void Tick();
+
+	double GetElapsedTime() const { return m_elapsedTime; } // seconds since Reset()
+	double GetDeltaTime()   const { return m_deltaTime; }   // seconds since the previous Tick(), clamped to MAX_DELTA_TIME
+
+	// step <= 0 switches back to the variable time step
+	void SetFixedTimeStep( double step );
+	double GetFixedTimeStep() const { return m_fixedTimeStep; }
+	bool IsFixedTimeStep()    const { return m_fixedTimeStep > 0.0; }
+
+	// while ( clock.ConsumeFixedStep() ) Simulate( clock.GetFixedTimeStep() );
+	bool ConsumeFixedStep();
+	double GetSimulationTime() const { return m_fixedStepCount * m_fixedTimeStep; }
+	// Position of the current frame between the last two simulated steps, 1 with a variable time step.
+	float GetInterpolationAlpha() const;
+
+	static constexpr double MAX_DELTA_TIME = 0.25;     // e.g. after a breakpoint or while the window is dragged
+	static constexpr int MAX_STEPS_PER_FRAME = 8;      // if the simulation cannot keep up, slow down instead of spiralling
+
+private:
+	Uint64 m_frequency = 1;
+	Uint64 m_startCounter = 0;
+	Uint64 m_lastCounter = 0;
+
+	double m_elapsedTime = 0.0;
+	double m_deltaTime = 0.0;
+
+	double m_fixedTimeStep = 0.0;
+	double m_accumulator = 0.0;
+	Uint64 m_fixedStepCount = 0;
+	int m_stepsThisFrame = 0;
+};
+
+// Caps the frame rate when vsync is off: sleeps for the coarse part of the remaining frame time,
+// then spins on the performance counter for the last few milliseconds.
+class FramePacer
+{
+public:
+	FramePacer();
+
+	// fps <= 0 turns off the pacing
+	void SetTargetFrameRate( double fps );
+	double GetTargetFrameRate() const { return m_targetFrameRate; }
+
+	// Call after the buffer swap.
+	void Wait();
+
+private:
+	Uint64 m_frequency = 1;
+	Uint64 m_nextFrameCounter = 0;
+	double m_targetFrameRate = 0.0;
+
+	static constexpr double SPIN_TIME = 0.002; // SDL_Delay is not precise below this
+};
@@ -0,0 +1,522 @@
+#include "TextureCache.h"
+
+#include <SDL2/SDL_log.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#include <glm/glm.hpp>
+
+//
+// Cache file layout (KTX2-like: header, level index, then the tightly packed level data)
+//
+
+// Bump when the encoder or the layout changes, so the stale caches get rebuilt.
+static constexpr std::uint32_t TEXTURE_CACHE_VERSION = 1;
+static constexpr char TEXTURE_CACHE_MAGIC[ 8 ] = { 'T', 'E', 'X', 'C', 'A', 'C', 'H', 'E' };
+static constexpr std::uint32_t TEXTURE_CACHE_MAX_LEVELS = 32;
+
+struct TextureCacheHeader
+{
+	char          magic[ 8 ];
+	std::uint32_t version;
+	std::uint32_t internalFormat;
+	std::uint32_t width;
+	std::uint32_t height;
+	std::uint32_t levelCount;
+	std::uint32_t reserved;
+	std::uint64_t sourceSize;      // size and modification time of the source image,
+	std::int64_t  sourceWriteTime; // the cache is rebuilt if any of them changes
+};
+
+struct TextureCacheLevel
+{
+	std::uint64_t byteOffset; // from the start of the level data
+	std::uint64_t byteLength;
+};
+
+struct CompressedMIPChain
+{
+	GLenum internalFormat = GL_NONE;
+	unsigned int width  = 0;
+	unsigned int height = 0;
+	std::vector<TextureCacheLevel> levels;
+	std::vector<std::uint8_t> data;
+};
+
+//
+// sRGB conversion
+//
+
+static const std::array<float, 256>& SRGBToLinearTable()
+{
+	static const std::array<float, 256> table = []
+	{
+		std::array<float, 256> t{};
+		for ( int i = 0; i < 256; ++i )
+		{
+			const float c = i / 255.0f;
+			t[ i ] = ( c <= 0.04045f ) ? c / 12.92f : std::pow( ( c + 0.055f ) / 1.055f, 2.4f );
+		}
+		return t;
+	}();
+	return table;
+}
+
+// 16 bit linear -> 8 bit sRGB table, fine enough in the dark range too
+static const std::vector<std::uint8_t>& LinearToSRGBTable()
+{
+	static const std::vector<std::uint8_t> table = []
+	{
+		std::vector<std::uint8_t> t( 65536 );
+		for ( std::size_t i = 0; i < t.size(); ++i )
+		{
+			const float l = i / 65535.0f;
+			const float c = ( l <= 0.0031308f ) ? l * 12.92f : 1.055f * std::pow( l, 1.0f / 2.4f ) - 0.055f;
+			t[ i ] = static_cast<std::uint8_t>( std::clamp( c, 0.0f, 1.0f ) * 255.0f + 0.5f );
+		}
+		return t;
+	}();
+	return table;
+}
+
+static inline std::uint8_t LinearToSRGB8( float linear )
+{
+	return LinearToSRGBTable()[ static_cast<std::size_t>( std::clamp( linear, 0.0f, 1.0f ) * 65535.0f + 0.5f ) ];
+}
+
+//
+// MIP generation
+//
+
+// 2x2 box filter on linear RGBA float data. The edge texels of odd sized levels are clamped.
+// The per-texel 4 channel loop is written so that the compiler can vectorize it.
+static void DownsampleBox( const float* src, unsigned int srcWidth, unsigned int srcHeight,
+						   float* dst, unsigned int dstWidth, unsigned int dstHeight )
+{
+	for ( unsigned int y = 0; y < dstHeight; ++y )
+	{
+		const float* row0 = src + std::size_t( std::min( 2 * y,     srcHeight - 1 ) ) * srcWidth * 4;
+		const float* row1 = src + std::size_t( std::min( 2 * y + 1, srcHeight - 1 ) ) * srcWidth * 4;
+		float* dstRow = dst + std::size_t( y ) * dstWidth * 4;
+
+		for ( unsigned int x = 0; x < dstWidth; ++x )
+		{
+			const unsigned int x0 = std::min( 2 * x,     srcWidth - 1 ) * 4;
+			const unsigned int x1 = std::min( 2 * x + 1, srcWidth - 1 ) * 4;
+
+			for ( unsigned int c = 0; c < 4; ++c )
+			{
+				dstRow[ x * 4 + c ] = 0.25f * ( row0[ x0 + c ] + row0[ x1 + c ] + row1[ x0 + c ] + row1[ x1 + c ] );
+			}
+		}
+	}
+}
+
+std::vector<ImageRGBA> GenerateMIPChain( ImageRGBA image )
+{
+	std::vector<ImageRGBA> chain;
+	chain.reserve( NumberOfMIPLevels( image ) );
+
+	if ( image.texelData.empty() )
+	{
+		chain.push_back( std::move( image ) );
+		return chain;
+	}
+
+	// The chain is built from the unquantized linear levels, every level is only encoded once to sRGB.
+	const std::array<float, 256>& toLinear = SRGBToLinearTable();
+
+	std::vector<float> srcLevel( image.texelData.size() * 4 );
+	for ( std::size_t i = 0; i < image.texelData.size(); ++i )
+	{
+		const ImageRGBA::TexelRGBA& texel = image.texelData[ i ];
+		srcLevel[ i * 4 + 0 ] = toLinear[ texel.r ];
+		srcLevel[ i * 4 + 1 ] = toLinear[ texel.g ];
+		srcLevel[ i * 4 + 2 ] = toLinear[ texel.b ];
+		srcLevel[ i * 4 + 3 ] = texel.a / 255.0f;
+	}
+
+	unsigned int width  = image.width;
+	unsigned int height = image.height;
+	chain.push_back( std::move( image ) );
+
+	std::vector<float> dstLevel;
+
+	while ( width > 1 || height > 1 )
+	{
+		const unsigned int dstWidth  = std::max( width  / 2, 1u );
+		const unsigned int dstHeight = std::max( height / 2, 1u );
+
+		dstLevel.resize( std::size_t( dstWidth ) * dstHeight * 4 );
+		DownsampleBox( srcLevel.data(), width, height, dstLevel.data(), dstWidth, dstHeight );
+
+		ImageRGBA& level = chain.emplace_back();
+		level.Allocate( dstWidth, dstHeight );
+		for ( std::size_t i = 0; i < level.texelData.size(); ++i )
+		{
+			level.texelData[ i ] = ImageRGBA::TexelRGBA(
+				LinearToSRGB8( dstLevel[ i * 4 + 0 ] ),
+				LinearToSRGB8( dstLevel[ i * 4 + 1 ] ),
+				LinearToSRGB8( dstLevel[ i * 4 + 2 ] ),
+				static_cast<std::uint8_t>( std::clamp( dstLevel[ i * 4 + 3 ], 0.0f, 1.0f ) * 255.0f + 0.5f ) );
+		}
+
+		std::swap( srcLevel, dstLevel );
+		width  = dstWidth;
+		height = dstHeight;
+	}
+
+	return chain;
+}
+
+//
+// BC1 / BC3 block encoding
+//
+
+static std::uint16_t PackRGB565( const glm::vec3& color )
+{
+	const glm::vec3 c = glm::clamp( color, glm::vec3( 0.0f ), glm::vec3( 255.0f ) );
+	const auto r = static_cast<std::uint16_t>( c.r * ( 31.0f / 255.0f ) + 0.5f );
+	const auto g = static_cast<std::uint16_t>( c.g * ( 63.0f / 255.0f ) + 0.5f );
+	const auto b = static_cast<std::uint16_t>( c.b * ( 31.0f / 255.0f ) + 0.5f );
+	return static_cast<std::uint16_t>( ( r << 11 ) | ( g << 5 ) | b );
+}
+
+static glm::vec3 UnpackRGB565( std::uint16_t packed )
+{
+	const int r = ( packed >> 11 ) & 31;
+	const int g = ( packed >> 5  ) & 63;
+	const int b =   packed         & 31;
+	return glm::vec3( ( r << 3 ) | ( r >> 2 ), ( g << 2 ) | ( g >> 4 ), ( b << 3 ) | ( b >> 2 ) );
+}
+
+// Encodes the colour part of a 4x4 block (8 bytes) in 4 colour mode.
+// The endpoints are the extremes of the texels along the principal axis of the block, slightly inset.
+static void EncodeColorBlock( const ImageRGBA::TexelRGBA* texels, std::uint8_t* out )
+{
+	glm::vec3 mean( 0.0f );
+	for ( int i = 0; i < 16; ++i ) mean += glm::vec3( texels[ i ] );
+	mean /= 16.0f;
+
+	float cov[ 6 ] = {}; // xx, xy, xz, yy, yz, zz
+	for ( int i = 0; i < 16; ++i )
+	{
+		const glm::vec3 d = glm::vec3( texels[ i ] ) - mean;
+		cov[ 0 ] += d.x * d.x; cov[ 1 ] += d.x * d.y; cov[ 2 ] += d.x * d.z;
+		cov[ 3 ] += d.y * d.y; cov[ 4 ] += d.y * d.z; cov[ 5 ] += d.z * d.z;
+	}
+
+	// a few power iterations are enough to find the principal axis,
+	// starting from the covariance column of the channel with the largest variance
+	glm::vec3 axis( cov[ 0 ], cov[ 1 ], cov[ 2 ] );
+	if ( cov[ 3 ] > cov[ 0 ] && cov[ 3 ] >= cov[ 5 ] ) axis = glm::vec3( cov[ 1 ], cov[ 3 ], cov[ 4 ] );
+	else if ( cov[ 5 ] > cov[ 0 ] && cov[ 5 ] > cov[ 3 ] ) axis = glm::vec3( cov[ 2 ], cov[ 4 ], cov[ 5 ] );
+	for ( int iter = 0; iter < 4; ++iter )
+	{
+		const glm::vec3 next( cov[ 0 ] * axis.x + cov[ 1 ] * axis.y + cov[ 2 ] * axis.z,
+							  cov[ 1 ] * axis.x + cov[ 3 ] * axis.y + cov[ 4 ] * axis.z,
+							  cov[ 2 ] * axis.x + cov[ 4 ] * axis.y + cov[ 5 ] * axis.z );
+		const float maxComponent = std::max( { std::abs( next.x ), std::abs( next.y ), std::abs( next.z ) } );
+		if ( maxComponent < 1e-6f ) break; // (almost) single coloured block
+		axis = next / maxComponent;
+	}
+
+	float minProj = 0.0f, maxProj = 0.0f;
+	glm::vec3 minColor = mean, maxColor = mean;
+	for ( int i = 0; i < 16; ++i )
+	{
+		const glm::vec3 c = glm::vec3( texels[ i ] );
+		const float proj = glm::dot( c - mean, axis );
+		if ( proj < minProj ) { minProj = proj; minColor = c; }
+		if ( proj > maxProj ) { maxProj = proj; maxColor = c; }
+	}
+
+	const glm::vec3 inset = ( maxColor - minColor ) / 16.0f;
+	std::uint16_t c0 = PackRGB565( maxColor - inset );
+	std::uint16_t c1 = PackRGB565( minColor + inset );
+	if ( c0 < c1 ) std::swap( c0, c1 ); // c0 > c1 selects the 4 colour mode in BC1
+
+	const glm::vec3 p0 = UnpackRGB565( c0 );
+	const glm::vec3 p1 = UnpackRGB565( c1 );
+	const glm::vec3 palette[ 4 ] = { p0, p1, ( 2.0f * p0 + p1 ) / 3.0f, ( p0 + 2.0f * p1 ) / 3.0f };
+
+	std::uint32_t indices = 0;
+	if ( c0 != c1 )
+	{
+		for ( int i = 0; i < 16; ++i )
+		{
+			const glm::vec3 c = glm::vec3( texels[ i ] );
+			std::uint32_t best = 0;
+			float bestDist = glm::dot( c - palette[ 0 ], c - palette[ 0 ] );
+			for ( std::uint32_t p = 1; p < 4; ++p )
+			{
+				const float dist = glm::dot( c - palette[ p ], c - palette[ p ] );
+				if ( dist < bestDist ) { bestDist = dist; best = p; }
+			}
+			indices |= best << ( 2 * i );
+		}
+	}
+
+	out[ 0 ] = static_cast<std::uint8_t>( c0 & 0xFF ); out[ 1 ] = static_cast<std::uint8_t>( c0 >> 8 );
+	out[ 2 ] = static_cast<std::uint8_t>( c1 & 0xFF ); out[ 3 ] = static_cast<std::uint8_t>( c1 >> 8 );
+	for ( int b = 0; b < 4; ++b ) out[ 4 + b ] = static_cast<std::uint8_t>( indices >> ( 8 * b ) );
+}
+
+// Encodes the alpha part of a BC3 block (8 bytes) in 8 alpha mode.
+static void EncodeAlphaBlock( const ImageRGBA::TexelRGBA* texels, std::uint8_t* out )
+{
+	std::uint8_t a0 = 0, a1 = 255;
+	for ( int i = 0; i < 16; ++i )
+	{
+		a0 = std::max( a0, texels[ i ].a );
+		a1 = std::min( a1, texels[ i ].a );
+	}
+
+	std::uint64_t indices = 0;
+	if ( a0 > a1 )
+	{
+		int palette[ 8 ] = { a0, a1 };
+		for ( int p = 2; p < 8; ++p ) palette[ p ] = ( ( 8 - p ) * a0 + ( p - 1 ) * a1 ) / 7;
+
+		for ( int i = 0; i < 16; ++i )
+		{
+			std::uint64_t best = 0;
+			int bestDist = std::abs( texels[ i ].a - palette[ 0 ] );
+			for ( int p = 1; p < 8; ++p )
+			{
+				const int dist = std::abs( texels[ i ].a - palette[ p ] );
+				if ( dist < bestDist ) { bestDist = dist; best = p; }
+			}
+			indices |= best << ( 3 * i );
+		}
+	}
+
+	out[ 0 ] = a0;
+	out[ 1 ] = a1;
+	for ( int b = 0; b < 6; ++b ) out[ 2 + b ] = static_cast<std::uint8_t>( indices >> ( 8 * b ) );
+}
+
+static std::size_t CompressedLevelSize( GLenum internalFormat, unsigned int width, unsigned int height )
+{
+	const std::size_t blockBytes = ( internalFormat == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT ) ? 16 : 8;
+	return std::size_t( ( width + 3 ) / 4 ) * ( ( height + 3 ) / 4 ) * blockBytes;
+}
+
+static void CompressLevel( const ImageRGBA& image, GLenum internalFormat, std::uint8_t* out )
+{
+	const bool withAlpha = ( internalFormat == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT );
+	const unsigned int blocksX = ( image.width  + 3 ) / 4;
+	const unsigned int blocksY = ( image.height + 3 ) / 4;
+
+	ImageRGBA::TexelRGBA block[ 16 ];
+	for ( unsigned int by = 0; by < blocksY; ++by )
+	{
+		for ( unsigned int bx = 0; bx < blocksX; ++bx )
+		{
+			// the blocks of levels smaller than 4x4 are padded by clamping
+			for ( unsigned int y = 0; y < 4; ++y )
+			{
+				for ( unsigned int x = 0; x < 4; ++x )
+				{
+					block[ y * 4 + x ] = image.GetTexel( std::min( bx * 4 + x, image.width  - 1 ),
+														 std::min( by * 4 + y, image.height - 1 ) );
+				}
+			}
+
+			if ( withAlpha )
+			{
+				EncodeAlphaBlock( block, out );
+				out += 8;
+			}
+			EncodeColorBlock( block, out );
+			out += 8;
+		}
+	}
+}
+
+static CompressedMIPChain CompressMIPChain( const std::vector<ImageRGBA>& mipChain )
+{
+	const ImageRGBA& base = mipChain.front();
+
+	const bool hasAlpha = std::any_of( base.texelData.cbegin(), base.texelData.cend(),
+									   []( const ImageRGBA::TexelRGBA& texel ) { return texel.a != 255; } );
+
+	CompressedMIPChain chain;
+	chain.internalFormat = hasAlpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	chain.width  = base.width;
+	chain.height = base.height;
+
+	std::uint64_t totalSize = 0;
+	for ( const ImageRGBA& level : mipChain )
+	{
+		const std::uint64_t levelSize = CompressedLevelSize( chain.internalFormat, level.width, level.height );
+		chain.levels.push_back( { totalSize, levelSize } );
+		totalSize += levelSize;
+	}
+
+	chain.data.resize( totalSize );
+	for ( std::size_t i = 0; i < mipChain.size(); ++i )
+	{
+		CompressLevel( mipChain[ i ], chain.internalFormat, chain.data.data() + chain.levels[ i ].byteOffset );
+	}
+
+	return chain;
+}
+
+//
+// Cache file I/O
+//
+
+static std::filesystem::path CacheFileName( const std::filesystem::path& fileName )
+{
+	std::filesystem::path cacheFileName = fileName;
+	cacheFileName += ".texcache";
+	return cacheFileName;
+}
+
+static bool LoadTextureCache( const std::filesystem::path& cacheFileName, std::uint64_t sourceSize, std::int64_t sourceWriteTime, CompressedMIPChain& chain )
+{
+	std::ifstream cacheStream( cacheFileName, std::ios::binary );
+	if ( !cacheStream ) return false;
+
+	TextureCacheHeader header = {};
+	if ( !cacheStream.read( reinterpret_cast<char*>( &header ), sizeof( header ) ) ) return false;
+
+	if ( std::memcmp( header.magic, TEXTURE_CACHE_MAGIC, sizeof( TEXTURE_CACHE_MAGIC ) ) != 0
+		 || header.version != TEXTURE_CACHE_VERSION
+		 || header.sourceSize != sourceSize
+		 || header.sourceWriteTime != sourceWriteTime
+		 || ( header.internalFormat != GL_COMPRESSED_RGB_S3TC_DXT1_EXT && header.internalFormat != GL_COMPRESSED_RGBA_S3TC_DXT5_EXT )
+		 || header.width == 0 || header.height == 0
+		 || header.levelCount == 0 || header.levelCount > TEXTURE_CACHE_MAX_LEVELS )
+	{
+		return false;
+	}
+
+	chain.internalFormat = header.internalFormat;
+	chain.width  = header.width;
+	chain.height = header.height;
+	chain.levels.resize( header.levelCount );
+	if ( !cacheStream.read( reinterpret_cast<char*>( chain.levels.data() ), chain.levels.size() * sizeof( TextureCacheLevel ) ) ) return false;
+
+	// the level index has to describe exactly the expected, tightly packed chain
+	std::uint64_t totalSize = 0;
+	for ( std::uint32_t level = 0; level < header.levelCount; ++level )
+	{
+		const unsigned int levelWidth  = std::max( header.width  >> level, 1u );
+		const unsigned int levelHeight = std::max( header.height >> level, 1u );
+		if ( chain.levels[ level ].byteOffset != totalSize
+			 || chain.levels[ level ].byteLength != CompressedLevelSize( chain.internalFormat, levelWidth, levelHeight ) )
+		{
+			return false;
+		}
+		totalSize += chain.levels[ level ].byteLength;
+	}
+
+	chain.data.resize( totalSize );
+	return static_cast<bool>( cacheStream.read( reinterpret_cast<char*>( chain.data.data() ), totalSize ) );
+}
+
+static bool SaveTextureCache( const std::filesystem::path& cacheFileName, std::uint64_t sourceSize, std::int64_t sourceWriteTime, const CompressedMIPChain& chain )
+{
+	std::ofstream cacheStream( cacheFileName, std::ios::binary | std::ios::trunc );
+	if ( !cacheStream ) return false;
+
+	TextureCacheHeader header = {};
+	std::memcpy( header.magic, TEXTURE_CACHE_MAGIC, sizeof( TEXTURE_CACHE_MAGIC ) );
+	header.version         = TEXTURE_CACHE_VERSION;
+	header.internalFormat  = chain.internalFormat;
+	header.width           = chain.width;
+	header.height          = chain.height;
+	header.levelCount      = static_cast<std::uint32_t>( chain.levels.size() );
+	header.sourceSize      = sourceSize;
+	header.sourceWriteTime = sourceWriteTime;
+
+	cacheStream.write( reinterpret_cast<const char*>( &header ), sizeof( header ) );
+	cacheStream.write( reinterpret_cast<const char*>( chain.levels.data() ), chain.levels.size() * sizeof( TextureCacheLevel ) );
+	cacheStream.write( reinterpret_cast<const char*>( chain.data.data() ), chain.data.size() );
+
+	return static_cast<bool>( cacheStream );
+}
+
+//
+// Texture creation
+//
+
+static GLuint TextureFromMIPChain( const std::vector<ImageRGBA>& mipChain )
+{
+	const ImageRGBA& base = mipChain.front();
+
+	GLuint textureID = 0;
+	glCreateTextures( GL_TEXTURE_2D, 1, &textureID );
+	glTextureStorage2D( textureID, static_cast<GLsizei>( mipChain.size() ), GL_RGBA8, base.width, base.height );
+
+	for ( std::size_t level = 0; level < mipChain.size(); ++level )
+	{
+		glTextureSubImage2D( textureID, static_cast<GLint>( level ), 0, 0, mipChain[ level ].width, mipChain[ level ].height, GL_RGBA, GL_UNSIGNED_BYTE, mipChain[ level ].data() );
+	}
+
+	return textureID;
+}
+
+static GLuint TextureFromCompressedMIPChain( const CompressedMIPChain& chain )
+{
+	GLuint textureID = 0;
+	glCreateTextures( GL_TEXTURE_2D, 1, &textureID );
+	glTextureStorage2D( textureID, static_cast<GLsizei>( chain.levels.size() ), chain.internalFormat, chain.width, chain.height );
+
+	for ( std::size_t level = 0; level < chain.levels.size(); ++level )
+	{
+		glCompressedTextureSubImage2D( textureID, static_cast<GLint>( level ), 0, 0,
+									   std::max( chain.width  >> level, 1u ),
+									   std::max( chain.height >> level, 1u ),
+									   chain.internalFormat,
+									   static_cast<GLsizei>( chain.levels[ level ].byteLength ),
+									   chain.data.data() + chain.levels[ level ].byteOffset );
+	}
+
+	return textureID;
+}
+
+GLuint TextureFromFileCached( const std::filesystem::path& fileName )
+{
+	std::error_code ec;
+	const std::uint64_t sourceSize = std::filesystem::file_size( fileName, ec );
+	const std::int64_t sourceWriteTime = ec ? 0 : std::filesystem::last_write_time( fileName, ec ).time_since_epoch().count();
+
+	const bool canCompress = GLEW_EXT_texture_compression_s3tc && !ec;
+	const std::filesystem::path cacheFileName = CacheFileName( fileName );
+
+	CompressedMIPChain chain;
+	if ( canCompress && LoadTextureCache( cacheFileName, sourceSize, sourceWriteTime, chain ) )
+	{
+		return TextureFromCompressedMIPChain( chain );
+	}
+
+	ImageRGBA image = ImageFromFile( fileName );
+	if ( image.texelData.empty() ) return 0; // ImageFromFile already reported the error
+
+	std::vector<ImageRGBA> mipChain = GenerateMIPChain( std::move( image ) );
+
+	if ( !canCompress )
+	{
+		return TextureFromMIPChain( mipChain );
+	}
+
+	chain = CompressMIPChain( mipChain );
+
+	if ( !SaveTextureCache( cacheFileName, sourceSize, sourceWriteTime, chain ) )
+	{
+		SDL_LogMessage( SDL_LOG_CATEGORY_ERROR,
+						SDL_LOG_PRIORITY_WARN,
+						"[TextureFromFileCached] Could not write texture cache: %s", cacheFileName.string().c_str() );
+	}
+
+	return TextureFromCompressedMIPChain( chain );
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "GLUtils.hpp"
+
+// Builds the full MIP chain of the image on the CPU. The first element is the image itself.
+// The colour channels are filtered in linear space (sRGB decode -> 2x2 box -> sRGB encode),
+// the alpha channel is filtered as is.
+[[nodiscard]] std::vector<ImageRGBA> GenerateMIPChain( ImageRGBA image );
+
+// Creates an immutable 2D texture with all MIP levels from an image file.
+// The block compressed (BC1/BC3) MIP chain is cached next to the image file ( <fileName>.texcache ),
+// later calls upload the cached levels directly without decoding the image.
+// Without S3TC support the CPU generated MIP chain is uploaded as an uncompressed RGBA8 texture.
+[[nodiscard]] GLuint TextureFromFileCached( const std::filesystem::path& fileName );
@@ -0,0 +1,389 @@
+#include "Trajectory.h"
+
+#include <algorithm>
+#include <cmath>
+
+// A normal at the start of a segment that only depends on the tangent: the world up projected onto the normal plane
+// (the x axis if the tangent is vertical).
+static glm::vec3 CanonicalNormal( const glm::vec3& tangent )
+{
+	glm::vec3 up( 0.0f, 1.0f, 0.0f );
+	if ( std::abs( glm::dot( up, tangent ) ) > 0.99f ) up = glm::vec3( 1.0f, 0.0f, 0.0f );
+	return glm::normalize( up - glm::dot( up, tangent ) * tangent );
+}
+
+// Rotates the normal around the (perpendicular) tangent.
+static glm::vec3 Twist( const glm::vec3& normal, const glm::vec3& tangent, float angle )
+{
+	return std::cos( angle ) * normal + std::sin( angle ) * glm::cross( tangent, normal );
+}
+
+// Double reflection (Wang et al.): reflects the frame across the bisector plane of the two points,
+// then across the plane that takes the reflected tangent to the next tangent.
+static glm::vec3 TransportNormal( const glm::vec3& normal, const glm::vec3& position, const glm::vec3& tangent,
+								  const glm::vec3& nextPosition, const glm::vec3& nextTangent )
+{
+	glm::vec3 result = normal;
+	glm::vec3 reflectedTangent = tangent;
+
+	// at a joint (same position) the first reflection is taken across the normal plane, the two together are
+	// still the rotation that takes the tangent to the next one
+	glm::vec3 v1 = nextPosition - position;
+	if ( glm::dot( v1, v1 ) <= 1e-12f ) v1 = tangent;
+	const float c1 = glm::dot( v1, v1 );
+	if ( c1 > 1e-12f )
+	{
+		result -= ( 2.0f / c1 ) * glm::dot( v1, result ) * v1;
+		reflectedTangent -= ( 2.0f / c1 ) * glm::dot( v1, reflectedTangent ) * v1;
+	}
+
+	const glm::vec3 v2 = nextTangent - reflectedTangent;
+	const float c2 = glm::dot( v2, v2 );
+	if ( c2 > 1e-12f )
+		result -= ( 2.0f / c2 ) * glm::dot( v2, result ) * v2;
+
+	// against the accumulated rounding error
+	result -= glm::dot( result, nextTangent ) * nextTangent;
+	return glm::dot( result, result ) > 1e-12f ? glm::normalize( result ) : normal;
+}
+
+void Trajectory::SetControlPoints( const std::vector<glm::vec3>& controlPoints, SplineType type )
+{
+	m_type = type;
+	m_points.clear();
+
+	// the cubic types use 4 points per segment: the end points are repeated, so the curve starts and ends at them
+	m_repeat = controlPoints.size() < 2 ? 0 : type == SplineType::CATMULL_ROM ? 1 : type == SplineType::B_SPLINE ? 2 : 0;
+	if ( !controlPoints.empty() )
+	{
+		m_points.insert( m_points.end(), m_repeat, controlPoints.front() );
+		m_points.insert( m_points.end(), controlPoints.begin(), controlPoints.end() );
+		m_points.insert( m_points.end(), m_repeat, controlPoints.back() );
+	}
+
+	m_segmentCount = m_points.size() >= PointsPerSegment() ? m_points.size() - PointsPerSegment() + 1 : 0;
+
+	m_segmentStarts.assign( m_segmentCount + 1, 0.0f );
+	m_segmentTwists.assign( m_segmentCount, 0.0f );
+	m_sampleDistances.assign( m_segmentCount * TABLE_STRIDE, 0.0f );
+	m_uniformParams.assign( m_segmentCount * TABLE_STRIDE, 0.0f );
+	m_frameNormals.assign( m_segmentCount * TABLE_STRIDE, glm::vec3( 0.0f, 1.0f, 0.0f ) );
+
+	m_dirty.assign( m_segmentCount, 1 );
+	m_dirtyBegin = 0;
+	m_dirtyEnd = m_segmentCount;
+	Update();
+}
+
+void Trajectory::MoveControlPoint( std::size_t index, const glm::vec3& position )
+{
+	const std::size_t controlPointCount = m_points.size() - 2 * m_repeat;
+	if ( index >= controlPointCount ) return;
+
+	// the repeated copies of the end points move together
+	std::size_t firstPoint = index + m_repeat;
+	std::size_t lastPoint = firstPoint;
+	if ( index == 0 ) firstPoint = 0;
+	if ( index + 1 == controlPointCount ) lastPoint = m_points.size() - 1;
+
+	for ( std::size_t i = firstPoint; i <= lastPoint; ++i )
+		m_points[ i ] = position;
+
+	MarkSegments( firstPoint, lastPoint );
+}
+
+void Trajectory::MarkSegments( std::size_t firstPoint, std::size_t lastPoint )
+{
+	if ( m_segmentCount == 0 ) return;
+
+	// segment i uses the points i .. i + PointsPerSegment() - 1
+	const std::size_t begin = firstPoint >= PointsPerSegment() - 1 ? firstPoint - ( PointsPerSegment() - 1 ) : 0;
+	const std::size_t end = std::min( lastPoint + 1, m_segmentCount );
+	if ( begin >= end ) return;
+
+	std::fill( m_dirty.begin() + begin, m_dirty.begin() + end, 1 );
+	if ( m_dirtyBegin == m_dirtyEnd )
+	{
+		m_dirtyBegin = begin;
+		m_dirtyEnd = end;
+	}
+	else
+	{
+		m_dirtyBegin = std::min( m_dirtyBegin, begin );
+		m_dirtyEnd = std::max( m_dirtyEnd, end );
+	}
+}
+
+TrajectorySegmentRange Trajectory::Update()
+{
+	if ( m_dirtyBegin == m_dirtyEnd ) return {};
+
+	const TrajectorySegmentRange range{ m_dirtyBegin, m_dirtyEnd - m_dirtyBegin };
+
+	for ( std::size_t segment = m_dirtyBegin; segment < m_dirtyEnd; ++segment )
+	{
+		if ( !m_dirty[ segment ] ) continue;
+
+		RebuildSegment( segment );
+		m_dirty[ segment ] = 0;
+	}
+
+	// the offsets and the twists after the change are propagated to the end, without resampling
+	for ( std::size_t segment = m_dirtyBegin; segment < m_segmentCount; ++segment )
+		m_segmentStarts[ segment + 1 ] = m_segmentStarts[ segment ] + m_sampleDistances[ segment * TABLE_STRIDE + SAMPLES_PER_SEGMENT ];
+	UpdateTwists( m_dirtyBegin );
+
+	m_dirtyBegin = m_dirtyEnd = 0;
+	return range;
+}
+
+void Trajectory::RebuildSegment( std::size_t segment )
+{
+	float* distances = m_sampleDistances.data() + segment * TABLE_STRIDE;
+	float* uniformParams = m_uniformParams.data() + segment * TABLE_STRIDE;
+	glm::vec3* normals = m_frameNormals.data() + segment * TABLE_STRIDE;
+
+	// arc-length table from the chords of the samples
+	glm::vec3 previous = PositionAt( static_cast<float>( segment ) );
+	float distance = 0.0f;
+	for ( std::size_t k = 0; k < TABLE_STRIDE; ++k )
+	{
+		const glm::vec3 position = PositionAt( static_cast<float>( segment ) + static_cast<float>( k ) / SAMPLES_PER_SEGMENT );
+		distance += glm::distance( previous, position );
+		previous = position;
+		distances[ k ] = distance;
+	}
+
+	// the same table resampled at equal distances
+	const float step = distance / SAMPLES_PER_SEGMENT;
+	for ( std::size_t k = 0; k < TABLE_STRIDE; ++k )
+	{
+		const float s = std::min( step * static_cast<float>( k ), distance );
+		const std::size_t upper = std::clamp<std::size_t>( std::lower_bound( distances, distances + TABLE_STRIDE, s ) - distances, 1, SAMPLES_PER_SEGMENT );
+		const float span = distances[ upper ] - distances[ upper - 1 ];
+		const float alpha = span > 0.0f ? ( s - distances[ upper - 1 ] ) / span : 0.0f;
+		uniformParams[ k ] = ( static_cast<float>( upper - 1 ) + alpha ) / SAMPLES_PER_SEGMENT;
+	}
+
+	// rotation-minimizing normals along the uniform samples, from the canonical normal at the start
+	glm::vec3 position = PositionAt( static_cast<float>( segment ) + uniformParams[ 0 ] );
+	glm::vec3 tangent = TangentAt( static_cast<float>( segment ) + uniformParams[ 0 ] );
+	normals[ 0 ] = CanonicalNormal( tangent );
+	for ( std::size_t k = 1; k < TABLE_STRIDE; ++k )
+	{
+		const float u = static_cast<float>( segment ) + uniformParams[ k ];
+		const glm::vec3 nextPosition = PositionAt( u );
+		// the end of the segment with its own tangent, not with the start of the next one
+		const glm::vec3 nextTangent = TangentAt( k == SAMPLES_PER_SEGMENT ? std::nextafter( u, 0.0f ) : u );
+		normals[ k ] = TransportNormal( normals[ k - 1 ], position, tangent, nextPosition, nextTangent );
+		position = nextPosition;
+		tangent = nextTangent;
+	}
+}
+
+void Trajectory::UpdateTwists( std::size_t firstSegment )
+{
+	if ( m_segmentCount == 0 ) return;
+
+	// the first segment starts with the canonical normal
+	if ( firstSegment == 0 ) m_segmentTwists[ 0 ] = 0.0f;
+
+	for ( std::size_t segment = std::max<std::size_t>( firstSegment, 1 ); segment < m_segmentCount; ++segment )
+	{
+		// the real end normal of the previous segment carried over the joint (only the tangent may turn there)...
+		const float end = static_cast<float>( segment );
+		const glm::vec3 endTangent = TangentAt( std::nextafter( end, 0.0f ) );
+		const glm::vec3 endNormal = Twist( m_frameNormals[ segment * TABLE_STRIDE - 1 ], endTangent, m_segmentTwists[ segment - 1 ] );
+		const glm::vec3 startTangent = TangentAt( end );
+		const glm::vec3 startNormal = TransportNormal( endNormal, glm::vec3( 0.0f ), endTangent, glm::vec3( 0.0f ), startTangent );
+
+		// ... is the canonical one turned by the twist
+		const glm::vec3 canonical = m_frameNormals[ segment * TABLE_STRIDE ];
+		m_segmentTwists[ segment ] = std::atan2( glm::dot( glm::cross( canonical, startNormal ), startTangent ), glm::dot( canonical, startNormal ) );
+	}
+}
+
+std::size_t Trajectory::SegmentAtDistance( float s ) const
+{
+	// the last segment starting not after s
+	const auto it = std::upper_bound( m_segmentStarts.begin() + 1, m_segmentStarts.end() - 1, s );
+	return static_cast<std::size_t>( it - ( m_segmentStarts.begin() + 1 ) );
+}
+
+void Trajectory::LocateSegment( float u, std::size_t& segment, float& t ) const
+{
+	u = glm::clamp( u, 0.0f, static_cast<float>( m_segmentCount ) );
+	segment = std::min( static_cast<std::size_t>( u ), m_segmentCount - 1 );
+	t = u - static_cast<float>( segment );
+}
+
+glm::vec3 Trajectory::PositionAt( float u ) const
+{
+	if ( m_segmentCount == 0 ) return m_points.empty() ? glm::vec3( 0.0f ) : m_points.front();
+
+	std::size_t segment;
+	float t;
+	LocateSegment( u, segment, t );
+	const glm::vec3* p = m_points.data() + segment;
+
+	const float t2 = t * t, t3 = t2 * t;
+	switch ( m_type )
+	{
+	case SplineType::CATMULL_ROM:
+		return 0.5f * ( 2.0f * p[ 1 ] + ( p[ 2 ] - p[ 0 ] ) * t
+					  + ( 2.0f * p[ 0 ] - 5.0f * p[ 1 ] + 4.0f * p[ 2 ] - p[ 3 ] ) * t2
+					  + ( -p[ 0 ] + 3.0f * p[ 1 ] - 3.0f * p[ 2 ] + p[ 3 ] ) * t3 );
+	case SplineType::B_SPLINE:
+	{
+		const float s = 1.0f - t;
+		return ( s * s * s * p[ 0 ] + ( 3.0f * t3 - 6.0f * t2 + 4.0f ) * p[ 1 ]
+			   + ( -3.0f * t3 + 3.0f * t2 + 3.0f * t + 1.0f ) * p[ 2 ] + t3 * p[ 3 ] ) / 6.0f;
+	}
+	default:
+		return glm::mix( p[ 0 ], p[ 1 ], t );
+	}
+}
+
+glm::vec3 Trajectory::Derivative( float u ) const
+{
+	std::size_t segment;
+	float t;
+	LocateSegment( u, segment, t );
+	const glm::vec3* p = m_points.data() + segment;
+
+	const float t2 = t * t;
+	switch ( m_type )
+	{
+	case SplineType::CATMULL_ROM:
+		return 0.5f * ( ( p[ 2 ] - p[ 0 ] )
+					  + 2.0f * ( 2.0f * p[ 0 ] - 5.0f * p[ 1 ] + 4.0f * p[ 2 ] - p[ 3 ] ) * t
+					  + 3.0f * ( -p[ 0 ] + 3.0f * p[ 1 ] - 3.0f * p[ 2 ] + p[ 3 ] ) * t2 );
+	case SplineType::B_SPLINE:
+	{
+		const float s = 1.0f - t;
+		return ( -3.0f * s * s * p[ 0 ] + ( 9.0f * t2 - 12.0f * t ) * p[ 1 ]
+			   + ( -9.0f * t2 + 6.0f * t + 3.0f ) * p[ 2 ] + 3.0f * t2 * p[ 3 ] ) / 6.0f;
+	}
+	default:
+		return p[ 1 ] - p[ 0 ];
+	}
+}
+
+glm::vec3 Trajectory::TangentAt( float u ) const
+{
+	if ( m_segmentCount == 0 ) return glm::vec3( 1.0f, 0.0f, 0.0f );
+
+	glm::vec3 derivative = Derivative( u );
+
+	// the derivative vanishes at the repeated end points of the B-spline (and at coinciding control points):
+	// the direction is taken from a bit further inside
+	const float end = static_cast<float>( m_segmentCount );
+	for ( float step = 1.0f / SAMPLES_PER_SEGMENT; glm::dot( derivative, derivative ) < 1e-12f && step <= end; step *= 2.0f )
+		derivative = PositionAt( std::min( u + step, end ) ) - PositionAt( std::max( u - step, 0.0f ) );
+
+	if ( glm::dot( derivative, derivative ) < 1e-12f ) return glm::vec3( 1.0f, 0.0f, 0.0f );
+
+	return glm::normalize( derivative );
+}
+
+float Trajectory::ParameterAtDistance( float s ) const
+{
+	if ( m_segmentCount == 0 ) return 0.0f;
+
+	s = glm::clamp( s, 0.0f, Length() );
+	const std::size_t segment = SegmentAtDistance( s );
+	const float local = s - m_segmentStarts[ segment ];
+
+	// first sample not closer than the distance, the curve is linear between two samples
+	const float* distances = m_sampleDistances.data() + segment * TABLE_STRIDE;
+	const std::size_t upper = std::clamp<std::size_t>( std::lower_bound( distances, distances + TABLE_STRIDE, local ) - distances, 1, SAMPLES_PER_SEGMENT );
+	const float span = distances[ upper ] - distances[ upper - 1 ];
+	const float alpha = span > 0.0f ? ( local - distances[ upper - 1 ] ) / span : 0.0f;
+	return static_cast<float>( segment ) + ( static_cast<float>( upper - 1 ) + alpha ) / SAMPLES_PER_SEGMENT;
+}
+
+float Trajectory::ParameterAtDistanceUniform( float s ) const
+{
+	if ( m_segmentCount == 0 ) return 0.0f;
+
+	s = glm::clamp( s, 0.0f, Length() );
+	const std::size_t segment = SegmentAtDistance( s );
+	const float segmentLength = m_segmentStarts[ segment + 1 ] - m_segmentStarts[ segment ];
+	if ( segmentLength <= 0.0f ) return static_cast<float>( segment );
+
+	const float position = glm::clamp( ( s - m_segmentStarts[ segment ] ) / segmentLength * SAMPLES_PER_SEGMENT, 0.0f, static_cast<float>( SAMPLES_PER_SEGMENT ) );
+	const std::size_t lower = std::min( static_cast<std::size_t>( position ), static_cast<std::size_t>( SAMPLES_PER_SEGMENT - 1 ) );
+	const float* uniformParams = m_uniformParams.data() + segment * TABLE_STRIDE;
+	return static_cast<float>( segment ) + glm::mix( uniformParams[ lower ], uniformParams[ lower + 1 ], position - static_cast<float>( lower ) );
+}
+
+glm::mat3 Trajectory::FrameAt( float s, float u ) const
+{
+	const glm::vec3 tangent = TangentAt( u );
+	if ( m_segmentCount == 0 )
+	{
+		const glm::vec3 normal = CanonicalNormal( tangent );
+		return glm::mat3( tangent, normal, glm::cross( tangent, normal ) );
+	}
+
+	s = glm::clamp( s, 0.0f, Length() );
+	const std::size_t segment = SegmentAtDistance( s );
+	const float segmentLength = m_segmentStarts[ segment + 1 ] - m_segmentStarts[ segment ];
+	const float position = segmentLength > 0.0f
+		? glm::clamp( ( s - m_segmentStarts[ segment ] ) / segmentLength * SAMPLES_PER_SEGMENT, 0.0f, static_cast<float>( SAMPLES_PER_SEGMENT ) )
+		: 0.0f;
+	const std::size_t lower = std::min( static_cast<std::size_t>( position ), static_cast<std::size_t>( SAMPLES_PER_SEGMENT - 1 ) );
+
+	// the normals of the table are interpolated, turned by the twist of the segment, then made perpendicular to the exact tangent
+	const glm::vec3* normals = m_frameNormals.data() + segment * TABLE_STRIDE;
+	glm::vec3 normal = glm::mix( normals[ lower ], normals[ lower + 1 ], position - static_cast<float>( lower ) );
+	normal = Twist( normal, tangent, m_segmentTwists[ segment ] );
+	normal -= glm::dot( normal, tangent ) * tangent;
+	normal = glm::dot( normal, normal ) > 1e-12f ? glm::normalize( normal ) : CanonicalNormal( tangent );
+
+	return glm::mat3( tangent, normal, glm::cross( tangent, normal ) );
+}
+
+glm::mat3 Trajectory::FrameAtDistance( float s ) const
+{
+	return FrameAt( s, ParameterAtDistanceUniform( s ) );
+}
+
+void Trajectory::EvaluateBatch( const float* distances, std::size_t count, glm::vec3* positions, glm::vec3* tangents ) const
+{
+	for ( std::size_t i = 0; i < count; ++i )
+	{
+		const float u = ParameterAtDistanceUniform( distances[ i ] );
+		positions[ i ] = PositionAt( u );
+		if ( tangents ) tangents[ i ] = TangentAt( u );
+	}
+}
+
+void Trajectory::EvaluateFrameBatch( const float* distances, std::size_t count, glm::vec3* positions, glm::mat3* frames ) const
+{
+	for ( std::size_t i = 0; i < count; ++i )
+	{
+		const float u = ParameterAtDistanceUniform( distances[ i ] );
+		positions[ i ] = PositionAt( u );
+		frames[ i ] = FrameAt( distances[ i ], u );
+	}
+}
+
+void Trajectory::SampleSegments( TrajectorySegmentRange range, glm::vec3* points ) const
+{
+	if ( m_segmentCount == 0 )
+	{
+		points[ 0 ] = PositionAt( 0.0f );
+		return;
+	}
+
+	for ( std::size_t segment = range.first; segment < range.first + range.count; ++segment )
+	{
+		const float* uniformParams = m_uniformParams.data() + segment * TABLE_STRIDE;
+		for ( std::size_t k = 0; k < SAMPLES_PER_SEGMENT; ++k )
+			*points++ = PositionAt( static_cast<float>( segment ) + uniformParams[ k ] );
+	}
+
+	// the end of the range is the start of the next segment
+	*points = PositionAt( static_cast<float>( range.first + range.count ) );
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+enum class SplineType
+{
+	LINEAR,      // polyline through the control points
+	CATMULL_ROM, // interpolates the control points
+	B_SPLINE,    // uniform cubic B-spline, C2 smooth, only the end points are interpolated
+};
+
+// Range of segments recomputed by an update.
+struct TrajectorySegmentRange
+{
+	std::size_t first = 0;
+	std::size_t count = 0;
+};
+
+// A curve through (or near) the control points with an arc-length table, so it can be sampled at constant speed,
+// and a rotation-minimizing frame table for orienting the objects that move along it.
+// The curve parameter u runs from 0 to SegmentCount(), the distance s from 0 to Length().
+//
+// The tables are kept per segment, so moving a control point only resamples the (at most four) segments it affects.
+// Only the segment offsets and the twist of the frames are propagated to the rest of the curve, both are O(1) per segment.
+// The evaluation is read-only (callable from any thread).
+class Trajectory
+{
+public:
+	// Rebuilds everything.
+	void SetControlPoints( const std::vector<glm::vec3>& controlPoints, SplineType type );
+	// Marks the affected segments, they are recomputed by the next Update().
+	void MoveControlPoint( std::size_t index, const glm::vec3& position );
+	// Recomputes the segments changed since the last update, returns the range containing them.
+	TrajectorySegmentRange Update();
+
+	SplineType Type() const { return m_type; }
+	std::size_t SegmentCount() const { return m_segmentCount; }
+	float Length() const { return m_segmentStarts.empty() ? 0.0f : m_segmentStarts.back(); }
+
+	// By curve parameter
+	glm::vec3 PositionAt( float u ) const;
+	glm::vec3 TangentAt( float u ) const; // normalized
+
+	// Distance along the curve -> curve parameter: binary search in the arc-length table...
+	float ParameterAtDistance( float s ) const;
+	// ... or binary search for the segment only and a lookup in its table resampled to equal distances.
+	float ParameterAtDistanceUniform( float s ) const;
+
+	// By distance along the curve (uniform table)
+	glm::vec3 PositionAtDistance( float s ) const { return PositionAt( ParameterAtDistanceUniform( s ) ); }
+	glm::vec3 TangentAtDistance( float s ) const { return TangentAt( ParameterAtDistanceUniform( s ) ); }
+
+	// Rotation-minimizing frame at the distance: columns tangent, normal, binormal (= cross( tangent, normal )).
+	// The normal does not twist around the tangent more than the curve forces it to, whatever the shape or sample rate.
+	glm::mat3 FrameAtDistance( float s ) const;
+
+	// Samples count points by distance; tangents may be null.
+	void EvaluateBatch( const float* distances, std::size_t count, glm::vec3* positions, glm::vec3* tangents ) const;
+	// The same with the frames.
+	void EvaluateFrameBatch( const float* distances, std::size_t count, glm::vec3* positions, glm::mat3* frames ) const;
+
+	// Points at equal distances inside every segment: SAMPLES_PER_SEGMENT per segment, plus the end of the last one.
+	// Segment i owns the points from i * SAMPLES_PER_SEGMENT, so a recomputed range maps to a range of points.
+	static std::size_t SamplePointCount( std::size_t segmentCount ) { return segmentCount * SAMPLES_PER_SEGMENT + 1; }
+	void SampleSegments( TrajectorySegmentRange range, glm::vec3* points ) const;
+
+	static constexpr int SAMPLES_PER_SEGMENT = 32;
+
+private:
+	static constexpr std::size_t TABLE_STRIDE = SAMPLES_PER_SEGMENT + 1; // table entries per segment
+
+	SplineType m_type = SplineType::LINEAR;
+	std::vector<glm::vec3> m_points; // the control points, with the end points repeated for the cubic types
+	std::size_t m_repeat = 0;        // how many times the end points are repeated
+	std::size_t m_segmentCount = 0;
+
+	// per segment: distance of the start (one more: the length), twist of the frame around the start tangent
+	std::vector<float> m_segmentStarts;
+	std::vector<float> m_segmentTwists;
+
+	// TABLE_STRIDE entries per segment: distance of the samples at equal parameter steps from the segment start...
+	std::vector<float> m_sampleDistances;
+	// ... and the local parameter at equal distances, with the rotation-minimizing normal started
+	// from a canonical normal at the segment start (the twist turns it into the real one)
+	std::vector<float> m_uniformParams;
+	std::vector<glm::vec3> m_frameNormals;
+
+	std::vector<std::uint8_t> m_dirty;
+	std::size_t m_dirtyBegin = 0;
+	std::size_t m_dirtyEnd = 0;
+
+	std::size_t PointsPerSegment() const { return m_type == SplineType::LINEAR ? 2 : 4; }
+	void MarkSegments( std::size_t firstPoint, std::size_t lastPoint );
+	void RebuildSegment( std::size_t segment );
+	void UpdateTwists( std::size_t firstSegment );
+
+	std::size_t SegmentAtDistance( float s ) const;
+	void LocateSegment( float u, std::size_t& segment, float& t ) const;
+	glm::vec3 Derivative( float u ) const;
+	glm::mat3 FrameAt( float s, float u ) const;
+};
@@ -0,0 +1,121 @@
+#include "TrajectoryBuffer.h"
+
+#include <algorithm>
+
+#include "GLUtils.hpp"
+
+void TrajectoryBuffer::Init()
+{
+	glCreateBuffers( 1, &m_pointBufferID );
+	glCreateBuffers( 1, &m_colorBufferID );
+	glCreateVertexArrays( 1, &m_vaoID );
+	m_pointCapacity = 0;
+	m_colorCapacity = 0;
+
+	// the whole point array is one block in the shader
+	GLint64 maxBlockSize = 0;
+	glGetInteger64v( GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &maxBlockSize );
+	m_maxPointCount = static_cast<std::size_t>( maxBlockSize ) / sizeof( glm::vec4 );
+}
+
+void TrajectoryBuffer::Clean()
+{
+	glDeleteBuffers( 1, &m_pointBufferID );
+	glDeleteBuffers( 1, &m_colorBufferID );
+	glDeleteVertexArrays( 1, &m_vaoID );
+	m_pointBufferID = m_colorBufferID = m_vaoID = 0;
+	m_pointCapacity = m_colorCapacity = 0;
+
+	Clear();
+}
+
+void TrajectoryBuffer::Clear()
+{
+	m_points.clear();
+	m_colors.clear();
+	m_firsts.clear();
+	m_counts.clear();
+	m_ribbonFirsts.clear();
+	m_ribbonCounts.clear();
+}
+
+std::size_t TrajectoryBuffer::AddPoints( const glm::vec3* points, std::size_t count, const glm::vec3& color )
+{
+	const std::size_t path = m_firsts.size();
+	const GLint first = static_cast<GLint>( m_points.size() );
+	count = std::min( count, m_maxPointCount - std::min( m_points.size(), m_maxPointCount ) );
+
+	m_points.reserve( m_points.size() + count );
+	for ( std::size_t i = 0; i < count; ++i )
+		m_points.push_back( glm::vec4( points[ i ], static_cast<float>( path ) ) );
+
+	m_colors.push_back( glm::vec4( color, 1.0f ) );
+	m_firsts.push_back( first );
+	m_counts.push_back( static_cast<GLsizei>( count ) );
+	m_ribbonFirsts.push_back( 2 * first );
+	m_ribbonCounts.push_back( static_cast<GLsizei>( 2 * count ) );
+
+	return path;
+}
+
+std::size_t TrajectoryBuffer::AddPath( const Trajectory& trajectory, const glm::vec3& color )
+{
+	m_positions.resize( Trajectory::SamplePointCount( trajectory.SegmentCount() ) );
+	trajectory.SampleSegments( { 0, trajectory.SegmentCount() }, m_positions.data() );
+	return AddPoints( m_positions.data(), m_positions.size(), color );
+}
+
+void TrajectoryBuffer::Upload()
+{
+	if ( !UploadDynamicBuffer( m_pointBufferID, m_pointCapacity, m_points ) ||
+		 !UploadDynamicBuffer( m_colorBufferID, m_colorCapacity, m_colors ) )
+	{
+		Clear();
+	}
+}
+
+void TrajectoryBuffer::UpdatePoints( std::size_t path, std::size_t firstPoint, const glm::vec3* points, std::size_t count )
+{
+	if ( path >= m_firsts.size() ) return;
+
+	count = std::min( count, static_cast<std::size_t>( m_counts[ path ] ) - std::min( firstPoint, static_cast<std::size_t>( m_counts[ path ] ) ) );
+	if ( count == 0 ) return;
+
+	const std::size_t offset = static_cast<std::size_t>( m_firsts[ path ] ) + firstPoint;
+	for ( std::size_t i = 0; i < count; ++i )
+		m_points[ offset + i ] = glm::vec4( points[ i ], static_cast<float>( path ) );
+
+	glNamedBufferSubData( m_pointBufferID, offset * sizeof( glm::vec4 ), count * sizeof( glm::vec4 ), m_points.data() + offset );
+}
+
+void TrajectoryBuffer::UpdatePath( std::size_t path, const Trajectory& trajectory, TrajectorySegmentRange range )
+{
+	if ( range.count == 0 ) return;
+
+	m_positions.resize( range.count * Trajectory::SAMPLES_PER_SEGMENT + 1 );
+	trajectory.SampleSegments( range, m_positions.data() );
+	UpdatePoints( path, range.first * Trajectory::SAMPLES_PER_SEGMENT, m_positions.data(), m_positions.size() );
+}
+
+void TrajectoryBuffer::Draw( GLStateCache& state, GLuint programID, float ribbonWidth, const glm::vec2& viewportSize ) const
+{
+	if ( m_points.empty() ) return;
+
+	const bool ribbon = ribbonWidth > 0.0f;
+	glProgramUniform1i( programID, ul( programID, "ribbon" ), ribbon ? 1 : 0 );
+	glProgramUniform1f( programID, ul( programID, "ribbonWidth" ), ribbonWidth );
+	glProgramUniform2f( programID, ul( programID, "viewportSize" ), viewportSize.x, viewportSize.y );
+
+	// only the uploaded part: the spare capacity may hold stale points, and the shader uses the length of the array
+	glBindBufferRange( GL_SHADER_STORAGE_BUFFER, POINT_BINDING, m_pointBufferID, 0, static_cast<GLsizeiptr>( m_points.size() * sizeof( glm::vec4 ) ) );
+	glBindBufferRange( GL_SHADER_STORAGE_BUFFER, COLOR_BINDING, m_colorBufferID, 0, static_cast<GLsizeiptr>( m_colors.size() * sizeof( glm::vec4 ) ) );
+
+	state.UseProgram( programID );
+	state.BindVertexArray( m_vaoID );
+
+	// gl_VertexID counts from the first vertex of the range, so every path finds its own points
+	if ( ribbon )
+		glMultiDrawArrays( GL_TRIANGLE_STRIP, m_ribbonFirsts.data(), m_ribbonCounts.data(), static_cast<GLsizei>( m_ribbonFirsts.size() ) );
+	else
+		glMultiDrawArrays( GL_LINE_STRIP, m_firsts.data(), m_counts.data(), static_cast<GLsizei>( m_firsts.size() ) );
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "GLStateCache.h"
+#include "Trajectory.h"
+
+// Polylines in shader storage buffers (Shaders/Vert_traj.vert), any number of them with any number of points.
+// All paths are drawn by one glMultiDrawArrays, either as line strips or as screen-space ribbons of a given width.
+class TrajectoryBuffer
+{
+public:
+	void Init();
+	void Clean();
+
+	void Clear();
+	// Returns the index of the path. Beyond MaxPointCount() the points are dropped.
+	std::size_t AddPoints( const glm::vec3* points, std::size_t count, const glm::vec3& color );
+	// The curve sampled at equal distances inside every segment (Trajectory::SampleSegments).
+	std::size_t AddPath( const Trajectory& trajectory, const glm::vec3& color );
+
+	// Uploads the paths added since the last Clear(). Has to be called on the thread of the context.
+	// If the buffers cannot be allocated, the paths are cleared.
+	void Upload();
+
+	// Overwrites the points of an uploaded path from firstPoint, only the changed part of the buffer is uploaded.
+	void UpdatePoints( std::size_t path, std::size_t firstPoint, const glm::vec3* points, std::size_t count );
+	// The points of the recomputed segments of a path added by AddPath (the segment count has to be the same).
+	void UpdatePath( std::size_t path, const Trajectory& trajectory, TrajectorySegmentRange range );
+
+	// viewProj and the other uniforms of the program have to be set beforehand. ribbonWidth is in pixels, 0 draws lines.
+	void Draw( GLStateCache& state, GLuint programID, float ribbonWidth, const glm::vec2& viewportSize ) const;
+
+	std::size_t PathCount() const { return m_firsts.size(); }
+	std::size_t PointCount() const { return m_points.size(); }
+	// The points that fit into one shader storage block (GL_MAX_SHADER_STORAGE_BLOCK_SIZE), summed over all paths.
+	std::size_t MaxPointCount() const { return m_maxPointCount; }
+
+	static constexpr GLuint POINT_BINDING = 1; // binding of TrajectoryPoints in the shader
+	static constexpr GLuint COLOR_BINDING = 2; // binding of TrajectoryColors in the shader
+
+private:
+	// xyz: position, w: index of the path (the ribbons do not connect the neighbouring paths)
+	std::vector<glm::vec4> m_points;
+	std::vector<glm::vec4> m_colors;
+	std::vector<GLint> m_firsts;
+	std::vector<GLsizei> m_counts;
+
+	// the same ranges for the ribbons, two vertices per point
+	std::vector<GLint> m_ribbonFirsts;
+	std::vector<GLsizei> m_ribbonCounts;
+
+	GLuint m_pointBufferID = 0;
+	GLuint m_colorBufferID = 0;
+	GLuint m_vaoID = 0; // empty, the vertices come from the storage buffer
+	std::size_t m_pointCapacity = 0; // in bytes
+	std::size_t m_colorCapacity = 0;
+	std::size_t m_maxPointCount = 0;
+	std::vector<glm::vec3> m_positions; // scratch for the sampling
+};
@@ -0,0 +1,187 @@
+#include "TransformSystem.h"
+
+#if defined( __SSE__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 1 )
+#define TRANSFORM_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+void TransformSystem::Clear()
+{
+	Resize( 0 );
+}
+
+void TransformSystem::Resize( std::size_t count )
+{
+	m_positionX.resize( count, 0.0 ); m_positionY.resize( count, 0.0 ); m_positionZ.resize( count, 0.0 );
+	m_rotationX.resize( count, 0.0f ); m_rotationY.resize( count, 0.0f ); m_rotationZ.resize( count, 0.0f ); m_rotationW.resize( count, 1.0f );
+	m_scaleX.resize( count, 1.0f ); m_scaleY.resize( count, 1.0f ); m_scaleZ.resize( count, 1.0f );
+	m_dirty.resize( count, 0 );
+
+	m_world.resize( count, glm::mat4( 1.0f ) );
+	m_normal.resize( count, glm::mat4( 1.0f ) );
+}
+
+TransformHandle TransformSystem::Create( const glm::dvec3& position, const glm::quat& rotation, const glm::vec3& scale )
+{
+	const TransformHandle handle = static_cast<TransformHandle>( Size() );
+	Resize( Size() + 1 );
+	SetTRS( handle, position, rotation, scale );
+	return handle;
+}
+
+void TransformSystem::SetPosition( TransformHandle handle, const glm::dvec3& position )
+{
+	m_positionX[ handle ] = position.x; m_positionY[ handle ] = position.y; m_positionZ[ handle ] = position.z;
+	m_dirty[ handle ] = 1;
+}
+
+void TransformSystem::SetRotation( TransformHandle handle, const glm::quat& rotation )
+{
+	m_rotationX[ handle ] = rotation.x; m_rotationY[ handle ] = rotation.y; m_rotationZ[ handle ] = rotation.z; m_rotationW[ handle ] = rotation.w;
+	m_dirty[ handle ] = 1;
+}
+
+void TransformSystem::SetScale( TransformHandle handle, const glm::vec3& scale )
+{
+	m_scaleX[ handle ] = scale.x; m_scaleY[ handle ] = scale.y; m_scaleZ[ handle ] = scale.z;
+	m_dirty[ handle ] = 1;
+}
+
+void TransformSystem::SetTRS( TransformHandle handle, const glm::dvec3& position, const glm::quat& rotation, const glm::vec3& scale )
+{
+	SetPosition( handle, position );
+	SetRotation( handle, rotation );
+	SetScale( handle, scale );
+}
+
+glm::dvec3 TransformSystem::Position( TransformHandle handle ) const
+{
+	return glm::dvec3( m_positionX[ handle ], m_positionY[ handle ], m_positionZ[ handle ] );
+}
+
+glm::quat TransformSystem::Rotation( TransformHandle handle ) const
+{
+	return glm::quat( m_rotationW[ handle ], m_rotationX[ handle ], m_rotationY[ handle ], m_rotationZ[ handle ] );
+}
+
+glm::vec3 TransformSystem::Scale( TransformHandle handle ) const
+{
+	return glm::vec3( m_scaleX[ handle ], m_scaleY[ handle ], m_scaleZ[ handle ] );
+}
+
+void TransformSystem::UpdateScalar( std::size_t i )
+{
+	const float x = m_rotationX[ i ], y = m_rotationY[ i ], z = m_rotationZ[ i ], w = m_rotationW[ i ];
+
+	// columns of the rotation matrix of the unit quaternion
+	const glm::vec3 r0( 1.0f - 2.0f * ( y * y + z * z ), 2.0f * ( x * y + w * z ), 2.0f * ( x * z - w * y ) );
+	const glm::vec3 r1( 2.0f * ( x * y - w * z ), 1.0f - 2.0f * ( x * x + z * z ), 2.0f * ( y * z + w * x ) );
+	const glm::vec3 r2( 2.0f * ( x * z + w * y ), 2.0f * ( y * z - w * x ), 1.0f - 2.0f * ( x * x + y * y ) );
+
+	const glm::vec3 scale = Scale( static_cast<TransformHandle>( i ) );
+	const bool uniform = scale.x == scale.y && scale.y == scale.z;
+	const glm::vec3 inverseScale = uniform ? glm::vec3( 1.0f ) : 1.0f / scale;
+
+	m_world[ i ] = glm::mat4( glm::vec4( r0 * scale.x, 0.0f ), glm::vec4( r1 * scale.y, 0.0f ), glm::vec4( r2 * scale.z, 0.0f ),
+							  glm::vec4( glm::vec3( Position( static_cast<TransformHandle>( i ) ) ), 1.0f ) );
+	m_normal[ i ] = glm::mat4( glm::vec4( r0 * inverseScale.x, 0.0f ), glm::vec4( r1 * inverseScale.y, 0.0f ), glm::vec4( r2 * inverseScale.z, 0.0f ),
+							   glm::vec4( 0.0f, 0.0f, 0.0f, 1.0f ) );
+	m_dirty[ i ] = 0;
+}
+
+glm::mat4 TransformSystem::RelativeWorld( TransformHandle handle, const glm::dvec3& origin ) const
+{
+	glm::mat4 world = m_world[ handle ];
+	world[ 3 ] = glm::vec4( glm::vec3( Position( handle ) - origin ), 1.0f );
+	return world;
+}
+
+#ifdef TRANSFORM_USE_SSE
+// Writes the column ( x, y, z, w ) of four matrices given component-wise (one lane per matrix).
+static void StoreColumn( glm::mat4* matrices, int column, __m128 x, __m128 y, __m128 z, __m128 w )
+{
+	_MM_TRANSPOSE4_PS( x, y, z, w );
+	_mm_storeu_ps( &matrices[ 0 ][ column ][ 0 ], x );
+	_mm_storeu_ps( &matrices[ 1 ][ column ][ 0 ], y );
+	_mm_storeu_ps( &matrices[ 2 ][ column ][ 0 ], z );
+	_mm_storeu_ps( &matrices[ 3 ][ column ][ 0 ], w );
+}
+
+// Four consecutive double precision coordinates rounded to float.
+static __m128 LoadRounded( const double* values )
+{
+	return _mm_setr_ps( static_cast<float>( values[ 0 ] ), static_cast<float>( values[ 1 ] ),
+						static_cast<float>( values[ 2 ] ), static_cast<float>( values[ 3 ] ) );
+}
+#endif
+
+std::size_t TransformSystem::Update( std::size_t begin, std::size_t end )
+{
+	std::size_t updated = 0;
+	std::size_t i = begin;
+
+#ifdef TRANSFORM_USE_SSE
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps( 1.0f );
+	const __m128 two = _mm_set1_ps( 2.0f );
+
+	for ( ; i + 4 <= end; i += 4 )
+	{
+		// a block with any change is recomputed as a whole, the unchanged lanes get the same result again
+		if ( ( m_dirty[ i ] | m_dirty[ i + 1 ] | m_dirty[ i + 2 ] | m_dirty[ i + 3 ] ) == 0 ) continue;
+
+		const __m128 x = _mm_loadu_ps( m_rotationX.data() + i );
+		const __m128 y = _mm_loadu_ps( m_rotationY.data() + i );
+		const __m128 z = _mm_loadu_ps( m_rotationZ.data() + i );
+		const __m128 w = _mm_loadu_ps( m_rotationW.data() + i );
+
+		const __m128 xx = _mm_mul_ps( x, x ), yy = _mm_mul_ps( y, y ), zz = _mm_mul_ps( z, z );
+		const __m128 xy = _mm_mul_ps( x, y ), xz = _mm_mul_ps( x, z ), yz = _mm_mul_ps( y, z );
+		const __m128 wx = _mm_mul_ps( w, x ), wy = _mm_mul_ps( w, y ), wz = _mm_mul_ps( w, z );
+
+		const __m128 r00 = _mm_sub_ps( one, _mm_mul_ps( two, _mm_add_ps( yy, zz ) ) );
+		const __m128 r01 = _mm_mul_ps( two, _mm_add_ps( xy, wz ) );
+		const __m128 r02 = _mm_mul_ps( two, _mm_sub_ps( xz, wy ) );
+		const __m128 r10 = _mm_mul_ps( two, _mm_sub_ps( xy, wz ) );
+		const __m128 r11 = _mm_sub_ps( one, _mm_mul_ps( two, _mm_add_ps( xx, zz ) ) );
+		const __m128 r12 = _mm_mul_ps( two, _mm_add_ps( yz, wx ) );
+		const __m128 r20 = _mm_mul_ps( two, _mm_add_ps( xz, wy ) );
+		const __m128 r21 = _mm_mul_ps( two, _mm_sub_ps( yz, wx ) );
+		const __m128 r22 = _mm_sub_ps( one, _mm_mul_ps( two, _mm_add_ps( xx, yy ) ) );
+
+		const __m128 sx = _mm_loadu_ps( m_scaleX.data() + i );
+		const __m128 sy = _mm_loadu_ps( m_scaleY.data() + i );
+		const __m128 sz = _mm_loadu_ps( m_scaleZ.data() + i );
+
+		// uniform lanes: rotation only, the others: R * S^-1
+		const __m128 uniform = _mm_and_ps( _mm_cmpeq_ps( sx, sy ), _mm_cmpeq_ps( sy, sz ) );
+		auto inverse = [ & ]( __m128 s ) { return _mm_or_ps( _mm_and_ps( uniform, one ), _mm_andnot_ps( uniform, _mm_div_ps( one, s ) ) ); };
+		const __m128 ix = inverse( sx ), iy = inverse( sy ), iz = inverse( sz );
+
+		glm::mat4* world = m_world.data() + i;
+		StoreColumn( world, 0, _mm_mul_ps( r00, sx ), _mm_mul_ps( r01, sx ), _mm_mul_ps( r02, sx ), zero );
+		StoreColumn( world, 1, _mm_mul_ps( r10, sy ), _mm_mul_ps( r11, sy ), _mm_mul_ps( r12, sy ), zero );
+		StoreColumn( world, 2, _mm_mul_ps( r20, sz ), _mm_mul_ps( r21, sz ), _mm_mul_ps( r22, sz ), zero );
+		StoreColumn( world, 3, LoadRounded( m_positionX.data() + i ), LoadRounded( m_positionY.data() + i ), LoadRounded( m_positionZ.data() + i ), one );
+
+		glm::mat4* normal = m_normal.data() + i;
+		StoreColumn( normal, 0, _mm_mul_ps( r00, ix ), _mm_mul_ps( r01, ix ), _mm_mul_ps( r02, ix ), zero );
+		StoreColumn( normal, 1, _mm_mul_ps( r10, iy ), _mm_mul_ps( r11, iy ), _mm_mul_ps( r12, iy ), zero );
+		StoreColumn( normal, 2, _mm_mul_ps( r20, iz ), _mm_mul_ps( r21, iz ), _mm_mul_ps( r22, iz ), zero );
+		StoreColumn( normal, 3, zero, zero, zero, one );
+
+		m_dirty[ i ] = m_dirty[ i + 1 ] = m_dirty[ i + 2 ] = m_dirty[ i + 3 ] = 0;
+		updated += 4;
+	}
+#endif
+
+	for ( ; i < end; ++i )
+	{
+		if ( !m_dirty[ i ] ) continue;
+
+		UpdateScalar( i );
+		++updated;
+	}
+
+	return updated;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+using TransformHandle = std::uint32_t;
+
+// Translation-rotation-scale transforms in SoA layout. The world and normal matrices are derived
+// in batches of four (SSE where available) and only for the transforms changed since the last Update().
+//
+// There is no general 4x4 inverse: for M = T * R * S the inverse transpose of the linear part is R * S^-1.
+// With uniform scale the normal matrix is the rotation alone (the length of the normals is off by 1/s,
+// the shaders normalize them anyway).
+//
+// The positions are double precision. World() has them rounded to float, which is fine near the origin (bounds,
+// picking); for rendering RelativeWorld() takes the translation relative to the camera in double precision.
+class TransformSystem
+{
+public:
+	void Clear();
+	// New transforms start as identity.
+	void Resize( std::size_t count );
+	TransformHandle Create( const glm::dvec3& position = glm::dvec3( 0.0 ),
+							const glm::quat& rotation = glm::quat( 1.0f, 0.0f, 0.0f, 0.0f ), // w, x, y, z
+							const glm::vec3& scale = glm::vec3( 1.0f ) );
+
+	std::size_t Size() const { return m_dirty.size(); }
+
+	// The setters only touch the given transform, so different transforms may be set from different threads.
+	void SetPosition( TransformHandle handle, const glm::dvec3& position );
+	void SetRotation( TransformHandle handle, const glm::quat& rotation ); // has to be normalized
+	void SetScale( TransformHandle handle, const glm::vec3& scale );
+	void SetTRS( TransformHandle handle, const glm::dvec3& position, const glm::quat& rotation, const glm::vec3& scale );
+
+	glm::dvec3 Position( TransformHandle handle ) const;
+	glm::quat Rotation( TransformHandle handle ) const;
+	glm::vec3 Scale( TransformHandle handle ) const;
+
+	// Recomputes the matrices of the changed transforms, returns how many were recomputed.
+	// Disjoint ranges may be updated in parallel.
+	std::size_t Update() { return Update( 0, Size() ); }
+	std::size_t Update( std::size_t begin, std::size_t end );
+
+	const glm::mat4& World( TransformHandle handle ) const { return m_world[ handle ]; }
+	const glm::mat4& NormalMatrix( TransformHandle handle ) const { return m_normal[ handle ]; }
+	// The world matrix with the origin moved to origin (the camera position for camera-relative rendering).
+	glm::mat4 RelativeWorld( TransformHandle handle, const glm::dvec3& origin ) const;
+
+private:
+	std::vector<double> m_positionX, m_positionY, m_positionZ;
+	std::vector<float> m_rotationX, m_rotationY, m_rotationZ, m_rotationW;
+	std::vector<float> m_scaleX, m_scaleY, m_scaleZ;
+	std::vector<std::uint8_t> m_dirty;
+
+	std::vector<glm::mat4> m_world;
+	std::vector<glm::mat4> m_normal;
+
+	void UpdateScalar( std::size_t index );
+};
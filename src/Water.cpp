@@ -0,0 +1,117 @@
+#include "Water.h"
+
+#include <chrono>
+
+#include <SDL2/SDL_log.h>
+#include <glm/gtc/type_ptr.hpp>
+
+void Water::Init( int gridResolution, int fftSize, const OceanParameters& parameters )
+{
+	// the grid: only UVs, the vertex shader places and displaces the vertices
+	MeshObject<glm::vec2> grid;
+	const int verticesPerRow = gridResolution + 1;
+	grid.vertexArray.reserve( static_cast<std::size_t>( verticesPerRow ) * verticesPerRow );
+	for ( int v = 0; v < verticesPerRow; ++v )
+		for ( int u = 0; u < verticesPerRow; ++u )
+			grid.vertexArray.emplace_back( static_cast<float>( u ) / gridResolution, static_cast<float>( v ) / gridResolution );
+
+	grid.indexArray.reserve( static_cast<std::size_t>( gridResolution ) * gridResolution * 6 );
+	for ( int v = 0; v < gridResolution; ++v )
+	{
+		for ( int u = 0; u < gridResolution; ++u )
+		{
+			const GLuint corner = static_cast<GLuint>( v * verticesPerRow + u );
+			grid.indexArray.insert( grid.indexArray.end(), {
+				corner, corner + 1, corner + verticesPerRow,
+				corner + 1, corner + 1 + verticesPerRow, corner + verticesPerRow } );
+		}
+	}
+
+	m_grid = CreateGLObjectFromMesh( grid, { { 0, 0, 2, GL_FLOAT } } );
+
+	m_ocean.Init( fftSize, parameters );
+
+	glCreateTextures( GL_TEXTURE_2D, 1, &m_displacementTextureID );
+	glTextureStorage2D( m_displacementTextureID, 1, GL_RGBA32F, fftSize, fftSize );
+	glTextureParameteri( m_displacementTextureID, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+	glTextureParameteri( m_displacementTextureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+	glTextureParameteri( m_displacementTextureID, GL_TEXTURE_WRAP_S, GL_REPEAT );
+	glTextureParameteri( m_displacementTextureID, GL_TEXTURE_WRAP_T, GL_REPEAT );
+
+	const GLsizeiptr bufferSize = static_cast<GLsizeiptr>( fftSize ) * fftSize * sizeof( glm::vec4 );
+	glCreateBuffers( static_cast<GLsizei>( m_pixelBuffers.size() ), m_pixelBuffers.data() );
+	for ( GLuint buffer : m_pixelBuffers )
+		glNamedBufferData( buffer, bufferSize, nullptr, GL_STREAM_DRAW );
+	m_nextPixelBuffer = 0;
+
+	// flat water color, the lighting shader multiplies with it
+	const std::uint8_t color[ 4 ] = { 30, 80, 110, 255 };
+	glCreateTextures( GL_TEXTURE_2D, 1, &m_colorTextureID );
+	glTextureStorage2D( m_colorTextureID, 1, GL_RGBA8, 1, 1 );
+	glTextureSubImage2D( m_colorTextureID, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, color );
+}
+
+void Water::Clean()
+{
+	CleanOGLObject( m_grid );
+	glDeleteTextures( 1, &m_displacementTextureID );
+	glDeleteTextures( 1, &m_colorTextureID );
+	glDeleteBuffers( static_cast<GLsizei>( m_pixelBuffers.size() ), m_pixelBuffers.data() );
+	m_displacementTextureID = 0;
+	m_colorTextureID = 0;
+	m_pixelBuffers = {};
+}
+
+void Water::SetParameters( const OceanParameters& parameters )
+{
+	if ( parameters == m_ocean.Parameters() ) return;
+	m_ocean.Init( m_ocean.Size(), parameters );
+}
+
+void Water::Update( double time, JobSystem& jobs )
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	const int size = m_ocean.Size();
+	const GLuint buffer = m_pixelBuffers[ m_nextPixelBuffer ];
+	m_nextPixelBuffer = ( m_nextPixelBuffer + 1 ) % m_pixelBuffers.size();
+
+	// invalidate: the driver gives new memory if the GPU still reads the old content
+	const GLsizeiptr bufferSize = static_cast<GLsizeiptr>( size ) * size * sizeof( glm::vec4 );
+	glm::vec4* texels = static_cast<glm::vec4*>( glMapNamedBufferRange( buffer, 0, bufferSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT ) );
+	if ( texels == nullptr )
+	{
+		SDL_LogMessage( SDL_LOG_CATEGORY_ERROR, SDL_LOG_PRIORITY_ERROR, "[Water] Could not map the pixel buffer" );
+		return;
+	}
+
+	m_ocean.Evaluate( time, jobs, texels );
+
+	if ( glUnmapNamedBuffer( buffer ) == GL_TRUE )
+	{
+		// from the bound pixel buffer: the data pointer is an offset, the copy happens on the GPU timeline
+		glBindBuffer( GL_PIXEL_UNPACK_BUFFER, buffer );
+		glTextureSubImage2D( m_displacementTextureID, 0, 0, 0, size, size, GL_RGBA, GL_FLOAT, nullptr );
+		glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+	}
+
+	m_simulationMs = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+}
+
+void Water::SetUniforms( GLuint programID, GLint textureUnit ) const
+{
+	glProgramUniform1i( programID, ul( programID, "displacementMap" ), textureUnit );
+	glProgramUniform1f( programID, ul( programID, "patchSize" ), m_ocean.Parameters().patchSize );
+	glProgramUniform1f( programID, ul( programID, "gridSize" ), gridSize );
+	glProgramUniform1f( programID, ul( programID, "choppiness" ), choppiness );
+}
+
+DrawCommand Water::Command() const
+{
+	DrawCommand command;
+	command.vaoID = m_grid.vaoID;
+	command.depthVaoID = m_grid.depthVaoID;
+	command.count = m_grid.count;
+	command.textureID = m_colorTextureID;
+	return command;
+}
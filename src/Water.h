@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "GLUtils.hpp"
+#include "JobSystem.h"
+#include "OceanFFT.h"
+#include "RenderCommandList.h"
+
+// Animated ocean surface: one static UV grid mesh displaced in the vertex shader (Shaders/Vert_water.vert)
+// by a displacement texture, which the CPU FFT (OceanFFT) recomputes every frame. The FFT writes straight into
+// a mapped pixel buffer, and the texture is updated from it, so the upload does not stall the CPU. The buffers
+// alternate, the GPU can still read the previous one while the next is written.
+class Water
+{
+public:
+	// gridResolution x gridResolution quads; fftSize: resolution of the displacement texture (power of two)
+	void Init( int gridResolution, int fftSize, const OceanParameters& parameters );
+	void Clean();
+	bool IsInitialized() const { return m_displacementTextureID != 0; }
+
+	// Rebuilds the spectrum if the parameters changed.
+	void SetParameters( const OceanParameters& parameters );
+	// Recomputes the displacements for the time and starts their upload, on the thread of the context.
+	void Update( double time, JobSystem& jobs );
+
+	// The uniforms of the water vertex shader; the displacement texture has to be bound to textureUnit.
+	void SetUniforms( GLuint programID, GLint textureUnit ) const;
+	// The grid with the flat water color (texture unit 0), world has to be set by the caller.
+	DrawCommand Command() const;
+
+	GLuint DisplacementTexture() const { return m_displacementTextureID; }
+	double SimulationMs() const { return m_simulationMs; }
+
+	float gridSize = 256.0f;  // world size of the grid, the displacement repeats over it every patchSize
+	float choppiness = 1.0f; // scale of the horizontal displacement
+
+private:
+	OceanFFT m_ocean;
+	OGLObject m_grid = {};
+	GLuint m_displacementTextureID = 0;
+	GLuint m_colorTextureID = 0;
+	std::array<GLuint, 2> m_pixelBuffers = {};
+	std::size_t m_nextPixelBuffer = 0;
+	double m_simulationMs = 0.0;
+};
@@ -16,6 +16,7 @@
 #include <sstream>
 
 #include "MyApp.h"
+#include "HeadlessBenchmark.h"
 
 int main( int argc, char* args[] )
 {
@@ -25,6 +26,12 @@ int main( int argc, char* args[] )
 
 	// Állítsuk be a hiba Logging függvényt.
 	SDL_LogSetPriority(SDL_LOG_CATEGORY_ERROR, SDL_LOG_PRIORITY_ERROR);
+
+	// --headless: ablak és SDL videó alrendszer nélkül, offscreen fut le a benchmark
+	HeadlessBenchmarkOptions benchmarkOptions;
+	if ( ParseHeadlessBenchmarkOptions( argc, args, benchmarkOptions ) )
+		return RunHeadlessBenchmark( benchmarkOptions );
+
 	// a grafikus alrendszert kapcsoljuk csak be, ha gond van, akkor jelezzük és lépjünk ki
 	if ( SDL_Init( SDL_INIT_VIDEO ) == -1 )
 	{
@@ -236,27 +243,60 @@ int main( int argc, char* args[] )
 			}
 
 			// Számoljuk ki az update-hez szükséges idő mennyiségeket!
-			static Uint32 LastTick = SDL_GetTicks(); // statikusan tároljuk, mi volt az előző "tick".
-			Uint32 CurrentTick = SDL_GetTicks(); // Mi az aktuális.
-			SUpdateInfo updateInfo // Váltsuk át másodpercekre!
-			{ 
-				static_cast<float>(CurrentTick) / 1000.0f, 
-				static_cast<float>(CurrentTick - LastTick) / 1000.0f 
+			SimulationClock& clock = app.GetClock();
+			clock.Tick();
+			SUpdateInfo updateInfo
+			{
+				clock.GetElapsedTime(),
+				static_cast<float>( clock.GetDeltaTime() )
 			};
-			LastTick = CurrentTick; // Mentsük el utolsóként az aktuális "tick"-et!
 
-			app.Update( updateInfo );
-			app.Render();
+			FrameProfiler& profiler = app.GetProfiler();
+			profiler.BeginFrame();
+
+			{
+				ProfileZone zone( profiler, "Update" );
+
+				// szimuláció: fix időlépésnél annyi lépés, amennyi az eltelt időbe belefér, különben egy
+				if ( clock.IsFixedTimeStep() )
+				{
+					while ( clock.ConsumeFixedStep() )
+						app.FixedUpdate( SUpdateInfo{ clock.GetSimulationTime(), static_cast<float>( clock.GetFixedTimeStep() ) } );
+				}
+				else
+				{
+					app.FixedUpdate( updateInfo );
+				}
+				app.SetInterpolationAlpha( clock.GetInterpolationAlpha() );
+
+				app.Update( updateInfo );
+			}
+			{
+				ProfileZone zone( profiler, "Render" );
+				app.Render();
+			}
+			{
+				ProfileZone zone( profiler, "ImGui" );
+
+				ImGui_ImplOpenGL3_NewFrame();
+				ImGui_ImplSDL2_NewFrame(); //Ezután lehet imgui parancsokat hívni, egészen az ImGui::Render()-ig
+
+				ImGui::NewFrame();
+				if ( ShowImGui) app.RenderGUI();
+				ImGui::Render();
 
-			ImGui_ImplOpenGL3_NewFrame();
-			ImGui_ImplSDL2_NewFrame(); //Ezután lehet imgui parancsokat hívni, egészen az ImGui::Render()-ig
+				ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+			}
+			{
+				ProfileZone zone( profiler, "Swap" );
+				SDL_GL_SwapWindow(win);
+			}
 
-			ImGui::NewFrame();
-			if ( ShowImGui) app.RenderGUI();
-			ImGui::Render();
+			profiler.EndFrame();
 
-			ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-			SDL_GL_SwapWindow(win);
+			// vsync nélkül a beállított FPS-re korlátozunk
+			if ( SDL_GL_GetSwapInterval() == 0 )
+				app.GetFramePacer().Wait();
 		}
 
 		// takarítson el maga után az objektumunk